@@ -27,9 +27,14 @@
 #include "pin_mapping.h"
 #include "task.h"
 
+/* C Standard includes */
+#include <stdlib.h>
+
 /* Project Includes */
 #include "cli.h"
 #include "cli_commands.h"
+#include "i2c.h"
+#include "ipmb.h"
 #include "port.h"
 #include "task_priorities.h"
 
@@ -174,10 +179,159 @@ static void CommandConsoleTask(void *pvParameters)
     }
 }
 
+static void PrintIpmbHistogram(const char *name, const uint32_t *hist)
+{
+    printf("%s (ticks):", name);
+    for (int i = 0; i < IPMB_STATS_HIST_BUCKETS; i++) {
+        printf(" %s%d:%lu", (i == IPMB_STATS_HIST_BUCKETS-1) ? ">=" : "<", (i == IPMB_STATS_HIST_BUCKETS-1) ? (1 << (i-1)) : (1 << i), (unsigned long) hist[i]);
+    }
+    printf("\n");
+}
+
+static BaseType_t IpmbStatsCommand(char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString)
+{
+    BaseType_t lParameterStringLength;
+    const char *param = FreeRTOS_CLIGetParameter(pcCommandString, 1, &lParameterStringLength);
+    const ipmb_stats *stats;
+
+    pcWriteBuffer[0] = '\0';
+
+    if (param != NULL) {
+        if (strncmp(param, "reset", lParameterStringLength) == 0) {
+            ipmb_reset_stats();
+            strcpy(pcWriteBuffer, "OK");
+        } else {
+            snprintf(pcWriteBuffer, xWriteBufferLen, "Unknown option <%.*s>.", (int) lParameterStringLength, param);
+        }
+        return pdFALSE;
+    }
+
+    stats = ipmb_get_stats();
+
+    printf("Requests sent: %lu, responses received: %lu\n", (unsigned long) stats->requests_tx, (unsigned long) stats->responses_rx);
+    printf("Checksum errors: %lu, NAKs: %lu, arbitration lost: %lu\n", (unsigned long) stats->chksum_errors, (unsigned long) stats->naks, (unsigned long) stats->arblost);
+    printf("Retries: %lu, TX failures: %lu, client queue overflows: %lu\n", (unsigned long) stats->retries, (unsigned long) stats->tx_failures, (unsigned long) stats->client_queue_overflows);
+
+    for (int i = 0; i < IPMB_STATS_NETFN_COUNT; i++) {
+        if (stats->requests_rx[i] || stats->responses_tx[i]) {
+            printf("NetFn 0x%02X: %lu requests, %lu responses\n", i << 1, (unsigned long) stats->requests_rx[i], (unsigned long) stats->responses_tx[i]);
+        }
+    }
+
+    PrintIpmbHistogram("Turnaround", stats->turnaround_hist);
+    PrintIpmbHistogram("Handler time", stats->handler_hist);
+
+    return pdFALSE;
+}
+
+static const CLI_Command_Definition_t IpmbStatsCommandDefinition = {
+    "ipmb_stats",
+    "\r\nipmb_stats <reset>\r\n Print the IPMB link statistics, or clear them if <reset> is given\r\n",
+    IpmbStatsCommand,
+    -1
+};
+
+static BaseType_t I2cStatsCommand(char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString)
+{
+    BaseType_t lParameterStringLength, lValueStringLength;
+    const char *param = FreeRTOS_CLIGetParameter(pcCommandString, 1, &lParameterStringLength);
+    const char *value = FreeRTOS_CLIGetParameter(pcCommandString, 2, &lValueStringLength);
+    const i2c_mux_state_t *bus;
+    const i2c_bus_stats_t *stats;
+
+    pcWriteBuffer[0] = '\0';
+
+    if (param != NULL) {
+        if (strncmp(param, "reset", lParameterStringLength) == 0) {
+            i2c_reset_bus_stats();
+            strcpy(pcWriteBuffer, "OK");
+        } else if ((strncmp(param, "maxhold", lParameterStringLength) == 0) && (value != NULL)) {
+            i2c_set_max_hold_time(pdMS_TO_TICKS(strtoul(value, NULL, 10)));
+            strcpy(pcWriteBuffer, "OK");
+        } else {
+            snprintf(pcWriteBuffer, xWriteBufferLen, "Unknown option <%.*s>.", (int) lParameterStringLength, param);
+        }
+        return pdFALSE;
+    }
+
+    printf("Maximum hold time: %lu ms\n", (unsigned long) (i2c_get_max_hold_time() * portTICK_PERIOD_MS));
+
+    for (uint8_t i = 0; (bus = i2c_get_bus_state(i)) != NULL; i++) {
+        stats = &bus->stats;
+
+        printf("I2C%d: holder %s, %lu takes, %lu timeouts\n", bus->i2c_interface, (bus->holder != NULL) ? pcTaskGetName(bus->holder) : "none",
+               (unsigned long) stats->takes, (unsigned long) stats->timeouts);
+        printf("  wait (ms): max %lu, total %lu\n", (unsigned long) (stats->wait_max * portTICK_PERIOD_MS), (unsigned long) (stats->wait_total * portTICK_PERIOD_MS));
+        printf("  hold (ms): max %lu (%s), total %lu, %lu over limit\n", (unsigned long) (stats->hold_max * portTICK_PERIOD_MS), stats->hold_max_task,
+               (unsigned long) (stats->hold_total * portTICK_PERIOD_MS), (unsigned long) stats->hold_overruns);
+        printf("  mux cache: %lu hits, %lu misses\n", (unsigned long) bus->mux_hits, (unsigned long) bus->mux_misses);
+    }
+
+    return pdFALSE;
+}
+
+static const CLI_Command_Definition_t I2cStatsCommandDefinition = {
+    "i2c_stats",
+    "\r\ni2c_stats <reset | maxhold ms>\r\n Print the I2C bus arbitration statistics, clear them if <reset> is given, or set the hold time above which holders are logged\r\n",
+    I2cStatsCommand,
+    -1
+};
+
+static BaseType_t SspStatsCommand(char *pcWriteBuffer, size_t xWriteBufferLen, const char *pcCommandString)
+{
+    BaseType_t lParameterStringLength;
+    const char *param = FreeRTOS_CLIGetParameter(pcCommandString, 1, &lParameterStringLength);
+    const ssp_stats_t *stats;
+    uint32_t kbps;
+
+    pcWriteBuffer[0] = '\0';
+
+    if (param != NULL) {
+        if (strncmp(param, "reset", lParameterStringLength) == 0) {
+            for (uint8_t i = 0; i < MAX_SSP_INTERFACES; i++) {
+                ssp_reset_stats(i);
+            }
+            strcpy(pcWriteBuffer, "OK");
+        } else {
+            snprintf(pcWriteBuffer, xWriteBufferLen, "Unknown option <%.*s>.", (int) lParameterStringLength, param);
+        }
+        return pdFALSE;
+    }
+
+    for (uint8_t i = 0; (stats = ssp_get_stats(i)) != NULL; i++) {
+        printf("SSP%d: %lu DMA transfers, %lu timeouts\n", i, (unsigned long) stats->dma_transfers, (unsigned long) stats->timeouts);
+
+        for (int b = 0; b < SSP_STATS_BUCKETS; b++) {
+            if (stats->transfers[b] == 0) {
+                continue;
+            }
+            /* Throughput from the SSEL assertion to the end of the transfer, setup included */
+            kbps = (stats->cycles[b] > 0) ? (uint32_t) (((uint64_t) stats->bytes[b] * SystemCoreClock) / ((uint64_t) stats->cycles[b] * 1024)) : 0;
+            printf("  %s%lu bytes: %lu transfers, %lu bytes, %lu kB/s\n", (b == SSP_STATS_BUCKETS-1) ? ">=" : "<",
+                   (unsigned long) ((b == SSP_STATS_BUCKETS-1) ? SSP_STATS_BUCKET_LIMIT(b-1) : SSP_STATS_BUCKET_LIMIT(b)),
+                   (unsigned long) stats->transfers[b], (unsigned long) stats->bytes[b], (unsigned long) kbps);
+        }
+    }
+
+    return pdFALSE;
+}
+
+static const CLI_Command_Definition_t SspStatsCommandDefinition = {
+    "ssp_stats",
+    "\r\nssp_stats <reset>\r\n Print the SSP transfer count and throughput by transfer size, or clear them if <reset> is given\r\n",
+    SspStatsCommand,
+    -1
+};
+
 void cli_init(void)
 {
     printf("Command Line Interface enabled!\n");
 
     CommandConsoleStart();
     RegisterCLICommands();
+
+    /* Board independent commands */
+    FreeRTOS_CLIRegisterCommand(&IpmbStatsCommandDefinition);
+    FreeRTOS_CLIRegisterCommand(&I2cStatsCommandDefinition);
+    FreeRTOS_CLIRegisterCommand(&SspStatsCommandDefinition);
 }
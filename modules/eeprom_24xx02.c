@@ -30,72 +30,29 @@
 
 /* FreeRTOS includes */
 #include "FreeRTOS.h"
-#include "string.h"
 
 /* Project Includes */
 #include "eeprom_24xx02.h"
 #include "port.h"
 #include "i2c.h"
 
+static const eeprom_wb_geometry_t eeprom_24xx02_geometry = {
+    .page_size = 8,
+    .addr_len = 1,
+};
+
 size_t eeprom_24xx02_read( uint8_t id, uint16_t address, uint8_t *rx_data, size_t buf_len, TickType_t timeout )
 {
-    uint8_t i2c_addr;
-    uint8_t i2c_interface;
-    uint8_t rx_len = 0;
-
-    if ( rx_data == NULL ) {
-        return 0;
-    }
-
-    if (i2c_take_by_chipid( id, &i2c_addr, &i2c_interface, timeout ) ) {
-        rx_len = xI2CMasterWriteRead( i2c_interface, i2c_addr, (uint8_t *)&address, 1, rx_data, buf_len );
-        i2c_give( i2c_interface );
-    }
-
-    return rx_len;
+    return eeprom_wb_read( id, &eeprom_24xx02_geometry, address, rx_data, buf_len, timeout );
 }
 
 size_t eeprom_24xx02_write( uint8_t id, uint16_t address, uint8_t *tx_data, size_t buf_len, TickType_t timeout )
 {
-    uint8_t i2c_addr;
-    uint8_t i2c_interface;
-    uint8_t bytes_to_write;
-    uint8_t i2c_written = 0;
-    uint8_t page_buf[9];
-    uint16_t curr_addr;
-
-    size_t tx_len = 0;
-
-    if ( tx_data != NULL ) {
-        curr_addr = address;
-
-        while (tx_len < buf_len) {
-            bytes_to_write = 8 - (curr_addr % 8);
-
-            if (bytes_to_write > ( buf_len - tx_len )) {
-                bytes_to_write = ( buf_len - tx_len );
-            }
-            page_buf[0] = (curr_addr) & 0xFF;
-
-            memcpy(&page_buf[1], tx_data+tx_len, bytes_to_write);
-
-            if (i2c_take_by_chipid( id, &i2c_addr, &i2c_interface, timeout)) {
-                /* Write the data */
-                i2c_written = xI2CMasterWrite( i2c_interface, i2c_addr, &page_buf[0] , bytes_to_write+1 );
-                /* When trying to write, the EEPROM will reply with NACKs if it's busy.
-                 * If the i2c receives a NACK when trying to write, the function returns only
-                 * the number of bytes successfully written, and we should increment only this value
-                 * in tx_len and in curr_addr */
-
-                if (i2c_written) {
-                    tx_len += i2c_written - 1; /* Remove byte address from data written size */
-                    curr_addr += i2c_written - 1;
-                }
-                i2c_give( i2c_interface );
-            }
-            vTaskDelay(pdMS_TO_TICKS(1)); /* Avoid too much unnecessary I2C trafic*/
-        }
-    }
+    /* Small writes to the same page are merged and programmed later, see eeprom_wb.h */
+    return eeprom_wb_write( id, &eeprom_24xx02_geometry, address, tx_data, buf_len, timeout );
+}
 
-    return tx_len;
+bool eeprom_24xx02_sync( uint8_t id, TickType_t timeout )
+{
+    return eeprom_wb_sync( id, timeout );
 }
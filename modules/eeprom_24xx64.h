@@ -36,6 +36,8 @@
 #ifndef EEPROM_24XX64_H_
 #define EEPROM_24XX64_H_
 
+#include "eeprom_wb.h"
+
 /**
  * @brief Read serial data from EEPROM_24XX64 EEPROM
  *
@@ -58,8 +60,20 @@ size_t eeprom_24xx64_read( uint8_t id, uint16_t address, uint8_t *rx_data, size_
  * @param buf_len  Buffer max len
  * @param timeout  Write timout
  *
+ * Data may be kept in a page buffer for up to #EEPROM_WB_FLUSH_DELAY, see eeprom_24xx64_sync().
+ *
  * @return Number of bytes actually written
  */
 size_t eeprom_24xx64_write( uint8_t id, uint16_t address, uint8_t *tx_data, size_t buf_len, uint32_t timeout );
 
+/**
+ * @brief Program the pending writes and wait until they are stored in the EEPROM
+ *
+ * @param id       EEPROM chip id
+ * @param timeout  Bus timeout
+ *
+ * @return true if every write accepted so far is stored in the EEPROM
+ */
+bool eeprom_24xx64_sync( uint8_t id, uint32_t timeout );
+
 #endif
@@ -0,0 +1,371 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file   eeprom_wb.c
+ *
+ * @brief  Write-back page buffer shared by the 24xx EEPROM drivers implementation
+ */
+
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "semphr.h"
+#include "string.h"
+
+/* Project Includes */
+#include "port.h"
+#include "eeprom_wb.h"
+#include "i2c.h"
+#include "task_priorities.h"
+
+typedef struct eeprom_wb {
+    uint8_t chip_id;
+    bool used;
+    const eeprom_wb_geometry_t *geometry;
+    TimerHandle_t flush_timer;
+    volatile bool flush_due;        /* Set by the flush timer, cleared by the flush task */
+    TickType_t program_start;       /* Start of the last page write cycle */
+    bool programming;               /* The chip may still be busy with its last page write */
+    uint16_t start;                 /* Address of the first buffered byte */
+    uint8_t len;                    /* Amount of buffered bytes, 0 if nothing is pending */
+    uint8_t frame[2 + EEPROM_WB_MAX_PAGE];  /* Address bytes followed by the buffered data */
+    uint32_t page_programs;
+    uint32_t errors;
+} eeprom_wb_t;
+
+static eeprom_wb_t buffers[EEPROM_WB_MAX_CHIPS];
+
+TaskHandle_t vTaskEepromWB_Handle;
+
+/* Given by the flush timers, the page writes themselves run in vTaskEepromWB */
+static SemaphoreHandle_t flush_sem;
+static bool flush_task_started;
+
+/* Buffered data lives after the (at most two) address bytes */
+#define WB_DATA(wb)     (&(wb)->frame[2])
+
+static eeprom_wb_t * eeprom_wb_find( uint8_t chip_id )
+{
+    for ( uint8_t i = 0; i < EEPROM_WB_MAX_CHIPS; i++ ) {
+        if ( buffers[i].used && ( buffers[i].chip_id == chip_id ) ) {
+            return &buffers[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Find the buffer of a chip, allocating one if needed
+ *
+ * @return Pointer to the buffer, or NULL if the table is full
+ */
+static eeprom_wb_t * eeprom_wb_get( uint8_t chip_id, const eeprom_wb_geometry_t *geometry )
+{
+    eeprom_wb_t *wb;
+
+    /* Chips on different buses may allocate at the same time */
+    taskENTER_CRITICAL();
+    wb = eeprom_wb_find( chip_id );
+    for ( uint8_t i = 0; ( wb == NULL ) && ( i < EEPROM_WB_MAX_CHIPS ); i++ ) {
+        if ( !buffers[i].used ) {
+            wb = &buffers[i];
+            wb->chip_id = chip_id;
+            wb->geometry = geometry;
+            wb->used = true;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return wb;
+}
+
+/**
+ * @brief Wait for the end of the last page write cycle by polling the chip until it acknowledges its address
+ */
+static void eeprom_wb_wait_ready( eeprom_wb_t *wb, uint8_t i2c_id, uint8_t i2c_addr )
+{
+    uint8_t dummy;
+
+    while ( wb->programming ) {
+        /* Past the deadline the chip is done, or gone */
+        if ( ( xTaskGetTickCount() - wb->program_start ) > EEPROM_WB_WRITE_CYCLE_MAX ) {
+            wb->programming = false;
+            break;
+        }
+
+        if ( xI2CMasterRead( i2c_id, i2c_addr, &dummy, 1 ) == 1 ) {
+            wb->programming = false;
+            break;
+        }
+
+        vTaskDelay( 1 );
+    }
+}
+
+/**
+ * @brief Program the buffered data, must be called with the chip bus taken
+ *
+ * The data is kept in the buffer if the page write fails, so it is written again by the next flush.
+ */
+static bool eeprom_wb_program( eeprom_wb_t *wb, uint8_t i2c_id, uint8_t i2c_addr )
+{
+    uint8_t addr_len = wb->geometry->addr_len;
+    int frame_len = addr_len + wb->len;
+    int written;
+
+    if ( wb->len == 0 ) {
+        return true;
+    }
+
+    eeprom_wb_wait_ready( wb, i2c_id, i2c_addr );
+
+    wb->frame[0] = ( wb->start >> 8 ) & 0xFF;
+    wb->frame[1] = wb->start & 0xFF;
+
+    written = xI2CMasterWrite( i2c_id, i2c_addr, &wb->frame[2 - addr_len], frame_len );
+
+    /* The chip starts a write cycle as soon as it latched a data byte */
+    if ( written > addr_len ) {
+        wb->programming = true;
+        wb->program_start = xTaskGetTickCount();
+        wb->page_programs++;
+    }
+
+    if ( written != frame_len ) {
+        wb->errors++;
+        return false;
+    }
+
+    wb->len = 0;
+    return true;
+}
+
+/* Runs in the timer service task, which must not be held up by bus transfers */
+static void eeprom_wb_flush_expired( TimerHandle_t timer )
+{
+    eeprom_wb_t *wb = (eeprom_wb_t *) pvTimerGetTimerID( timer );
+
+    wb->flush_due = true;
+    xSemaphoreGive( flush_sem );
+}
+
+/* A buffer that could not be programmed (busy bus or failed page write) is tried again after another flush delay */
+void vTaskEepromWB( void * Parameters )
+{
+    eeprom_wb_t *wb;
+    uint8_t i2c_addr, i2c_id;
+    bool ok;
+
+    for ( ;; ) {
+        xSemaphoreTake( flush_sem, portMAX_DELAY );
+
+        for ( uint8_t i = 0; i < EEPROM_WB_MAX_CHIPS; i++ ) {
+            wb = &buffers[i];
+
+            if ( !wb->used || !wb->flush_due ) {
+                continue;
+            }
+            wb->flush_due = false;
+
+            if ( !i2c_take_by_chipid( wb->chip_id, &i2c_addr, &i2c_id, EEPROM_WB_BUS_TIMEOUT ) ) {
+                xTimerReset( wb->flush_timer, 0 );
+                continue;
+            }
+
+            ok = eeprom_wb_program( wb, i2c_id, i2c_addr );
+
+            if ( !ok ) {
+                xTimerReset( wb->flush_timer, 0 );
+            }
+
+            i2c_give( i2c_id );
+        }
+    }
+}
+
+size_t eeprom_wb_write( uint8_t chip_id, const eeprom_wb_geometry_t *geometry, uint16_t address, const uint8_t *tx_data, size_t len, TickType_t timeout )
+{
+    eeprom_wb_t *wb = eeprom_wb_get( chip_id, geometry );
+    uint8_t page_size = geometry->page_size;
+    uint8_t i2c_addr, i2c_id;
+    uint16_t new_start, new_end;
+    size_t chunk;
+    size_t written = 0;
+
+    if ( ( wb == NULL ) || ( tx_data == NULL ) || ( page_size > EEPROM_WB_MAX_PAGE ) ) {
+        return 0;
+    }
+
+    if ( !i2c_take_by_chipid( chip_id, &i2c_addr, &i2c_id, timeout ) ) {
+        return 0;
+    }
+
+    /* Chips on different buses may be written at the same time, only one of them starts the flush task */
+    if ( !__atomic_exchange_n( &flush_task_started, true, __ATOMIC_ACQ_REL ) ) {
+        flush_sem = xSemaphoreCreateBinary();
+        if ( flush_sem != NULL ) {
+            xTaskCreate( vTaskEepromWB, "EEPROM WB", 150, (void *) NULL, tskEEPROM_WB_PRIORITY, &vTaskEepromWB_Handle );
+        }
+    }
+
+    if ( ( wb->flush_timer == NULL ) && ( vTaskEepromWB_Handle != NULL ) ) {
+        wb->flush_timer = xTimerCreate( "EEPROM WB", EEPROM_WB_FLUSH_DELAY, pdFALSE, wb, eeprom_wb_flush_expired );
+    }
+
+    while ( written < len ) {
+        chunk = page_size - ( address % page_size );
+        if ( chunk > ( len - written ) ) {
+            chunk = len - written;
+        }
+
+        /* Only data that extends or overlaps the buffered range of the same page can be merged into it */
+        if ( ( wb->len > 0 ) &&
+             ( ( ( address / page_size ) != ( wb->start / page_size ) ) ||
+               ( address > wb->start + wb->len ) || ( address + chunk < wb->start ) ) ) {
+            /* The buffered data is kept for a later flush, but there is no room for the new data */
+            if ( !eeprom_wb_program( wb, i2c_id, i2c_addr ) ) {
+                break;
+            }
+        }
+
+        if ( wb->len == 0 ) {
+            wb->start = address;
+            wb->len = chunk;
+            memcpy( WB_DATA(wb), &tx_data[written], chunk );
+        } else {
+            new_start = ( address < wb->start ) ? address : wb->start;
+            new_end = ( address + chunk > wb->start + wb->len ) ? address + chunk : wb->start + wb->len;
+
+            memmove( WB_DATA(wb) + ( wb->start - new_start ), WB_DATA(wb), wb->len );
+            memcpy( WB_DATA(wb) + ( address - new_start ), &tx_data[written], chunk );
+            wb->start = new_start;
+            wb->len = new_end - new_start;
+        }
+
+        /* Nothing else can be merged into a full page, or without a timer to flush it later */
+        if ( ( wb->len == page_size ) || ( wb->flush_timer == NULL ) ) {
+            if ( !eeprom_wb_program( wb, i2c_id, i2c_addr ) ) {
+                /* Report the failure, a retry of this write merges into the data still buffered */
+                break;
+            }
+        }
+
+        written += chunk;
+        address += chunk;
+    }
+
+    if ( ( wb->len > 0 ) && ( wb->flush_timer != NULL ) ) {
+        xTimerReset( wb->flush_timer, 0 );
+    }
+
+    i2c_give( i2c_id );
+
+    return written;
+}
+
+size_t eeprom_wb_read( uint8_t chip_id, const eeprom_wb_geometry_t *geometry, uint16_t address, uint8_t *rx_data, size_t len, TickType_t timeout )
+{
+    eeprom_wb_t *wb = eeprom_wb_find( chip_id );
+    uint8_t i2c_addr, i2c_id;
+    uint8_t addr8[2];
+    uint8_t addr_len = geometry->addr_len;
+    uint16_t from, to;
+    int rx_len;
+
+    if ( rx_data == NULL ) {
+        return 0;
+    }
+
+    if ( !i2c_take_by_chipid( chip_id, &i2c_addr, &i2c_id, timeout ) ) {
+        return 0;
+    }
+
+    if ( wb != NULL ) {
+        eeprom_wb_wait_ready( wb, i2c_id, i2c_addr );
+    }
+
+    addr8[0] = ( address >> 8 ) & 0xFF;
+    addr8[1] = address & 0xFF;
+
+    rx_len = xI2CMasterWriteRead( i2c_id, i2c_addr, &addr8[2 - addr_len], addr_len, rx_data, len );
+
+    /* Bytes waiting in the page buffer are newer than the EEPROM contents */
+    if ( ( wb != NULL ) && ( wb->len > 0 ) && ( rx_len > 0 ) ) {
+        from = ( wb->start > address ) ? wb->start : address;
+        to = ( wb->start + wb->len < address + rx_len ) ? wb->start + wb->len : address + rx_len;
+
+        if ( from < to ) {
+            memcpy( &rx_data[from - address], WB_DATA(wb) + ( from - wb->start ), to - from );
+        }
+    }
+
+    i2c_give( i2c_id );
+
+    return rx_len;
+}
+
+bool eeprom_wb_sync( uint8_t chip_id, TickType_t timeout )
+{
+    eeprom_wb_t *wb = eeprom_wb_find( chip_id );
+    uint8_t i2c_addr, i2c_id;
+    bool ok;
+
+    if ( wb == NULL ) {
+        return true;
+    }
+
+    if ( !i2c_take_by_chipid( chip_id, &i2c_addr, &i2c_id, timeout ) ) {
+        return false;
+    }
+
+    ok = eeprom_wb_program( wb, i2c_id, i2c_addr );
+    eeprom_wb_wait_ready( wb, i2c_id, i2c_addr );
+
+    /* Data that could not be programmed is still flushed later */
+    if ( wb->flush_timer != NULL ) {
+        if ( ok ) {
+            xTimerStop( wb->flush_timer, 0 );
+        } else {
+            xTimerReset( wb->flush_timer, 0 );
+        }
+    }
+
+    i2c_give( i2c_id );
+
+    return ok;
+}
+
+bool eeprom_wb_get_stats( uint8_t chip_id, uint32_t *page_programs, uint32_t *errors )
+{
+    eeprom_wb_t *wb = eeprom_wb_find( chip_id );
+
+    if ( wb == NULL ) {
+        return false;
+    }
+
+    if ( page_programs ) {
+        *page_programs = wb->page_programs;
+    }
+    if ( errors ) {
+        *errors = wb->errors;
+    }
+    return true;
+}
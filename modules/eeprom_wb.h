@@ -0,0 +1,137 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file   eeprom_wb.h
+ *
+ * @brief  Write-back page buffer shared by the 24xx EEPROM drivers
+ *
+ * Small writes that extend or overlap the data already buffered for the same page are merged in RAM and
+ * programmed together, so a run of single-byte writes costs one page write cycle instead of one per byte.
+ * The buffered page is programmed when a write targets another page (or a non adjacent range of the same page),
+ * when it becomes full, after #EEPROM_WB_FLUSH_DELAY without new writes (by a low priority flush task), or on
+ * eeprom_wb_sync(). A page write that fails keeps its data in the buffer to be written again by the next flush;
+ * a write that needs the buffer while it still holds such data fails instead of dropping it.
+ *
+ * Instead of waiting a fixed delay after each page write, the next access to the chip polls it until it
+ * acknowledges its address again (ACK polling), for at most #EEPROM_WB_WRITE_CYCLE_MAX.
+ *
+ * Buffers are only accessed with the chip bus taken, which serializes the writers and the flush task.
+ */
+
+#ifndef EEPROM_WB_H_
+#define EEPROM_WB_H_
+
+#include "FreeRTOS.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Maximum amount of EEPROM chips with a write-back buffer
+ */
+#define EEPROM_WB_MAX_CHIPS         4
+
+/**
+ * @brief Largest supported page size (in bytes)
+ */
+#define EEPROM_WB_MAX_PAGE          32
+
+/**
+ * @brief A buffered page is programmed once no write has extended it for this long (in ticks)
+ */
+#define EEPROM_WB_FLUSH_DELAY       pdMS_TO_TICKS(20)
+
+/**
+ * @brief Maximum time the flush task waits for the chip bus before trying again later (in ticks)
+ */
+#define EEPROM_WB_BUS_TIMEOUT       pdMS_TO_TICKS(50)
+
+/**
+ * @brief ACK polling deadline after a page write (the 24xx write cycle time is 5 ms at most) (in ticks)
+ */
+#define EEPROM_WB_WRITE_CYCLE_MAX   pdMS_TO_TICKS(10)
+
+/**
+ * @brief EEPROM chip geometry
+ */
+typedef struct eeprom_wb_geometry {
+    uint8_t page_size;      /**< Page size (in bytes), at most #EEPROM_WB_MAX_PAGE */
+    uint8_t addr_len;       /**< Number of address bytes (1 or 2) */
+} eeprom_wb_geometry_t;
+
+/**
+ * @brief Write data through the page buffer
+ *
+ * @param chip_id  EEPROM chip id
+ * @param geometry Chip geometry
+ * @param address  Write start address
+ * @param tx_data  Buffer holding the data to write
+ * @param len      Amount of bytes to write
+ * @param timeout  Maximum time to wait for the chip bus (in ticks)
+ *
+ * @return Number of bytes accepted (either buffered or programmed)
+ */
+size_t eeprom_wb_write( uint8_t chip_id, const eeprom_wb_geometry_t *geometry, uint16_t address, const uint8_t *tx_data, size_t len, TickType_t timeout );
+
+/**
+ * @brief Read data from the EEPROM, including the bytes still held in the page buffer
+ *
+ * @param chip_id  EEPROM chip id
+ * @param geometry Chip geometry
+ * @param address  Read start address
+ * @param rx_data  Buffer to store the data
+ * @param len      Amount of bytes to read
+ * @param timeout  Maximum time to wait for the chip bus (in ticks)
+ *
+ * @return Number of bytes actually read
+ */
+size_t eeprom_wb_read( uint8_t chip_id, const eeprom_wb_geometry_t *geometry, uint16_t address, uint8_t *rx_data, size_t len, TickType_t timeout );
+
+/**
+ * @brief Program the buffered page (if any) and wait for the end of its write cycle
+ *
+ * @param chip_id  EEPROM chip id
+ * @param timeout  Maximum time to wait for the chip bus (in ticks)
+ *
+ * @return true if every write accepted so far is stored in the EEPROM
+ */
+bool eeprom_wb_sync( uint8_t chip_id, TickType_t timeout );
+
+/**
+ * @brief Get the write statistics of an EEPROM chip
+ *
+ * @param[in]  chip_id       EEPROM chip id
+ * @param[out] page_programs Number of page write cycles started
+ * @param[out] errors        Number of page writes that failed (their data is kept and written again)
+ *
+ * @return false if the chip was never written
+ */
+bool eeprom_wb_get_stats( uint8_t chip_id, uint32_t *page_programs, uint32_t *errors );
+
+/**
+ * @brief Flush task, programs the buffers whose #EEPROM_WB_FLUSH_DELAY expired
+ *
+ * Created on the first write.
+ *
+ * @param Parameters Pointer to parameter list passed to task upon initialization (not used here)
+ */
+void vTaskEepromWB( void * Parameters );
+
+#endif
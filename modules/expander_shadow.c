@@ -0,0 +1,200 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file   expander_shadow.c
+ *
+ * @brief  Shadow copies of the GPIO expanders registers implementation
+ */
+
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Project Includes */
+#include "port.h"
+#include "expander_shadow.h"
+#include "i2c.h"
+
+typedef struct expander_shadow {
+    uint8_t chip_id;
+    uint8_t reg;
+    uint8_t value;
+    uint8_t used:1;
+    uint8_t valid:1;
+} expander_shadow_t;
+
+static expander_shadow_t shadows[EXPANDER_SHADOW_MAX];
+
+/**
+ * @brief Find the shadow of a register, allocating one if needed
+ *
+ * @return Pointer to the shadow, or NULL if the table is full (the register is then accessed uncached)
+ */
+static expander_shadow_t * expander_shadow_get( uint8_t chip_id, uint8_t reg )
+{
+    expander_shadow_t *shadow = NULL;
+
+    /* Chips on different buses may allocate at the same time */
+    taskENTER_CRITICAL();
+    for ( uint8_t i = 0; i < EXPANDER_SHADOW_MAX; i++ ) {
+        if ( shadows[i].used && ( shadows[i].chip_id == chip_id ) && ( shadows[i].reg == reg ) ) {
+            shadow = &shadows[i];
+            break;
+        }
+        if ( !shadows[i].used && ( shadow == NULL ) ) {
+            shadow = &shadows[i];
+        }
+    }
+    if ( ( shadow != NULL ) && !shadow->used ) {
+        shadow->chip_id = chip_id;
+        shadow->reg = reg;
+        shadow->valid = 0;
+        shadow->used = 1;
+    }
+    taskEXIT_CRITICAL();
+
+    return shadow;
+}
+
+static bool expander_raw_read( uint8_t i2c_id, uint8_t i2c_addr, uint8_t reg, uint8_t *data )
+{
+    i2c_xfer_t xfer = { &reg, 1, data, 1 };
+
+    if ( reg == EXPANDER_NO_REG ) {
+        xfer.tx_len = 0;
+    }
+
+    return ( i2c_transfer( i2c_id, i2c_addr, &xfer, 1 ) == 1 );
+}
+
+static bool expander_raw_write( uint8_t i2c_id, uint8_t i2c_addr, uint8_t reg, uint8_t data )
+{
+    uint8_t cmd[2] = { reg, data };
+    i2c_xfer_t xfer = { cmd, sizeof(cmd), NULL, 0 };
+
+    if ( reg == EXPANDER_NO_REG ) {
+        xfer.tx = &cmd[1];
+        xfer.tx_len = 1;
+    }
+
+    return ( i2c_transfer( i2c_id, i2c_addr, &xfer, 1 ) == 1 );
+}
+
+mmc_err expander_update_reg( uint8_t chip_id, uint8_t reg, uint8_t mask, uint8_t data )
+{
+    expander_shadow_t *shadow = expander_shadow_get( chip_id, reg );
+    uint8_t i2c_addr, i2c_id;
+    uint8_t value = 0;
+    mmc_err err = MMC_OK;
+
+    if ( !i2c_take_by_chipid( chip_id, &i2c_addr, &i2c_id, EXPANDER_BUS_TIMEOUT ) ) {
+        return MMC_TIMEOUT_ERR;
+    }
+
+    if ( ( shadow != NULL ) && shadow->valid ) {
+        value = shadow->value;
+    } else if ( !expander_raw_read( i2c_id, i2c_addr, reg, &value ) ) {
+        err = MMC_IO_ERR;
+    }
+
+    if ( err == MMC_OK ) {
+        data = ( value & ~mask ) | ( data & mask );
+
+        if ( ( shadow == NULL ) || !shadow->valid || ( data != value ) ) {
+            if ( !expander_raw_write( i2c_id, i2c_addr, reg, data ) ) {
+                err = MMC_IO_ERR;
+            }
+        }
+    }
+
+    if ( shadow != NULL ) {
+        shadow->value = data;
+        shadow->valid = ( err == MMC_OK );
+    }
+
+    i2c_give( i2c_id );
+
+    return err;
+}
+
+mmc_err expander_write_reg( uint8_t chip_id, uint8_t reg, uint8_t data )
+{
+    expander_shadow_t *shadow = expander_shadow_get( chip_id, reg );
+    uint8_t i2c_addr, i2c_id;
+    bool ok;
+
+    if ( !i2c_take_by_chipid( chip_id, &i2c_addr, &i2c_id, EXPANDER_BUS_TIMEOUT ) ) {
+        return MMC_TIMEOUT_ERR;
+    }
+
+    ok = expander_raw_write( i2c_id, i2c_addr, reg, data );
+
+    if ( shadow != NULL ) {
+        shadow->value = data;
+        shadow->valid = ok;
+    }
+
+    i2c_give( i2c_id );
+
+    return ok ? MMC_OK : MMC_IO_ERR;
+}
+
+mmc_err expander_read_reg( uint8_t chip_id, uint8_t reg, uint8_t *data )
+{
+    expander_shadow_t *shadow = expander_shadow_get( chip_id, reg );
+    uint8_t i2c_addr, i2c_id;
+    bool ok;
+
+    if ( data == NULL ) {
+        return MMC_INVALID_ARG_ERR;
+    }
+
+    /* A valid shadow holds what the chip was last programmed with, no need to wait for the bus */
+    if ( ( shadow != NULL ) && shadow->valid ) {
+        *data = shadow->value;
+        return MMC_OK;
+    }
+
+    if ( !i2c_take_by_chipid( chip_id, &i2c_addr, &i2c_id, EXPANDER_BUS_TIMEOUT ) ) {
+        return MMC_TIMEOUT_ERR;
+    }
+
+    ok = expander_raw_read( i2c_id, i2c_addr, reg, data );
+
+    if ( ( shadow != NULL ) && !shadow->valid ) {
+        shadow->value = *data;
+        shadow->valid = ok;
+    }
+
+    i2c_give( i2c_id );
+
+    return ok ? MMC_OK : MMC_IO_ERR;
+}
+
+void expander_shadow_invalidate( uint8_t chip_id )
+{
+    taskENTER_CRITICAL();
+    for ( uint8_t i = 0; i < EXPANDER_SHADOW_MAX; i++ ) {
+        if ( shadows[i].used && ( shadows[i].chip_id == chip_id ) ) {
+            shadows[i].valid = 0;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
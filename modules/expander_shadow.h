@@ -0,0 +1,99 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file   expander_shadow.h
+ *
+ * @brief  Shadow copies of the GPIO expanders output and direction registers
+ *
+ * The expander drivers keep the last value written to their output and direction registers, so that
+ * changing some pins is a single register write (or no write at all when the pins already hold the
+ * requested value) instead of a read-modify-write over I2C.
+ *
+ * Shadows are only accessed with the chip bus taken, which serializes the updates of each register.
+ */
+
+#ifndef EXPANDER_SHADOW_H_
+#define EXPANDER_SHADOW_H_
+
+#include "FreeRTOS.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include "mmc_error.h"
+
+/**
+ * @brief Maximum amount of shadowed registers (over all chips)
+ */
+#define EXPANDER_SHADOW_MAX         16
+
+/**
+ * @brief Maximum time to wait for the expander bus (in ticks)
+ */
+#define EXPANDER_BUS_TIMEOUT        pdMS_TO_TICKS(50)
+
+/**
+ * @brief Register address of chips that have a single, unaddressed, port register (e.g. PCF8574)
+ */
+#define EXPANDER_NO_REG             0xFF
+
+/**
+ * @brief Update some bits of an expander register
+ *
+ * The register is read from the chip only if it has no valid shadow yet, and written only when the
+ * masked bits differ from the shadow. A failed transfer invalidates the shadow.
+ *
+ * @param chip_id Chip ID
+ * @param reg     Register address (or #EXPANDER_NO_REG)
+ * @param mask    Bits to update
+ * @param data    New value of the masked bits
+ *
+ * @return MMC_OK if success, an error code otherwise
+ */
+mmc_err expander_update_reg( uint8_t chip_id, uint8_t reg, uint8_t mask, uint8_t data );
+
+/**
+ * @brief Write a whole expander register and refresh its shadow
+ *
+ * @param chip_id Chip ID
+ * @param reg     Register address (or #EXPANDER_NO_REG)
+ * @param data    Value to write
+ *
+ * @return MMC_OK if success, an error code otherwise
+ */
+mmc_err expander_write_reg( uint8_t chip_id, uint8_t reg, uint8_t data );
+
+/**
+ * @brief Read a shadowed expander register, reading the chip only if it has no valid shadow yet
+ *
+ * @param[in]  chip_id Chip ID
+ * @param[in]  reg     Register address (or #EXPANDER_NO_REG)
+ * @param[out] data    Register value
+ *
+ * @return MMC_OK if success, an error code otherwise
+ */
+mmc_err expander_read_reg( uint8_t chip_id, uint8_t reg, uint8_t *data );
+
+/**
+ * @brief Drop the shadows of a chip (e.g. after it was reset or power cycled)
+ *
+ * @param chip_id Chip ID
+ */
+void expander_shadow_invalidate( uint8_t chip_id );
+
+#endif
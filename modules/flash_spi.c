@@ -93,7 +93,7 @@ uint8_t flash_read_lock_reg( uint32_t address )
     /* Size of rx buffer must be the sum of the length of the data expected to receive and the length of the sent data */
     uint8_t rx_buff[5] = {0};
 
-    ssp_write_read( FLASH_SPI, &tx_buff[0], sizeof(tx_buff), &rx_buff[0], sizeof(rx_buff), portMAX_DELAY );
+    ssp_write_read( FLASH_SPI, &tx_buff[0], sizeof(tx_buff), &rx_buff[0], 1, portMAX_DELAY );
 
     return rx_buff[4];
 }
@@ -0,0 +1,265 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file   flash_writer.c
+ *
+ * @brief  Pipelined payload SPI flash programming for HPM uploads implementation
+ */
+
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "string.h"
+
+/* Project Includes */
+#include "port.h"
+#include "flash_writer.h"
+#include "flash_spi.h"
+#include "ipmi.h"
+#include "task_priorities.h"
+#include "uart_debug.h"
+
+/* Each buffer holds a page plus the part of the last block that did not fit in it */
+#define FLASH_WRITER_BUF_SIZE   ( FLASH_WRITER_PAGE_SIZE + FLASH_WRITER_SPILL_SIZE )
+
+TaskHandle_t vTaskFlashWriter_Handle;
+
+static SemaphoreHandle_t writer_mutex;
+
+/* Given whenever there is work for the writer task */
+static SemaphoreHandle_t writer_sem;
+
+static uint8_t * writer_buf[2];
+
+/* Buffer being filled, the other one belongs to the writer task while prog_len is not zero */
+static uint8_t fill_idx;
+static uint16_t fill_len;
+static uint32_t fill_addr;
+
+static uint16_t prog_len;
+static uint32_t prog_addr;
+
+static bool erase_pending;
+static bool flush_pending;
+
+static uint32_t pages_written;
+static TickType_t upload_start;
+
+/**
+ * @brief Hands the buffer being filled to the writer task, if it is idle and the buffer is ready
+ *
+ * Must be called with writer_mutex taken.
+ */
+static void writer_handoff( void )
+{
+    uint16_t len = ( fill_len > FLASH_WRITER_PAGE_SIZE ) ? FLASH_WRITER_PAGE_SIZE : fill_len;
+
+    if ( erase_pending || ( prog_len != 0 ) || ( len == 0 ) ) {
+        return;
+    }
+
+    /* Partial pages are only programmed at the end of the upload */
+    if ( ( len < FLASH_WRITER_PAGE_SIZE ) && !flush_pending ) {
+        return;
+    }
+
+    prog_addr = fill_addr;
+    prog_len = len;
+
+    /* Carry the spill-over to the start of the other buffer */
+    fill_idx ^= 1;
+    memcpy( writer_buf[fill_idx], writer_buf[fill_idx ^ 1] + len, fill_len - len );
+    fill_len -= len;
+    fill_addr += len;
+
+    xSemaphoreGive( writer_sem );
+}
+
+static bool writer_busy( void )
+{
+    return erase_pending || ( prog_len != 0 ) || ( fill_len >= FLASH_WRITER_PAGE_SIZE ) ||
+        ( flush_pending && ( fill_len != 0 ) );
+}
+
+uint8_t flash_writer_start( bool bulk_erase )
+{
+    if ( vTaskFlashWriter_Handle == NULL ) {
+        writer_mutex = xSemaphoreCreateMutex();
+        writer_sem = xSemaphoreCreateBinary();
+        writer_buf[0] = pvPortMalloc( FLASH_WRITER_BUF_SIZE );
+        writer_buf[1] = pvPortMalloc( FLASH_WRITER_BUF_SIZE );
+
+        if ( ( writer_mutex == NULL ) || ( writer_sem == NULL ) || ( writer_buf[0] == NULL ) || ( writer_buf[1] == NULL ) ||
+             ( xTaskCreate( vTaskFlashWriter, "FlashWriter", 256, (void *) NULL, tskFLASH_WRITER_PRIORITY, &vTaskFlashWriter_Handle ) != pdPASS ) ) {
+            printf( "[HPM] Not enough memory for the flash writer!\n" );
+            return IPMI_CC_OUT_OF_SPACE;
+        }
+    }
+
+    xSemaphoreTake( writer_mutex, portMAX_DELAY );
+
+    fill_len = 0;
+    fill_addr = 0;
+    flush_pending = false;
+    pages_written = 0;
+    upload_start = xTaskGetTickCount();
+
+    if ( bulk_erase ) {
+        /* A page of a previous upload not programmed yet would be written over the erased flash */
+        erase_pending = true;
+        prog_len = 0;
+        xSemaphoreGive( writer_sem );
+    }
+
+    xSemaphoreGive( writer_mutex );
+
+    return IPMI_CC_COMMAND_IN_PROGRESS;
+}
+
+uint8_t flash_writer_append( const uint8_t * data, uint16_t size )
+{
+    TickType_t start = xTaskGetTickCount();
+    uint8_t cc;
+
+    if ( ( vTaskFlashWriter_Handle == NULL ) || ( size > FLASH_WRITER_SPILL_SIZE ) ) {
+        return IPMI_CC_UNSPECIFIED_ERROR;
+    }
+
+    xSemaphoreTake( writer_mutex, portMAX_DELAY );
+
+    /* Only reached if the MCH does not wait for a "command in progress" block to complete */
+    while ( fill_len + size > FLASH_WRITER_BUF_SIZE ) {
+        xSemaphoreGive( writer_mutex );
+
+        if ( ( xTaskGetTickCount() - start ) >= FLASH_WRITER_TIMEOUT ) {
+            return IPMI_CC_TIMEOUT;
+        }
+        vTaskDelay( 1 );
+
+        xSemaphoreTake( writer_mutex, portMAX_DELAY );
+    }
+
+    memcpy( writer_buf[fill_idx] + fill_len, data, size );
+    fill_len += size;
+
+    writer_handoff();
+
+    cc = ( fill_len >= FLASH_WRITER_PAGE_SIZE ) ? IPMI_CC_COMMAND_IN_PROGRESS : IPMI_CC_OK;
+
+    xSemaphoreGive( writer_mutex );
+
+    return cc;
+}
+
+uint8_t flash_writer_finish( void )
+{
+    uint8_t cc;
+
+    if ( vTaskFlashWriter_Handle == NULL ) {
+        return IPMI_CC_UNSPECIFIED_ERROR;
+    }
+
+    xSemaphoreTake( writer_mutex, portMAX_DELAY );
+
+    flush_pending = true;
+    writer_handoff();
+
+    /* Let the writer task report the upload time, even if every page was already programmed */
+    xSemaphoreGive( writer_sem );
+
+    cc = writer_busy() ? IPMI_CC_COMMAND_IN_PROGRESS : IPMI_CC_OK;
+
+    xSemaphoreGive( writer_mutex );
+
+    return cc;
+}
+
+uint8_t flash_writer_status( void )
+{
+    bool busy;
+
+    if ( vTaskFlashWriter_Handle == NULL ) {
+        return IPMI_CC_OK;
+    }
+
+    taskENTER_CRITICAL();
+    busy = writer_busy();
+    taskEXIT_CRITICAL();
+
+    return busy ? IPMI_CC_COMMAND_IN_PROGRESS : IPMI_CC_OK;
+}
+
+void vTaskFlashWriter( void * Parameters )
+{
+    uint8_t * page;
+    bool erase;
+
+    for ( ;; ) {
+        xSemaphoreTake( writer_sem, portMAX_DELAY );
+
+        xSemaphoreTake( writer_mutex, portMAX_DELAY );
+        erase = erase_pending;
+        xSemaphoreGive( writer_mutex );
+
+        if ( erase ) {
+            /* A previous page program may still be running */
+            while ( is_flash_busy() ) {
+                vTaskDelay( 1 );
+            }
+
+            flash_bulk_erase();
+
+            while ( is_flash_busy() ) {
+                vTaskDelay( FLASH_WRITER_ERASE_POLL );
+            }
+
+            xSemaphoreTake( writer_mutex, portMAX_DELAY );
+            erase_pending = false;
+            writer_handoff();
+            xSemaphoreGive( writer_mutex );
+        }
+
+        /* The buffer and length are not touched by other tasks while prog_len is not zero */
+        while ( prog_len != 0 ) {
+            page = writer_buf[fill_idx ^ 1];
+
+            flash_program_page( prog_addr, page, prog_len );
+
+            while ( is_flash_busy() ) {
+                vTaskDelay( 1 );
+            }
+
+            xSemaphoreTake( writer_mutex, portMAX_DELAY );
+            prog_len = 0;
+            pages_written++;
+            writer_handoff();
+            xSemaphoreGive( writer_mutex );
+        }
+
+        xSemaphoreTake( writer_mutex, portMAX_DELAY );
+        if ( flush_pending && !writer_busy() ) {
+            flush_pending = false;
+            printf( "[HPM] %lu pages written in %lu ms\n", (unsigned long) pages_written,
+                    (unsigned long) ( ( xTaskGetTickCount() - upload_start ) * portTICK_PERIOD_MS ) );
+        }
+        xSemaphoreGive( writer_mutex );
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file   flash_writer.h
+ *
+ * @brief  Pipelined payload SPI flash programming for HPM uploads
+ *
+ * Uploaded data is collected in one of two page buffers while a low priority task programs the other one,
+ * so the next firmware block is accepted while the previous page is still being written to the flash.
+ * The upload is only held back (through the HPM "command in progress" completion code) when a full page
+ * is waiting for the writer task, or while the flash is being erased.
+ */
+
+#ifndef FLASH_WRITER_H_
+#define FLASH_WRITER_H_
+
+#include "FreeRTOS.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Size of a flash program operation
+ */
+#define FLASH_WRITER_PAGE_SIZE          256
+
+/**
+ * @brief Largest chunk accepted by flash_writer_append() (one HPM block)
+ */
+#define FLASH_WRITER_SPILL_SIZE         64
+
+/**
+ * @brief Maximum time flash_writer_append() waits for room in the page buffers (in ticks)
+ */
+#define FLASH_WRITER_TIMEOUT            pdMS_TO_TICKS(100)
+
+/**
+ * @brief Polling period of the flash status while it is being erased (in ticks)
+ */
+#define FLASH_WRITER_ERASE_POLL         pdMS_TO_TICKS(100)
+
+/**
+ * @brief Starts a new upload, programming pages from address 0
+ *
+ * Creates the writer task on the first call. Pages still being programmed from a previous upload are
+ * finished first.
+ *
+ * @param bulk_erase Erase the whole flash (in the writer task) before programming the first page
+ *
+ * @return IPMI_CC_COMMAND_IN_PROGRESS if the upload was started, IPMI_CC_OUT_OF_SPACE otherwise
+ */
+uint8_t flash_writer_start( bool bulk_erase );
+
+/**
+ * @brief Appends data to the image being uploaded
+ *
+ * @param data Data to be written
+ * @param size Length of @p data, up to #FLASH_WRITER_SPILL_SIZE
+ *
+ * @return IPMI_CC_OK if the data was queued, IPMI_CC_COMMAND_IN_PROGRESS if it was queued but a full page is
+ * waiting for the writer task, IPMI_CC_TIMEOUT if there was no room for it
+ */
+uint8_t flash_writer_append( const uint8_t * data, uint16_t size );
+
+/**
+ * @brief Hands the last partial page to the writer task
+ *
+ * @return IPMI_CC_COMMAND_IN_PROGRESS if there are pages left to program, IPMI_CC_OK otherwise
+ */
+uint8_t flash_writer_finish( void );
+
+/**
+ * @brief Checks if the writer task has pages left to program
+ *
+ * Does not access the SPI bus, so it may be called from the IPMI handlers.
+ *
+ * @return IPMI_CC_COMMAND_IN_PROGRESS while the flash is being erased or there are pages left to program,
+ * IPMI_CC_OK otherwise
+ */
+uint8_t flash_writer_status( void );
+
+/**
+ * @brief Flash writer task
+ *
+ * @param Parameters Pointer to parameter list passed to task upon initialization (not used here)
+ */
+void vTaskFlashWriter( void * Parameters );
+
+#endif
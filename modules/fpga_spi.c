@@ -99,7 +99,9 @@ void vTaskFPGA_COMM( void * Parameters )
         write_fpga_dword( 0x05, 0x55555555 );
 
         /* Update Sensors Readings */
-        for ( i = 0, temp_sensor = sdr_head; (temp_sensor != NULL) && (i <= NUM_SENSOR); temp_sensor = temp_sensor->next) {
+        i = 0;
+        for ( uint8_t sdr_idx = 0; (sdr_idx < sdr_count) && (i <= NUM_SENSOR); sdr_idx++ ) {
+            temp_sensor = sdr_table[sdr_idx];
             if (temp_sensor->diag_devID != NO_DIAG) {
                 diag->sensor[i].dev_id = temp_sensor->diag_devID;
                 diag->sensor[i].measure = temp_sensor->readout_value;
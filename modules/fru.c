@@ -36,12 +36,110 @@
 
 extern fru_data_t fru[FRU_COUNT];
 
+/*
+ * Copies the validated FRU image from the EEPROM to RAM, so Read FRU Data commands
+ * don't have to go through the I2C bus
+ */
+static bool fru_cache_load( uint8_t id )
+{
+    size_t chunk;
+    size_t offset;
+
+    /* The FRU_WRITE_EEPROM build buffer is replaced by what was actually written */
+    if ( fru[id].buffer != NULL ) {
+        vPortFree( fru[id].buffer );
+        fru[id].buffer = NULL;
+    }
+
+    fru[id].buffer = pvPortMalloc( fru[id].fru_size );
+
+    if ( fru[id].buffer == NULL ) {
+        printf("[FRU][%s] Not enough memory to cache the FRU info\n", id == FRU_AMC ? "AMC" : "RTM");
+        return false;
+    }
+
+    for ( offset = 0; offset < fru[id].fru_size; offset += chunk ) {
+        chunk = fru[id].fru_size - offset;
+        if ( chunk > FRU_CACHE_CHUNK ) {
+            chunk = FRU_CACHE_CHUNK;
+        }
+
+        if ( fru[id].cfg.read_f( fru[id].cfg.eeprom_id, offset, &fru[id].buffer[offset], chunk, pdMS_TO_TICKS(10) ) != chunk ) {
+            printf("[FRU][%s] Could not cache the FRU info, reading it from the EEPROM\n", id == FRU_AMC ? "AMC" : "RTM");
+            vPortFree( fru[id].buffer );
+            fru[id].buffer = NULL;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Length of an info area (chassis, board or product), read from its header */
+static uint16_t fru_area_len( uint8_t id, uint16_t offset )
+{
+    if ( ( offset == 0 ) || ( (size_t)offset + 1 >= fru[id].fru_size ) ) {
+        return 0;
+    }
+    return 8 * fru[id].buffer[offset+1];
+}
+
+static void fru_index_build( uint8_t id )
+{
+    fru_area_index_t *index = &fru[id].index;
+    uint8_t *image = fru[id].buffer;
+    size_t offset;
+
+    memset( index, 0, sizeof(fru_area_index_t) );
+
+    if ( ( image == NULL ) || ( fru[id].fru_size < 8 ) ) {
+        return;
+    }
+
+    index->chassis_off = 8 * image[2];
+    index->board_off = 8 * image[3];
+    index->product_off = 8 * image[4];
+    index->multirec_off = 8 * image[5];
+
+    index->chassis_len = fru_area_len( id, index->chassis_off );
+    index->board_len = fru_area_len( id, index->board_off );
+    index->product_len = fru_area_len( id, index->product_off );
+
+    if ( index->multirec_off > 0 ) {
+        /* Walk the record headers up to the end of list flag */
+        offset = index->multirec_off;
+        while ( offset + 5 <= fru[id].fru_size ) {
+            bool eol = image[offset+1] & (1 << 7);
+
+            offset += 5 + image[offset+2];
+            if ( eol ) {
+                break;
+            }
+        }
+
+        if ( offset > fru[id].fru_size ) {
+            offset = fru[id].fru_size;
+        }
+        index->multirec_len = offset - index->multirec_off;
+    }
+}
+
 void fru_init( uint8_t id )
 {
+    fru_check_result_t check;
+
     if ( id >= FRU_COUNT ) {
         return;
     }
 
+    /* Drop the image of a previously inserted module (e.g. a swapped RTM) */
+    if ( fru[id].buffer != NULL ) {
+        vPortFree( fru[id].buffer );
+        fru[id].buffer = NULL;
+    }
+    fru[id].runtime = false;
+    fru[id].cached = false;
+
 #ifdef FRU_WRITE_EEPROM
     printf(">FRU_WRITE_EEPROM flag enabled! Building FRU info...\n");
     fru[id].fru_size = fru[id].cfg.build_f( &fru[id].buffer );
@@ -50,168 +148,232 @@ void fru_init( uint8_t id )
     fru[id].cfg.write_f( fru[id].cfg.eeprom_id, 0x00, fru[id].buffer, fru[id].fru_size, pdMS_TO_TICKS(10) );
 #endif
 
-    /* Read FRU info Common Header */
-    if ( !fru_check_integrity(id, &fru[id].fru_size) ) {
+    /* Check the FRU info stored in the EEPROM */
+    if ( fru_check_integrity( id, &check ) ) {
+        fru[id].fru_size = check.fru_size;
+        fru[id].cached = fru_cache_load( id );
+    } else {
         /* Could not access the SEEPROM, create a runtime fru info */
         printf("Could not find a valid FRU information in EEPROM, building a runtime info...\n");
+        if ( fru[id].buffer != NULL ) {
+            vPortFree( fru[id].buffer );
+        }
         fru[id].fru_size = fru[id].cfg.build_f( &fru[id].buffer );
         fru[id].runtime = true;
     }
+
+    fru_index_build( id );
 }
 
-uint8_t fru_check_integrity( uint8_t id, size_t *fru_size )
+const fru_area_index_t * fru_get_area_index( uint8_t id )
 {
-    uint8_t common_header[8] = {0};
-    uint8_t chassis_off, board_off, product_off, multirec_off;
-    uint8_t *rec_buff = pvPortMalloc(128);
-    uint8_t rec_len = 0;
-    size_t total_len = 0;
-
-    if (fru[id].runtime) {
-        memcpy( &common_header[0], &fru[id].buffer[0], 8);
-    } else {
-        fru[id].cfg.read_f( fru[id].cfg.eeprom_id, 0x00, &common_header[0], 8, 10 );
+    if ( ( id >= FRU_COUNT ) || ( fru[id].buffer == NULL ) ) {
+        return NULL;
     }
+    return &fru[id].index;
+}
 
-    printf("[FRU][%s] Asserting FRU information integrity\n", id == FRU_AMC ? "AMC" : "RTM");
-    total_len += 8;
-    if ( !((calculate_chksum( &common_header[0], 8 ) == 0) && common_header[0] == 1) ) {
-        /* Wrong checksum */
-        printf("[FRU][%s] Error in COMMON HEADER checksum\n", id == FRU_AMC ? "AMC" : "RTM");
-        return 0;
+/* Integrity check state, fed with the FRU image one byte at a time */
+typedef struct fru_check_state {
+    fru_check_result_t *result;
+    uint16_t start[FRU_AREA_COUNT];     /* Area start, or start of the current multirecord */
+    uint16_t len[FRU_AREA_COUNT];       /* Area (or current multirecord data) length, known after its header */
+    uint8_t sum[FRU_AREA_COUNT];
+    uint8_t rec_chksum;                 /* Data checksum of the current multirecord */
+    bool rec_eol;                       /* Current multirecord is the last one */
+    uint8_t pending;                    /* Areas still being checked */
+} fru_check_state_t;
+
+static void fru_check_area_done( fru_check_state_t *st, uint8_t area, fru_area_status_t status, size_t end )
+{
+    st->result->area[area] = status;
+    st->pending--;
+
+    if ( ( status == FRU_AREA_OK ) && ( end > st->result->fru_size ) ) {
+        st->result->fru_size = end;
+    }
+}
+
+static void fru_check_multirec_end( fru_check_state_t *st, uint16_t pos )
+{
+    uint8_t area = FRU_AREA_MULTIRECORD;
+
+    st->result->multirec_count++;
+
+    if ( st->rec_eol ) {
+        fru_check_area_done( st, area, FRU_AREA_OK, pos + 1 );
+        return;
     }
 
-    chassis_off = 8*common_header[2];
-    board_off = 8*common_header[3];
-    product_off = 8*common_header[4];
-    multirec_off = 8*common_header[5];
-
-    if (chassis_off > 0) {
-        printf("[FRU][%s] Checking CHASSIS AREA record...", id == FRU_AMC ? "AMC" : "RTM");
-        if (fru[id].runtime) {
-            rec_len = fru[id].buffer[chassis_off+1];
-        } else {
-            fru[id].cfg.read_f( fru[id].cfg.eeprom_id, chassis_off+1, &rec_len, 1, pdMS_TO_TICKS(10) );
+    /* Next record header starts right after this one */
+    st->start[area] = pos + 1;
+    st->len[area] = 0;
+    st->sum[area] = 0;
+}
+
+static void fru_check_feed( fru_check_state_t *st, uint16_t pos, uint8_t data )
+{
+    uint16_t off;
+    uint8_t area;
+
+    /* Chassis, board and product info areas: format version, length in multiples of 8 bytes, zero checksum */
+    for ( area = FRU_AREA_CHASSIS; area <= FRU_AREA_PRODUCT; area++ ) {
+        if ( ( st->result->area[area] != FRU_AREA_CHECKING ) || ( pos < st->start[area] ) ) {
+            continue;
         }
-        rec_len *= 8;
-        if (rec_len > 0) {
-            if (fru[id].runtime) {
-                memcpy( &rec_buff[0], &fru[id].buffer[chassis_off], rec_len);
-            } else {
-                fru[id].cfg.read_f( fru[id].cfg.eeprom_id, chassis_off, &rec_buff[0], rec_len, pdMS_TO_TICKS(10) );
+
+        off = pos - st->start[area];
+        st->sum[area] += data;
+
+        if ( off == 0 ) {
+            if ( data != 1 ) {
+                fru_check_area_done( st, area, FRU_AREA_BAD_FORMAT, 0 );
             }
-            if ( !((calculate_chksum( &rec_buff[0], rec_len ) == 0) && rec_buff[0] == 1) ) {
-                /* Wrong checksum */
-                printf(" Error!\n");
-                return 0;
-            } else {
-                printf(" Success!\n");
-                total_len += rec_len;
+        } else if ( off == 1 ) {
+            st->len[area] = 8 * data;
+            if ( st->len[area] == 0 ) {
+                /* Empty area, nothing to check */
+                fru_check_area_done( st, area, FRU_AREA_OK, 0 );
             }
+        } else if ( off + 1 == st->len[area] ) {
+            fru_check_area_done( st, area, ( st->sum[area] == 0 ) ? FRU_AREA_OK : FRU_AREA_BAD_CHECKSUM, pos + 1 );
         }
     }
 
-    if (board_off > 0) {
-        printf("[FRU][%s] Checking BOARD AREA record...", id == FRU_AMC ? "AMC" : "RTM");
-        if (fru[id].runtime) {
-            rec_len = fru[id].buffer[board_off+1];
-        } else {
-            fru[id].cfg.read_f( fru[id].cfg.eeprom_id, board_off+1, &rec_len, 1, pdMS_TO_TICKS(10) );
+    /* Multirecord area: chain of records, each made of a 5-byte header followed by its data */
+    area = FRU_AREA_MULTIRECORD;
+    if ( ( st->result->area[area] != FRU_AREA_CHECKING ) || ( pos < st->start[area] ) ) {
+        return;
+    }
+
+    off = pos - st->start[area];
+    st->sum[area] += data;
+
+    if ( off == 1 ) {
+        st->rec_eol = data & (1 << 7);
+    } else if ( off == 2 ) {
+        st->len[area] = data;
+    } else if ( off == 3 ) {
+        st->rec_chksum = data;
+    } else if ( off == 4 ) {
+        if ( st->sum[area] != 0 ) {
+            fru_check_area_done( st, area, FRU_AREA_BAD_CHECKSUM, 0 );
+            return;
         }
-        rec_len *= 8;
 
-        if (rec_len > 0) {
-            if (fru[id].runtime) {
-                memcpy( &rec_buff[0], &fru[id].buffer[board_off], rec_len);
-            } else {
-                fru[id].cfg.read_f( fru[id].cfg.eeprom_id, board_off, &rec_buff[0], rec_len, pdMS_TO_TICKS(10) );
-            }
-            if ( !((calculate_chksum( &rec_buff[0], rec_len ) == 0) && rec_buff[0] == 1) ) {
-                /* Wrong checksum */
-                printf(" Error!\n");
-                return 0;
-            } else {
-                printf(" Success!\n");
-                total_len += rec_len;
-            }
+        /* The data has to sum up to the two's complement of the record checksum */
+        st->sum[area] = st->rec_chksum;
+        if ( st->len[area] == 0 ) {
+            fru_check_multirec_end( st, pos );
+        }
+    } else if ( off == 4 + st->len[area] ) {
+        if ( st->sum[area] != 0 ) {
+            fru_check_area_done( st, area, FRU_AREA_BAD_CHECKSUM, 0 );
+            return;
         }
+        fru_check_multirec_end( st, pos );
+    }
+}
+
+bool fru_check_integrity( uint8_t id, fru_check_result_t *result )
+{
+    /* Not on the stack: this runs from the small RTM management task too */
+    static uint8_t chunk_buff[FRU_CACHE_CHUNK];
+    static const char * const area_name[FRU_AREA_COUNT] = {
+        [FRU_AREA_COMMON_HEADER] = "COMMON HEADER",
+        [FRU_AREA_CHASSIS] = "CHASSIS AREA",
+        [FRU_AREA_BOARD] = "BOARD AREA",
+        [FRU_AREA_PRODUCT] = "PRODUCT AREA",
+        [FRU_AREA_MULTIRECORD] = "MULTIRECORD AREA",
+    };
+    static const char * const status_name[] = {
+        [FRU_AREA_OK] = "Success!",
+        [FRU_AREA_BAD_FORMAT] = "Error! (bad format version)",
+        [FRU_AREA_BAD_CHECKSUM] = "Error! (bad checksum)",
+        [FRU_AREA_READ_ERROR] = "Error! (could not be read)",
+    };
+    fru_check_state_t st;
+    fru_check_result_t local_result;
+    const char *fru_name = ( id == FRU_AMC ) ? "AMC" : "RTM";
+    uint16_t pos;
+    uint16_t chunk;
+    uint16_t i;
+    uint8_t area;
+    bool healthy = true;
+
+    if ( result == NULL ) {
+        result = &local_result;
     }
 
-    if (product_off > 0) {
-        printf("[FRU][%s] Checking PRODUCT AREA record...", id == FRU_AMC ? "AMC" : "RTM");
-        if (fru[id].runtime) {
-            rec_len = fru[id].buffer[product_off+1];
-        } else {
-            fru[id].cfg.read_f( fru[id].cfg.eeprom_id, product_off+1, &rec_len, 1, pdMS_TO_TICKS(10) );
+    memset( result, 0, sizeof(fru_check_result_t) );
+    memset( &st, 0, sizeof(fru_check_state_t) );
+    st.result = result;
+    result->area[FRU_AREA_COMMON_HEADER] = FRU_AREA_READ_ERROR;
+
+    printf("[FRU][%s] Asserting FRU information integrity\n", fru_name);
+
+    /* The EEPROM address auto-increments, so the image is read in sequential chunks and checked as it goes */
+    for ( pos = 0; pos < FRU_CHECK_MAX_SIZE; pos += chunk ) {
+        chunk = FRU_CHECK_MAX_SIZE - pos;
+        if ( chunk > FRU_CACHE_CHUNK ) {
+            chunk = FRU_CACHE_CHUNK;
         }
-        rec_len *= 8;
 
-        if (rec_len > 0) {
-            if (fru[id].runtime) {
-                memcpy( &rec_buff[0], &fru[id].buffer[product_off], rec_len);
-            } else {
-                fru[id].cfg.read_f( fru[id].cfg.eeprom_id, product_off, &rec_buff[0], rec_len, pdMS_TO_TICKS(10) );
-            }
-            if ( !((calculate_chksum( &rec_buff[0], rec_len ) == 0 ) && rec_buff[0] == 1) ) {
-                /* Wrong checksum */
-                printf(" Error!\n");
-                return 0;
-            } else {
-                printf(" Success!\n");
-                total_len += rec_len;
-            }
+        if ( fru[id].cfg.read_f( fru[id].cfg.eeprom_id, pos, chunk_buff, chunk, pdMS_TO_TICKS(10) ) != chunk ) {
+            break;
         }
-    }
 
-    if (multirec_off > 0) {
-        uint8_t eol = 0;
-        uint8_t rec_chksum;
-        rec_len = 0;
-        printf("[FRU][%s] Checking MULTIRECORD AREA records...\n", id == FRU_AMC ? "AMC" : "RTM");
-        do {
-            if (fru[id].runtime) {
-                memcpy( &rec_buff[0], &fru[id].buffer[multirec_off], 5);
-            } else {
-                fru[id].cfg.read_f( fru[id].cfg.eeprom_id, multirec_off, &rec_buff[0], 5, pdMS_TO_TICKS(10) );
+        i = 0;
+        if ( pos == 0 ) {
+            if ( calculate_chksum( chunk_buff, 8 ) != 0 ) {
+                result->area[FRU_AREA_COMMON_HEADER] = FRU_AREA_BAD_CHECKSUM;
+                break;
             }
-            /* Calculate Multirecord header checksum */
-            if ( !(calculate_chksum( &rec_buff[0], 5 ) == 0) ) {
-                /* Wrong checksum */
-                printf("[FRU][%s] Error in MULTIRECORD AREA HEADER integrity check!\n", id == FRU_AMC ? "AMC" : "RTM");
-                return 0;
+            if ( chunk_buff[0] != 1 ) {
+                result->area[FRU_AREA_COMMON_HEADER] = FRU_AREA_BAD_FORMAT;
+                break;
             }
-            multirec_off += 5;
-            total_len += 5;
-
-            rec_chksum = rec_buff[3];
-            rec_len = rec_buff[2];
-            eol = rec_buff[1] & (1 << 7);
-            if (rec_len > 0) {
-                if (fru[id].runtime) {
-                    memcpy( &rec_buff[0], &fru[id].buffer[multirec_off], rec_len );
-                } else {
-                    fru[id].cfg.read_f( fru[id].cfg.eeprom_id, multirec_off, &rec_buff[0], rec_len, pdMS_TO_TICKS(10) );
-                }
-                if ( !((calculate_chksum( &rec_buff[0], rec_len ) == rec_chksum)) ) {
-                    /* Wrong checksum */
-                    printf("[FRU][%s] Error in MULTIRECORD AREA integrity check!\n", id == FRU_AMC ? "AMC" : "RTM");
-                    return 0;
-                } else {
-                    total_len += rec_len;
-                    multirec_off += rec_len;
+            result->area[FRU_AREA_COMMON_HEADER] = FRU_AREA_OK;
+            result->fru_size = 8;
+
+            /* Header bytes 2 to 5 point to the chassis, board, product and multirecord areas */
+            for ( area = FRU_AREA_CHASSIS; area < FRU_AREA_COUNT; area++ ) {
+                if ( chunk_buff[area+1] != 0 ) {
+                    st.start[area] = 8 * chunk_buff[area+1];
+                    result->area[area] = FRU_AREA_CHECKING;
+                    st.pending++;
                 }
             }
-        } while(eol == 0);
+            i = 8;
+        }
+
+        for ( ; ( i < chunk ) && ( st.pending > 0 ); i++ ) {
+            fru_check_feed( &st, pos + i, chunk_buff[i] );
+        }
+
+        if ( st.pending == 0 ) {
+            break;
+        }
     }
 
-    if (fru_size) {
-        *fru_size = total_len;
+    for ( area = 0; area < FRU_AREA_COUNT; area++ ) {
+        if ( result->area[area] == FRU_AREA_ABSENT ) {
+            continue;
+        }
+        if ( result->area[area] == FRU_AREA_CHECKING ) {
+            result->area[area] = FRU_AREA_READ_ERROR;
+        }
+        if ( result->area[area] != FRU_AREA_OK ) {
+            healthy = false;
+        }
+        printf("[FRU][%s] Checking %s... %s\n", fru_name, area_name[area], status_name[result->area[area]]);
     }
 
-    printf("[FRU][%s] FRU info is healthy!\n", id == FRU_AMC ? "AMC" : "RTM");
+    if ( healthy ) {
+        printf("[FRU][%s] FRU info is healthy!\n", fru_name);
+    }
 
-    vPortFree(rec_buff);
-    return 1;
+    return healthy;
 }
 
 size_t fru_read( uint8_t id, uint8_t *rx_buff, uint16_t offset, size_t len )
@@ -227,7 +389,8 @@ size_t fru_read( uint8_t id, uint8_t *rx_buff, uint16_t offset, size_t len )
 
     /*
      * Read runtime FRU info that is auto-generated
-     * when there is no valid FRU info in the EEPROM
+     * when there is no valid FRU info in the EEPROM,
+     * or the RAM copy of the EEPROM FRU info
      */
     if ( fru[id].runtime ) {
         for ( i = 0; i < len; i++, j++ ) {
@@ -239,8 +402,12 @@ size_t fru_read( uint8_t id, uint8_t *rx_buff, uint16_t offset, size_t len )
         }
         ret_val = i;
 
+    } else if ( fru[id].cached && ( (size_t)offset + len <= fru[id].fru_size ) ) {
+        memcpy( rx_buff, &fru[id].buffer[offset], len );
+        ret_val = len;
+
     /*
-     *  Read EEPROM FRU info
+     *  Read EEPROM FRU info past the validated image
      */
     } else {
         ret_val = fru[id].cfg.read_f( fru[id].cfg.eeprom_id, offset, rx_buff, len, pdMS_TO_TICKS(10) );
@@ -256,6 +423,17 @@ size_t fru_write( uint8_t id, uint8_t *tx_buff, uint16_t offset, size_t len )
         return 0;
     }
     ret_val = fru[id].cfg.write_f( fru[id].cfg.eeprom_id, offset, tx_buff, len, pdMS_TO_TICKS(10) );
+
+    /* Write through to the RAM copy, keeping only what reached the EEPROM */
+    if ( fru[id].cached && ( offset < fru[id].fru_size ) ) {
+        len = ret_val;
+        if ( (size_t)offset + len > fru[id].fru_size ) {
+            len = fru[id].fru_size - offset;
+        }
+        memcpy( &fru[id].buffer[offset], tx_buff, len );
+        fru_index_build( id );
+    }
+
     return ret_val;
 }
 
@@ -314,7 +492,7 @@ IPMI_HANDLER(ipmi_storage_read_fru_data_cmd, NETFN_STORAGE, IPMI_READ_FRU_DATA_C
     rsp->completion_code = IPMI_CC_OK;
 }
 
-IPMI_HANDLER(ipmi_storage_write_fru_data_cmd, NETFN_STORAGE, IPMI_WRITE_FRU_DATA_CMD, ipmi_msg * req, ipmi_msg * rsp )
+IPMI_HANDLER_DEFERRED(ipmi_storage_write_fru_data_cmd, NETFN_STORAGE, IPMI_WRITE_FRU_DATA_CMD, ipmi_msg * req, ipmi_msg * rsp )
 {
     uint8_t len = rsp->data_len = 0;
     uint16_t offset =  (req->data[2] << 8) | (req->data[1]);
@@ -46,17 +46,62 @@ typedef struct fru_cfg {
     fru_st_write_t write_f;
 } fru_cfg_t;
 
+/* FRU image is copied from the EEPROM in chunks of this size */
+#define FRU_CACHE_CHUNK         128
+
+/* Offset and length (in bytes) of each FRU area, 0 if the area is absent */
+typedef struct fru_area_index {
+    uint16_t chassis_off;
+    uint16_t chassis_len;
+    uint16_t board_off;
+    uint16_t board_len;
+    uint16_t product_off;
+    uint16_t product_len;
+    uint16_t multirec_off;
+    uint16_t multirec_len;
+} fru_area_index_t;
+
+/* Longest image the integrity check walks through: last area pointer plus the longest info area */
+#define FRU_CHECK_MAX_SIZE      4096
+
+enum {
+    FRU_AREA_COMMON_HEADER,
+    FRU_AREA_CHASSIS,
+    FRU_AREA_BOARD,
+    FRU_AREA_PRODUCT,
+    FRU_AREA_MULTIRECORD,
+    FRU_AREA_COUNT
+};
+
+typedef enum {
+    FRU_AREA_ABSENT,            /* Not pointed to by the common header */
+    FRU_AREA_CHECKING,          /* Not reached yet (only while the check is running) */
+    FRU_AREA_OK,
+    FRU_AREA_BAD_FORMAT,        /* Wrong format version */
+    FRU_AREA_BAD_CHECKSUM,
+    FRU_AREA_READ_ERROR,        /* EEPROM read failed, or the area ends past FRU_CHECK_MAX_SIZE */
+} fru_area_status_t;
+
+typedef struct fru_check_result {
+    fru_area_status_t area[FRU_AREA_COUNT];
+    uint16_t multirec_count;    /* Number of valid multirecords */
+    size_t fru_size;            /* End of the last area, valid only if every area is OK */
+} fru_check_result_t;
+
 typedef struct fru_data {
     const fru_cfg_t cfg;
     uint8_t *buffer;
     size_t fru_size;
     bool runtime;
+    bool cached;            /* buffer holds a copy of the first fru_size bytes of the EEPROM */
+    fru_area_index_t index;
 } fru_data_t;
 
 void fru_init( uint8_t id );
+const fru_area_index_t * fru_get_area_index( uint8_t id );
 size_t fru_read( uint8_t id, uint8_t *rx_buff, uint16_t offset, size_t len );
 size_t fru_write( uint8_t id, uint8_t *tx_buff, uint16_t offset, size_t len );
-uint8_t fru_check_integrity( uint8_t id, size_t *fru_size );
+bool fru_check_integrity( uint8_t id, fru_check_result_t *result );
 #endif
 
 #endif
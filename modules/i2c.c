@@ -19,8 +19,12 @@
  *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
  */
 
+/* C Standard includes */
+#include <string.h>
+
 /* Project includes */
 #include "FreeRTOS.h"
+#include "task.h"
 #include "port.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
@@ -29,27 +33,34 @@
 #include "rtm_i2c_mapping.h"
 #endif
 
+static TickType_t i2c_max_hold = I2C_MAX_HOLD_TIME;
+
 void i2c_init( void )
 {
     for ( uint8_t i = 0; i < I2C_MUX_CNT; i++ ) {
-        i2c_mux[i].semaphore = xSemaphoreCreateBinary();
+        /* Mutexes are created available and provide priority inheritance to the bus holder */
+        i2c_mux[i].semaphore = xSemaphoreCreateMutex();
         vI2CConfig( i2c_mux[i].i2c_interface, SPEED_400KHZ );
-        xSemaphoreGive( i2c_mux[i].semaphore );
     }
 }
 
+static i2c_mux_state_t * i2c_find_mux( uint8_t i2c_interface )
+{
+    for ( uint8_t i = 0; i < I2C_MUX_CNT; i++ ) {
+        if ( i2c_mux[i].i2c_interface == i2c_interface ) {
+            return &i2c_mux[i];
+        }
+    }
+    return NULL;
+}
+
 bool i2c_take_by_busid( uint8_t bus_id, uint8_t *i2c_interface, TickType_t timeout )
 {
     i2c_mux_state_t *p_i2c_mux = NULL;
     i2c_bus_mapping_t *p_i2c_bus = &i2c_bus_map[bus_id];
+    TickType_t wait_start, now;
 
-    uint8_t tmp_interface_id = i2c_bus_map[bus_id].i2c_interface;
-
-    for ( p_i2c_mux = i2c_mux; p_i2c_mux != NULL; p_i2c_mux++ ) {
-        if ( p_i2c_mux->i2c_interface == tmp_interface_id ) {
-            break;
-        }
-    }
+    p_i2c_mux = i2c_find_mux( p_i2c_bus->i2c_interface );
 
     if ( p_i2c_mux == NULL ) {
         return false;
@@ -61,11 +72,23 @@ bool i2c_take_by_busid( uint8_t bus_id, uint8_t *i2c_interface, TickType_t timeo
         return false;
     }
 
-    /* Try to take the semaphore to win the bus */
+    /* Try to take the mutex to win the bus */
+    wait_start = xTaskGetTickCount();
     if ( xSemaphoreTake( p_i2c_mux->semaphore, timeout ) == pdFALSE ) {
+        __atomic_add_fetch( &p_i2c_mux->stats.timeouts, 1, __ATOMIC_RELAXED );
         return false;
     }
 
+    /* Only the holder updates the remaining statistics, so no further locking is needed */
+    now = xTaskGetTickCount();
+    p_i2c_mux->holder = xTaskGetCurrentTaskHandle();
+    p_i2c_mux->hold_start = now;
+    p_i2c_mux->stats.takes++;
+    p_i2c_mux->stats.wait_total += now - wait_start;
+    if ( ( now - wait_start ) > p_i2c_mux->stats.wait_max ) {
+        p_i2c_mux->stats.wait_max = now - wait_start;
+    }
+
     /* This bus is not multiplexed, no action needed */
     if ( p_i2c_bus->mux_bus == -1 ) {
         *i2c_interface = p_i2c_mux->i2c_interface;
@@ -73,12 +96,17 @@ bool i2c_take_by_busid( uint8_t bus_id, uint8_t *i2c_interface, TickType_t timeo
         return true;
     }
 
+    /* The mux is only written when the cached channel differs from the requested one (or is unknown) */
+    if ( p_i2c_mux->state == p_i2c_bus->mux_bus ) {
+        p_i2c_mux->mux_hits++;
+    } else {
+        p_i2c_mux->mux_misses++;
 
-    p_i2c_mux->state = i2c_get_mux_bus( bus_id, p_i2c_mux );
-
-    /* This bus mux is in correct state */
-    if ( p_i2c_mux->state != p_i2c_bus->mux_bus ) {
+        /* Drop the cached channel first, so a failed write leaves it unknown */
+        p_i2c_mux->state = -1;
         if ( i2c_set_mux_bus( bus_id, p_i2c_mux, p_i2c_bus->mux_bus ) == false ) {
+            /* We failed to configure the I2C Mux, release the bus */
+            i2c_give( p_i2c_mux->i2c_interface );
             return false;
         }
     }
@@ -87,20 +115,38 @@ bool i2c_take_by_busid( uint8_t bus_id, uint8_t *i2c_interface, TickType_t timeo
     return true;
 }
 
-bool i2c_take_by_chipid( uint8_t chip_id, uint8_t *i2c_address, uint8_t *i2c_interface,  uint32_t timeout )
+void i2c_mux_invalidate( uint8_t i2c_interface )
 {
+    i2c_mux_state_t *mux = i2c_find_mux( i2c_interface );
 
-    uint8_t bus_id;
+    if ( mux != NULL ) {
+        mux->state = -1;
+    }
+}
+
+bool i2c_get_mux_stats( uint8_t i2c_interface, uint32_t *hits, uint32_t *misses )
+{
+    i2c_mux_state_t *mux = i2c_find_mux( i2c_interface );
+
+    if ( mux == NULL ) {
+        return false;
+    }
+
+    *hits = mux->mux_hits;
+    *misses = mux->mux_misses;
+    return true;
+}
+
+bool i2c_chip_lookup( uint8_t chip_id, uint8_t *bus_id, uint8_t *i2c_address )
+{
+    i2c_chip_mapping_t *chip;
 
     /*AFC devices*/
     if (chip_id <= 63) {
         if ( chip_id > I2C_CHIP_CNT ) {
             return false;
         }
-        bus_id = i2c_chip_map[chip_id].bus_id;
-        if ( i2c_address != NULL ) {
-            *i2c_address = i2c_chip_map[chip_id].i2c_address;
-        }
+        chip = &i2c_chip_map[chip_id];
 
 #ifdef MODULE_RTM
     /*RTM devices*/
@@ -108,26 +154,143 @@ bool i2c_take_by_chipid( uint8_t chip_id, uint8_t *i2c_address, uint8_t *i2c_int
         if ( chip_id > 64+I2C_CHIP_RTM_CNT ) {
             return false;
         }
-        bus_id = i2c_chip_rtm_map[chip_id-64].bus_id;
-        if ( i2c_address != NULL ) {
-            *i2c_address = i2c_chip_rtm_map[chip_id-64].i2c_address;
-        }
+        chip = &i2c_chip_rtm_map[chip_id-64];
 #endif
 
     } else {
         return false;
     }
 
+    if ( bus_id != NULL ) {
+        *bus_id = chip->bus_id;
+    }
+    if ( i2c_address != NULL ) {
+        *i2c_address = chip->i2c_address;
+    }
+    return true;
+}
+
+bool i2c_take_by_chipid( uint8_t chip_id, uint8_t *i2c_address, uint8_t *i2c_interface,  uint32_t timeout )
+{
+    uint8_t bus_id;
+
+    if ( !i2c_chip_lookup( chip_id, &bus_id, i2c_address ) ) {
+        return false;
+    }
+
     return i2c_take_by_busid( bus_id, i2c_interface, timeout );
 }
 
-void i2c_give( uint8_t i2c_interface )
+uint8_t i2c_transfer( uint8_t i2c_interface, uint8_t i2c_address, const i2c_xfer_t *xfers, uint8_t count )
 {
-    i2c_mux_state_t *mux;
-    for ( mux = i2c_mux; mux != NULL; mux++ ) {
-        if ( mux->i2c_interface == i2c_interface ) {
-            xSemaphoreGive( mux->semaphore );
-            break;
+    const i2c_xfer_t *xfer;
+    uint8_t done;
+    int len;
+
+    for ( done = 0; done < count; done++ ) {
+        xfer = &xfers[done];
+
+        if ( xfer->rx_len == 0 ) {
+            len = xI2CMasterWrite( i2c_interface, i2c_address, xfer->tx, xfer->tx_len );
+            if ( len != xfer->tx_len ) {
+                break;
+            }
+        } else if ( xfer->tx_len == 0 ) {
+            len = xI2CMasterRead( i2c_interface, i2c_address, xfer->rx, xfer->rx_len );
+            if ( len != xfer->rx_len ) {
+                break;
+            }
+        } else {
+            len = xI2CMasterWriteRead( i2c_interface, i2c_address, xfer->tx, xfer->tx_len, xfer->rx, xfer->rx_len );
+            if ( len != xfer->rx_len ) {
+                break;
+            }
         }
     }
+
+    /* A failed transfer may have left the mux in an unknown state (e.g. after a bus glitch), select it again on the next take */
+    if ( done < count ) {
+        i2c_mux_invalidate( i2c_interface );
+    }
+
+    return done;
+}
+
+uint8_t i2c_transfer_by_chipid( uint8_t chip_id, const i2c_xfer_t *xfers, uint8_t count, TickType_t timeout )
+{
+    uint8_t i2c_interface, i2c_address;
+    uint8_t done;
+
+    if ( i2c_take_by_chipid( chip_id, &i2c_address, &i2c_interface, timeout ) == false ) {
+        return 0;
+    }
+
+    done = i2c_transfer( i2c_interface, i2c_address, xfers, count );
+
+    i2c_give( i2c_interface );
+
+    return done;
+}
+
+void i2c_give( uint8_t i2c_interface )
+{
+    i2c_mux_state_t *mux = i2c_find_mux( i2c_interface );
+    TaskHandle_t holder;
+    TickType_t hold;
+    bool overrun;
+
+    if ( mux == NULL ) {
+        return;
+    }
+
+    holder = mux->holder;
+    hold = xTaskGetTickCount() - mux->hold_start;
+    overrun = ( i2c_max_hold != 0 ) && ( hold > i2c_max_hold );
+
+    mux->stats.hold_total += hold;
+    if ( hold > mux->stats.hold_max ) {
+        mux->stats.hold_max = hold;
+        /* Keep a copy of the name, the task may be deleted before the statistics are read */
+        strncpy( mux->stats.hold_max_task, ( holder != NULL ) ? pcTaskGetName( holder ) : "?", configMAX_TASK_NAME_LEN - 1 );
+    }
+    if ( overrun ) {
+        mux->stats.hold_overruns++;
+    }
+    mux->holder = NULL;
+
+    xSemaphoreGive( mux->semaphore );
+
+    /* Log outside of the bus ownership, so the report itself does not delay the waiting tasks */
+    if ( overrun ) {
+        printf( "[I2C] Bus %d held for %lu ticks by %s\n", i2c_interface, (unsigned long) hold, ( holder != NULL ) ? pcTaskGetName( holder ) : "?" );
+    }
+}
+
+const i2c_mux_state_t * i2c_get_bus_state( uint8_t index )
+{
+    if ( index >= I2C_MUX_CNT ) {
+        return NULL;
+    }
+    return &i2c_mux[index];
+}
+
+void i2c_reset_bus_stats( void )
+{
+    taskENTER_CRITICAL();
+    for ( uint8_t i = 0; i < I2C_MUX_CNT; i++ ) {
+        memset( &i2c_mux[i].stats, 0, sizeof(i2c_bus_stats_t) );
+        i2c_mux[i].mux_hits = 0;
+        i2c_mux[i].mux_misses = 0;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void i2c_set_max_hold_time( TickType_t max_hold )
+{
+    i2c_max_hold = max_hold;
+}
+
+TickType_t i2c_get_max_hold_time( void )
+{
+    return i2c_max_hold;
 }
@@ -24,6 +24,7 @@
 
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "task.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -46,19 +47,59 @@ typedef struct i2c_bus_mapping {
     uint8_t enabled;                /**< Enabled flag */
 } i2c_bus_mapping_t;
 
+/**
+ * @brief Default maximum time a task may hold a bus before it is logged as an offender (in ticks)
+ */
+#ifndef I2C_MAX_HOLD_TIME
+#define I2C_MAX_HOLD_TIME               pdMS_TO_TICKS(50)
+#endif
+
+/**
+ * @brief I2C bus arbitration statistics
+ */
+typedef struct i2c_bus_stats {
+    uint32_t takes;                 /**< Amount of times the bus was gained */
+    uint32_t timeouts;              /**< Amount of takes that gave up waiting for the bus */
+    uint32_t hold_overruns;         /**< Amount of holds longer than the maximum hold time */
+    TickType_t wait_total;          /**< Accumulated time spent waiting for the bus */
+    TickType_t wait_max;            /**< Longest wait for the bus */
+    TickType_t hold_total;          /**< Accumulated time the bus was held */
+    TickType_t hold_max;            /**< Longest hold of the bus */
+    char hold_max_task[configMAX_TASK_NAME_LEN]; /**< Name of the task responsible for the longest hold */
+} i2c_bus_stats_t;
+
 /**
  * @brief I2C Mux state
  */
 typedef struct i2c_mux_state {
     uint8_t i2c_interface;         /**< Physical I2C bus number */
-    int8_t state;                   /**< Mux state */
-    SemaphoreHandle_t semaphore;    /**< Bus semaphore handle */
+    int8_t state;                   /**< Cached mux channel (-1 when unknown) */
+    SemaphoreHandle_t semaphore;    /**< Bus mutex handle */
+    uint32_t mux_hits;              /**< Takes served by the cached mux channel */
+    uint32_t mux_misses;            /**< Takes that had to write the mux */
+    TaskHandle_t holder;            /**< Task currently holding the bus (NULL when free) */
+    TickType_t hold_start;          /**< Tick count when the current holder gained the bus */
+    i2c_bus_stats_t stats;          /**< Arbitration statistics */
 } i2c_mux_state_t;
 
+/**
+ * @brief I2C transaction segment
+ *
+ * A segment with both buffers set is a write followed by a read after a repeated start (e.g. register pointer + data).
+ * Leave @p rx_len at 0 for a plain write, or @p tx_len at 0 for a plain read.
+ */
+typedef struct i2c_xfer {
+    const uint8_t *tx;              /**< Bytes to write */
+    uint8_t tx_len;                 /**< Amount of bytes to write */
+    uint8_t *rx;                    /**< Buffer for the bytes read */
+    uint8_t rx_len;                 /**< Amount of bytes to read */
+} i2c_xfer_t;
+
 /**
  * @brief Initialize peripheral I2C buses
  *
- * This function initializes all buses listed on the i2c_mux table, configuring the controller hardware and creating a binary semaphore for each.
+ * This function initializes all buses listed on the i2c_mux table, configuring the controller hardware and creating a mutex for each.
+ * Mutexes (rather than binary semaphores) make a low priority holder inherit the priority of the tasks waiting for its bus.
  */
 void i2c_init( void );
 
@@ -69,6 +110,8 @@ void i2c_init( void );
  * @param i2c_mux Pointer to bus mux structure
  * @param new_state New bus mux state
  *
+ * @note The bus is still held by the caller when this function fails
+ *
  * @retval true Bus was successfuly changed to the desired mux setting
  * @retval false Bus could not be changed to the desired mux setting
  */
@@ -84,6 +127,28 @@ bool i2c_set_mux_bus( uint8_t bus_id, i2c_mux_state_t *i2c_mux, int8_t new_state
  */
 uint8_t i2c_get_mux_bus( uint8_t bus_id, i2c_mux_state_t *i2c_mux );
 
+/**
+ * @brief Forget the cached mux channel of a physical bus
+ *
+ * The next take of a multiplexed bus on this interface will write the mux again. Must be called after any bus error
+ * or recovery that may have reset the mux or left it in an unknown state.
+ *
+ * @param i2c_interface Physical I2C bus number
+ */
+void i2c_mux_invalidate( uint8_t i2c_interface );
+
+/**
+ * @brief Read the mux channel cache counters of a physical bus
+ *
+ * @param[in] i2c_interface Physical I2C bus number
+ * @param[out] hits Amount of takes that found the mux already on the requested channel
+ * @param[out] misses Amount of takes that had to write the mux
+ *
+ * @retval true Counters were read
+ * @retval false No such bus
+ */
+bool i2c_get_mux_stats( uint8_t i2c_interface, uint32_t *hits, uint32_t *misses );
+
 /**
  * @brief Take control over an I2C bus given a bus id
  *
@@ -96,6 +161,18 @@ uint8_t i2c_get_mux_bus( uint8_t bus_id, i2c_mux_state_t *i2c_mux );
  */
 bool i2c_take_by_busid( uint8_t bus_id, uint8_t *i2c_interface, uint32_t timeout );
 
+/**
+ * @brief Find the bus and slave address of a chip
+ *
+ * @param[in] chip_id Chip ID to look up (AFC or RTM chip)
+ * @param[out] bus_id Pointer to variable that will hold the chip bus ID (may be NULL)
+ * @param[out] i2c_address Pointer to variable that will hold the chip slave address (may be NULL)
+ *
+ * @retval true Chip is mapped
+ * @retval false Unknown chip ID
+ */
+bool i2c_chip_lookup( uint8_t chip_id, uint8_t *bus_id, uint8_t *i2c_address );
+
 /**
  * @brief Take control over an I2C bus given a chip id
  *
@@ -109,6 +186,32 @@ bool i2c_take_by_busid( uint8_t bus_id, uint8_t *i2c_interface, uint32_t timeout
  */
 bool i2c_take_by_chipid( uint8_t chip_id, uint8_t *i2c_address, uint8_t * i2c_interface,  TickType_t timeout );
 
+/**
+ * @brief Execute a list of segments on an already taken bus
+ *
+ * Segments run in order and the list stops at the first segment that does not transfer all its bytes.
+ *
+ * @param i2c_interface Physical I2C bus ID (as returned by i2c_take_by_busid() or i2c_take_by_chipid())
+ * @param i2c_address Chip slave address (7-bit)
+ * @param xfers Segment list
+ * @param count Amount of segments in the list
+ *
+ * @return Amount of segments completed
+ */
+uint8_t i2c_transfer( uint8_t i2c_interface, uint8_t i2c_address, const i2c_xfer_t *xfers, uint8_t count );
+
+/**
+ * @brief Execute a list of segments on a chip under a single bus take and mux selection
+ *
+ * @param chip_id Chip ID to communicate
+ * @param xfers Segment list
+ * @param count Amount of segments in the list
+ * @param timeout Limit time to gain the bus
+ *
+ * @return Amount of segments completed (0 if the bus could not be gained)
+ */
+uint8_t i2c_transfer_by_chipid( uint8_t chip_id, const i2c_xfer_t *xfers, uint8_t count, TickType_t timeout );
+
 /**
  * @brief Release the previously gained I2C bus
  *
@@ -116,4 +219,32 @@ bool i2c_take_by_chipid( uint8_t chip_id, uint8_t *i2c_address, uint8_t * i2c_in
  */
 void i2c_give( uint8_t i2c_interface );
 
+/**
+ * @brief Get the state of a physical bus, for diagnostics
+ *
+ * @param index Index in the i2c_mux table
+ *
+ * @return Pointer to the bus state, or NULL if @p index is past the end of the table
+ */
+const i2c_mux_state_t * i2c_get_bus_state( uint8_t index );
+
+/**
+ * @brief Clear the arbitration statistics of every bus
+ */
+void i2c_reset_bus_stats( void );
+
+/**
+ * @brief Set the hold time above which a bus holder is logged as an offender
+ *
+ * @param max_hold Maximum hold time (in ticks), 0 disables the check
+ */
+void i2c_set_max_hold_time( TickType_t max_hold );
+
+/**
+ * @brief Get the hold time above which a bus holder is logged as an offender
+ *
+ * @return Maximum hold time (in ticks)
+ */
+TickType_t i2c_get_max_hold_time( void );
+
 #endif
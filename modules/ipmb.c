@@ -75,14 +75,13 @@ ipmb_error ipmb_encode ( uint8_t * buffer, ipmi_msg * msg );
 ipmb_error ipmb_decode ( ipmi_msg * msg, uint8_t * buffer, uint8_t len );
 
 /**
- * @brief Notifies the client that a new request has arrived and copies the message to its queue.
- * This function receives a message wrapped in a ipmi_msg_cfg struct and copies only the ipmi_msg
- * field to the client queue.
+ * @brief Notifies the client that a new request has arrived and passes the message buffer to its queue.
+ * Only the buffer handle is queued, the client becomes its owner and must release it with #ipmb_msg_free.
  * Also, if a task has registered its handle in the caller_task field, notify it.
  *
  * @param[in] msg_cfg The message that arrived, wrapped in the configuration struct ipmi_msg_cfg.
  *
- * @retval ipmb_error_success The message was successfully copied.
+ * @retval ipmb_error_success The message was successfully handed over.
  * @retval ipmb_error_timeout The client_queue was full.
  */
 ipmb_error ipmb_notify_client ( ipmi_msg_cfg * msg_cfg );
@@ -94,15 +93,195 @@ QueueHandle_t ipmb_txqueue = NULL;
 QueueHandle_t client_queue = NULL;
 
 static uint8_t current_seq;
-static ipmi_msg_cfg *last_sent_req;
+
+/**
+ * @brief Static pool of message buffers shared by the whole IPMB path
+ *
+ * Each bit set in #ipmb_pool_used_mask marks a buffer in use. Buffers are claimed and released with atomic operations, so no lock is needed.
+ */
+static ipmi_msg_cfg ipmb_msg_pool[IPMB_MSG_POOL_LEN];
+static uint32_t ipmb_pool_used_mask;
+static uint8_t ipmb_pool_high_water;
+static uint32_t ipmb_pool_alloc_failures;
+
+#define IPMB_MSG_POOL_MASK      ( ( 1UL << IPMB_MSG_POOL_LEN ) - 1 )
+
+#if IPMB_MSG_POOL_LEN > 31
+#error "IPMB_MSG_POOL_LEN must fit in the pool usage bitmask"
+#endif
+
+/**
+ * @brief Outstanding requests, indexed by their sequence number
+ *
+ * Entries are shared between the tasks that send requests, #IPMB_TXTask and #IPMB_RXTask, so they're only modified inside critical sections.
+ * Whoever clears an entry becomes the owner of the request buffer and must free it.
+ */
+static ipmb_pending_req pending_req[IPMB_SEQ_TABLE_LEN];
+
+/**
+ * @brief Link-layer statistics, updated with atomic increments since several tasks touch them
+ */
+static ipmb_stats stats;
+
+/**
+ * @brief I2C master counters of the IPMB bus at the last statistics reset
+ */
+static i2c_master_stats_t i2c_stats_base;
+
+#define IPMB_STATS_INC( counter )       __atomic_fetch_add( &( counter ), 1, __ATOMIC_RELAXED )
+
+static void ipmb_stats_add_hist( uint32_t * hist, TickType_t ticks )
+{
+    uint8_t bucket = ( ticks == 0 ) ? 0 : ( 32 - __builtin_clz( ticks ) );
+
+    if ( bucket >= IPMB_STATS_HIST_BUCKETS ) {
+        bucket = IPMB_STATS_HIST_BUCKETS - 1;
+    }
+
+    IPMB_STATS_INC( hist[bucket] );
+}
+
+/**
+ * @brief Reserves a free sequence number for a new request
+ *
+ * The search starts right after the last sequence number given, so recently used numbers (which may still have late responses on the way) are the last ones to be reused.
+ *
+ * @param req_cfg Request that will own the sequence number. Its seq field is written by this function.
+ *
+ * @retval true A sequence number was reserved
+ * @retval false All sequence numbers are in use
+ */
+static bool ipmb_seq_alloc( ipmi_msg_cfg * req_cfg )
+{
+    bool found = false;
+
+    taskENTER_CRITICAL();
+    for ( uint8_t i = 0; i < IPMB_SEQ_TABLE_LEN; i++ ) {
+        uint8_t seq = ( current_seq + i ) % IPMB_SEQ_TABLE_LEN;
+
+        if ( pending_req[seq].req == NULL ) {
+            pending_req[seq].req = req_cfg;
+            pending_req[seq].in_flight = false;
+            req_cfg->buffer.seq = seq;
+            current_seq = seq + 1;
+            found = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return found;
+}
+
+/**
+ * @brief Releases a sequence number, so it can be used by a new request
+ *
+ * @param seq Sequence number to be released
+ */
+static void ipmb_seq_release( uint8_t seq )
+{
+    taskENTER_CRITICAL();
+    pending_req[seq % IPMB_SEQ_TABLE_LEN].req = NULL;
+    pending_req[seq % IPMB_SEQ_TABLE_LEN].in_flight = false;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Finds the in-flight request answered by a response and releases its sequence number
+ *
+ * @param resp Received response
+ *
+ * @return Pointer to the matching request (which must be freed by the caller) or NULL if there's none
+ */
+static ipmi_msg_cfg * ipmb_match_response( ipmi_msg * resp )
+{
+    ipmb_pending_req *entry = &pending_req[resp->seq % IPMB_SEQ_TABLE_LEN];
+    ipmi_msg_cfg *req_cfg = NULL;
+
+    taskENTER_CRITICAL();
+    if ( entry->in_flight &&
+         ( entry->req->buffer.netfn + 1 == resp->netfn ) &&
+         ( entry->req->buffer.cmd == resp->cmd ) &&
+         ( entry->req->buffer.dest_addr == resp->src_addr ) ) {
+        req_cfg = entry->req;
+        entry->req = NULL;
+        entry->in_flight = false;
+    }
+    taskEXIT_CRITICAL();
+
+    return req_cfg;
+}
+
+/**
+ * @brief Retransmits or drops every in-flight request that has not been answered in time
+ *
+ * @param buffer Scratch buffer used to encode the retransmitted requests
+ *
+ * @return Ticks until the next in-flight request expires, or portMAX_DELAY if there's no request in flight
+ */
+static TickType_t ipmb_retransmit_expired( uint8_t * buffer )
+{
+    TickType_t next_timeout = portMAX_DELAY;
+
+    for ( uint8_t seq = 0; seq < IPMB_SEQ_TABLE_LEN; seq++ ) {
+        ipmb_pending_req *entry = &pending_req[seq];
+        ipmi_msg_cfg *expired_req = NULL;
+        uint8_t dest_addr = 0;
+        uint8_t req_tx_size = 0;
+
+        taskENTER_CRITICAL();
+        if ( entry->in_flight ) {
+            TickType_t elapsed = xTaskGetTickCount() - entry->req->timestamp;
+
+            if ( elapsed >= IPMB_MSG_TIMEOUT ) {
+                if ( entry->req->retries >= IPMB_MAX_RETRIES ) {
+                    /* Give up on this request, the sequence number is free to be used again */
+                    IPMB_STATS_INC( stats.tx_failures );
+                    expired_req = entry->req;
+                    entry->req = NULL;
+                    entry->in_flight = false;
+                } else {
+                    /* Encode it here, since the entry may be released by IPMB_RXTask as soon as we leave the critical section */
+                    entry->req->retries++;
+                    IPMB_STATS_INC( stats.retries );
+                    entry->req->timestamp = xTaskGetTickCount();
+                    ipmb_encode( buffer, &entry->req->buffer );
+                    dest_addr = entry->req->buffer.dest_addr;
+                    req_tx_size = entry->req->buffer.data_len + IPMB_REQ_HEADER_LENGTH;
+                    elapsed = 0;
+                }
+            }
+
+            if ( entry->in_flight && ( IPMB_MSG_TIMEOUT - elapsed ) < next_timeout ) {
+                next_timeout = IPMB_MSG_TIMEOUT - elapsed;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if ( expired_req ) {
+            ipmb_msg_free( expired_req );
+        } else if ( req_tx_size ) {
+            /* If the retransmission fails, it'll just expire again and count as another retry */
+            xI2CMasterWrite( IPMB_I2C, dest_addr >> 1, &buffer[1], req_tx_size );
+        }
+    }
+
+    return next_timeout;
+}
 
 void IPMB_TXTask ( void * pvParameters )
 {
     ipmi_msg_cfg *current_msg_tx;
     uint8_t ipmb_buffer_tx[IPMI_MSG_MAX_LENGTH];
+    TickType_t next_timeout;
 
     for ( ;; ) {
-        xQueueReceive( ipmb_txqueue, &current_msg_tx, portMAX_DELAY);
+        next_timeout = ipmb_retransmit_expired( ipmb_buffer_tx );
+
+        if ( xQueueReceive( ipmb_txqueue, &current_msg_tx, next_timeout ) == pdFALSE ) {
+            /* Some in-flight request has expired */
+            continue;
+        }
 
         if ( IS_RESPONSE(current_msg_tx->buffer) ) {
             /* We're sending a response */
@@ -113,9 +292,10 @@ void IPMB_TXTask ( void * pvParameters )
 
             /* See if we've already tried sending this message 3 times */
             if ( current_msg_tx->retries > IPMB_MAX_RETRIES ) {
+                IPMB_STATS_INC( stats.tx_failures );
                 xTaskNotify( current_msg_tx->caller_task ,ipmb_error_failure , eSetValueWithOverwrite);
                 /* Free the message buffer */
-                vPortFree( current_msg_tx );
+                ipmb_msg_free( current_msg_tx );
                 current_msg_tx = NULL;
                 continue;
             }
@@ -130,13 +310,16 @@ void IPMB_TXTask ( void * pvParameters )
             if ( xI2CMasterWrite( IPMB_I2C, current_msg_tx->buffer.dest_addr >> 1, &ipmb_buffer_tx[1], resp_tx_size ) < resp_tx_size ) {
                 /* Message couldn't be transmitted right now, increase retry counter and try again later */
                 current_msg_tx->retries++;
+                IPMB_STATS_INC( stats.retries );
                 xQueueSendToFront( ipmb_txqueue, &current_msg_tx, 0 );
 
             } else {
                 /* Success case*/
+                IPMB_STATS_INC( stats.responses_tx[( current_msg_tx->buffer.netfn >> 1 ) % IPMB_STATS_NETFN_COUNT] );
+                ipmb_stats_add_hist( stats.turnaround_hist, xTaskGetTickCount() - current_msg_tx->timestamp );
                 xTaskNotify( current_msg_tx->caller_task , ipmb_error_success, eSetValueWithOverwrite);
                 /* Free the message buffer */
-                vPortFree( current_msg_tx );
+                ipmb_msg_free( current_msg_tx );
                 current_msg_tx = NULL;
             }
 
@@ -146,31 +329,57 @@ void IPMB_TXTask ( void * pvParameters )
             /* Sending new outgoing request        */
             /***************************************/
 
-            /* Get the time when the message is first sent */
-            if ( current_msg_tx->retries == 0 ) {
-                current_msg_tx->timestamp = xTaskGetTickCount();
-            }
+            ipmb_pending_req *entry = &pending_req[current_msg_tx->buffer.seq % IPMB_SEQ_TABLE_LEN];
+            TaskHandle_t caller_task = current_msg_tx->caller_task;
+            bool answered;
 
             ipmb_encode( &ipmb_buffer_tx[0], &current_msg_tx->buffer );
             uint8_t req_tx_size = current_msg_tx->buffer.data_len + IPMB_REQ_HEADER_LENGTH;
+
+            /* The response may be handled by IPMB_RXTask before xI2CMasterWrite returns, so the request must be
+             * waiting in the pending table before it goes on the wire */
+            taskENTER_CRITICAL();
+            current_msg_tx->timestamp = xTaskGetTickCount();
+            entry->in_flight = true;
+            taskEXIT_CRITICAL();
+
             if ( xI2CMasterWrite( IPMB_I2C, current_msg_tx->buffer.dest_addr >> 1, &ipmb_buffer_tx[1], req_tx_size ) < req_tx_size) {
 
+                /* Only this task marks requests in flight, so a cleared flag means the response already came
+                 * (and the buffer was released by IPMB_RXTask) */
+                taskENTER_CRITICAL();
+                answered = !entry->in_flight;
+                entry->in_flight = false;
+                taskEXIT_CRITICAL();
+
+                if ( answered ) {
+                    IPMB_STATS_INC( stats.requests_tx );
+                    current_msg_tx = NULL;
+                    xTaskNotify ( caller_task, ipmb_error_success, eSetValueWithOverwrite);
+                    continue;
+                }
+
                 current_msg_tx->retries++;
 
                 if ( current_msg_tx->retries > IPMB_MAX_RETRIES ){
+                    IPMB_STATS_INC( stats.tx_failures );
+                    ipmb_seq_release( current_msg_tx->buffer.seq );
                     xTaskNotify ( current_msg_tx->caller_task, ipmb_error_failure, eSetValueWithOverwrite);
                     /* Free the message buffer */
-                    vPortFree( current_msg_tx );
+                    ipmb_msg_free( current_msg_tx );
                     current_msg_tx = NULL;
                 } else {
+                    IPMB_STATS_INC( stats.retries );
                     xQueueSendToFront( ipmb_txqueue, &current_msg_tx, 0 );
                 }
 
             } else {
-                /* Request was successfully sent, keep a copy here for future comparison and clean the last used buffer */
-                vPortFree( last_sent_req );
-                last_sent_req = current_msg_tx;
-                xTaskNotify ( current_msg_tx->caller_task, ipmb_error_success, eSetValueWithOverwrite);
+                /* Request was successfully sent, it now waits for its response in the pending table.
+                 * The buffer belongs to the table since it was marked in flight, so don't touch it anymore */
+                IPMB_STATS_INC( stats.requests_tx );
+
+                current_msg_tx = NULL;
+                xTaskNotify ( caller_task, ipmb_error_success, eSetValueWithOverwrite);
             }
         }
     }
@@ -179,56 +388,65 @@ void IPMB_TXTask ( void * pvParameters )
 void IPMB_RXTask ( void *pvParameters )
 {
     ipmi_msg_cfg *current_msg_rx;
-    uint8_t ipmb_buffer_rx[IPMI_MSG_MAX_LENGTH];
+    uint8_t *ipmb_buffer_rx;
     uint8_t rx_len;
 
     for ( ;; ) {
-        /* Checks if there's any incoming messages (the task remains blocked here) */
-        rx_len = xI2CSlaveReceive( IPMB_I2C, &ipmb_buffer_rx[1], IPMI_MSG_MAX_LENGTH - 1, portMAX_DELAY );
+        /* Checks if there's any incoming messages (the task remains blocked here).
+         * The frame is read in place from the I2C driver receive ring, already starting with our address byte */
+        rx_len = xI2CSlaveReceive( IPMB_I2C, &ipmb_buffer_rx, portMAX_DELAY );
 
-        if ( rx_len > 0 ) {
+        if ( rx_len == 0 ) {
+            continue;
+        }
 
-            ipmb_buffer_rx[0] = ipmb_addr;
-            rx_len++;
+        /* Perform a checksum test on the message, if it doesn't pass, just ignore it.
+         * Following the IPMB specs, we have no way to know if we're the one who should
+         * receive it. In MicroTCA crates with star topology for IPMB, we are assured we
+         * are the recipients, however, malformed messages may be safely ignored as the
+         * MCMC should take care of retrying.
+         */
+
+        if ( ( rx_len > IPMI_MSG_MAX_LENGTH ) || ( ipmb_assert_chksum( ipmb_buffer_rx, rx_len ) != ipmb_error_success ) ) {
+            IPMB_STATS_INC( stats.chksum_errors );
+            vI2CSlaveRelease( IPMB_I2C );
+            continue;
+        }
 
-            /* Perform a checksum test on the message, if it doesn't pass, just ignore it.
-             * Following the IPMB specs, we have no way to know if we're the one who should
-             * receive it. In MicroTCA crates with star topology for IPMB, we are assured we
-             * are the recipients, however, malformed messages may be safely ignored as the
-             * MCMC should take care of retrying.
-             */
+        /* The pool hands out cleared buffers. If it's exhausted, drop the message and let the MCMC retry it */
+        current_msg_rx = ipmb_msg_alloc();
 
-            if ( ipmb_assert_chksum( ipmb_buffer_rx, rx_len ) != ipmb_error_success ) {
-                continue;
-            }
+        if ( current_msg_rx == NULL ) {
+            vI2CSlaveRelease( IPMB_I2C );
+            continue;
+        }
 
-            current_msg_rx = pvPortMalloc(sizeof(ipmi_msg_cfg));
+        ipmb_decode( &(current_msg_rx->buffer), ipmb_buffer_rx, rx_len );
 
-            /* Clear our local buffer before writing new data into it */
-            memset(current_msg_rx, 0, sizeof(ipmi_msg_cfg));
+        /* The frame has been decoded, give its slot back to the driver */
+        vI2CSlaveRelease( IPMB_I2C );
 
-            ipmb_decode( &(current_msg_rx->buffer), ipmb_buffer_rx, rx_len );
+        if ( IS_RESPONSE( current_msg_rx->buffer ) ) {
+            /* The message is a response, look for the request waiting on its sequence number */
+            ipmi_msg_cfg *req_cfg = ipmb_match_response( &current_msg_rx->buffer );
 
-            if ( IS_RESPONSE( current_msg_rx->buffer ) ) {
-                /* The message is a response, check if it's been received in time */
-                if ( (xTaskGetTickCount() - last_sent_req->timestamp) < IPMB_MSG_TIMEOUT ) {
-                    /* Seq number checking is enough to match the messages */
-                    if ( current_msg_rx->buffer.seq == last_sent_req->buffer.seq ) {
-                        ipmb_notify_client ( current_msg_rx );
-                    } else {
-                        vPortFree(current_msg_rx);
-                    }
-                    /* If we received a response that doesn't match a previously sent request, just discard it */
-                } else {
-                    vPortFree(current_msg_rx);
-                }
-
-            }else {
-                /* The received message is a request */
-
-                /* Notify the client about the new request */
+            if ( req_cfg != NULL ) {
+                IPMB_STATS_INC( stats.responses_rx );
+                /* The request has been answered, we don't need it anymore */
+                ipmb_msg_free( req_cfg );
                 ipmb_notify_client ( current_msg_rx );
+            } else {
+                /* If we received a response that doesn't match a previously sent request, just discard it */
+                ipmb_msg_free(current_msg_rx);
             }
+
+        }else {
+            /* The received message is a request, keep its arrival time to measure the response turnaround */
+            current_msg_rx->timestamp = xTaskGetTickCount();
+            IPMB_STATS_INC( stats.requests_rx[( current_msg_rx->buffer.netfn >> 1 ) % IPMB_STATS_NETFN_COUNT] );
+
+            /* Notify the client about the new request */
+            ipmb_notify_client ( current_msg_rx );
         }
     }
 }
@@ -249,7 +467,11 @@ void ipmb_init ( void )
 
 ipmb_error ipmb_send_request ( ipmi_msg * req )
 {
-    ipmi_msg_cfg *req_cfg = pvPortMalloc( sizeof( ipmi_msg_cfg ) );
+    ipmi_msg_cfg *req_cfg = ipmb_msg_alloc();
+
+    if ( req_cfg == NULL ) {
+        return ipmb_error_failure;
+    }
 
     /* Builds the message according to the IPMB specification */
 
@@ -259,29 +481,35 @@ ipmb_error ipmb_send_request ( ipmi_msg * req )
     req_cfg->buffer.dest_addr = MCH_ADDRESS;
     req_cfg->buffer.dest_LUN = 0;
     req_cfg->buffer.src_addr = ipmb_addr;
-    req_cfg->buffer.seq = current_seq++;
     req_cfg->buffer.src_LUN = 0;
     req_cfg->caller_task = xTaskGetCurrentTaskHandle();
     req_cfg->retries = 0;
 
+    /* Reserve a sequence number, so the response can be matched to this request */
+    if ( !ipmb_seq_alloc( req_cfg ) ) {
+        ipmb_msg_free( req_cfg );
+        return ipmb_error_failure;
+    }
+
     /* Blocks here until is able put message in tx queue */
     if (xQueueSend( ipmb_txqueue, &req_cfg, portMAX_DELAY) != pdTRUE ){
-        vPortFree( req_cfg );
+        ipmb_seq_release( req_cfg->buffer.seq );
+        ipmb_msg_free( req_cfg );
         return ipmb_error_failure;
     }
 
-    /* Use this notification to block the function while the response does not arrive */
+    /* Use this notification to block the function until the request is on the wire */
     return ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
 }
 
-ipmb_error ipmb_send_response ( ipmi_msg * req, ipmi_msg * resp )
+ipmb_error ipmb_send_response ( ipmi_msg_cfg * req_cfg, ipmi_msg_cfg * resp_cfg )
 {
-    ipmi_msg_cfg *resp_cfg = pvPortMalloc( sizeof(ipmi_msg_cfg) );
+    configASSERT( req_cfg );
+    configASSERT( resp_cfg );
 
-    /* Builds the message according to the IPMB specification */
+    ipmi_msg *req = &req_cfg->buffer;
 
-    /* Copies data from the response msg struct passed by caller */
-    memcpy( &(resp_cfg->buffer), resp, sizeof(ipmi_msg));
+    /* Builds the message according to the IPMB specification, the response payload is already in place */
 
     /* Write necessary fields (should be garbage data by now) */
     resp_cfg->buffer.dest_addr = req->src_addr;
@@ -293,10 +521,12 @@ ipmb_error ipmb_send_response ( ipmi_msg * req, ipmi_msg * resp )
     resp_cfg->buffer.cmd = req->cmd;
     resp_cfg->caller_task = xTaskGetCurrentTaskHandle();
     resp_cfg->retries = 0;
+    /* Reception time of the request, for the turnaround statistics */
+    resp_cfg->timestamp = req_cfg->timestamp;
 
     /* Blocks here until is able put message in tx queue */
     if ( xQueueSend( ipmb_txqueue, &resp_cfg, portMAX_DELAY) != pdTRUE ){
-        vPortFree( resp_cfg );
+        ipmb_msg_free( resp_cfg );
         return ipmb_error_failure;
     }
 
@@ -308,29 +538,57 @@ ipmb_error ipmb_notify_client ( ipmi_msg_cfg * msg_cfg )
 {
     configASSERT( client_queue );
     configASSERT( msg_cfg );
-    /* Sends only the ipmi msg, not the control struct */
-    if (!IS_RESPONSE(msg_cfg->buffer)) {
-        if ( xQueueSend( client_queue, &(msg_cfg->buffer), CLIENT_NOTIFY_TIMEOUT ) == pdFALSE ) {
-            /* This shouldn't happen, but if it does, clear the message buffer, since the IPMB_TX task gives us its ownership */
-            vPortFree( msg_cfg );
-            return ipmb_error_timeout;
-        }
-    }
     if ( msg_cfg->caller_task ) {
         xTaskNotifyGive( msg_cfg->caller_task );
     }
 
-    /* The message has already been copied to the responsible task, free it so we don't run out of resources */
-    vPortFree( msg_cfg );
+    if (IS_RESPONSE(msg_cfg->buffer)) {
+        /* Nobody consumes responses, release the buffer so we don't run out of resources */
+        ipmb_msg_free( msg_cfg );
+        return ipmb_error_success;
+    }
+
+    /* Requests are handed over to the client, which becomes the buffer owner */
+    if ( xQueueSend( client_queue, &msg_cfg, CLIENT_NOTIFY_TIMEOUT ) == pdFALSE ) {
+        /* This shouldn't happen, but if it does, clear the message buffer, since the IPMB_RX task gives us its ownership */
+        IPMB_STATS_INC( stats.client_queue_overflows );
+        ipmb_msg_free( msg_cfg );
+        return ipmb_error_timeout;
+    }
 
     return ipmb_error_success;
 }
 
+const ipmb_stats * ipmb_get_stats( void )
+{
+    i2c_master_stats_t i2c_stats;
+
+    /* The IPMB bus is only used by this layer, so its I2C counters are ours */
+    vI2CMasterGetStats( IPMB_I2C, &i2c_stats );
+    stats.naks = i2c_stats.naks - i2c_stats_base.naks;
+    stats.arblost = i2c_stats.arblost - i2c_stats_base.arblost;
+
+    return &stats;
+}
+
+void ipmb_reset_stats( void )
+{
+    taskENTER_CRITICAL();
+    memset( &stats, 0, sizeof( stats ) );
+    vI2CMasterGetStats( IPMB_I2C, &i2c_stats_base );
+    taskEXIT_CRITICAL();
+}
+
+void ipmb_stats_add_handler_time( TickType_t ticks )
+{
+    ipmb_stats_add_hist( stats.handler_hist, ticks );
+}
+
 ipmb_error ipmb_register_rxqueue ( QueueHandle_t * queue )
 {
     configASSERT( queue != NULL );
 
-    *queue = xQueueCreate( IPMB_CLIENT_QUEUE_LEN, sizeof( ipmi_msg ) );
+    *queue = xQueueCreate( IPMB_CLIENT_QUEUE_LEN, sizeof( ipmi_msg_cfg * ) );
     vQueueAddToRegistry(*queue, "ipmi_rx_queue");
     /* Copies the queue handler so we know where to write */
     client_queue = *queue;
@@ -406,3 +664,55 @@ ipmb_error ipmb_decode ( ipmi_msg * msg, uint8_t * buffer, uint8_t len )
 
     return ipmb_error_success;
 }
+
+ipmi_msg_cfg * ipmb_msg_alloc( void )
+{
+    uint32_t used = __atomic_load_n( &ipmb_pool_used_mask, __ATOMIC_ACQUIRE );
+    uint8_t idx;
+    uint8_t in_use;
+    uint8_t high_water;
+
+    do {
+        if ( ( ~used & IPMB_MSG_POOL_MASK ) == 0 ) {
+            __atomic_fetch_add( &ipmb_pool_alloc_failures, 1, __ATOMIC_RELAXED );
+            return NULL;
+        }
+        idx = __builtin_ctz( ~used );
+    } while ( !__atomic_compare_exchange_n( &ipmb_pool_used_mask, &used, used | ( 1UL << idx ), true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) );
+
+    /* Update the high-water mark with the occupancy seen right after our claim */
+    in_use = __builtin_popcount( used ) + 1;
+    high_water = __atomic_load_n( &ipmb_pool_high_water, __ATOMIC_RELAXED );
+    while ( in_use > high_water ) {
+        if ( __atomic_compare_exchange_n( &ipmb_pool_high_water, &high_water, in_use, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ) {
+            break;
+        }
+    }
+
+    memset( &ipmb_msg_pool[idx], 0, sizeof( ipmi_msg_cfg ) );
+
+    return &ipmb_msg_pool[idx];
+}
+
+void ipmb_msg_free( ipmi_msg_cfg * msg_cfg )
+{
+    if ( msg_cfg == NULL ) {
+        return;
+    }
+
+    uint32_t idx = msg_cfg - ipmb_msg_pool;
+
+    configASSERT( idx < IPMB_MSG_POOL_LEN );
+
+    __atomic_fetch_and( &ipmb_pool_used_mask, ~( 1UL << idx ), __ATOMIC_RELEASE );
+}
+
+void ipmb_get_pool_stats( ipmb_pool_stats * stats )
+{
+    configASSERT( stats );
+
+    stats->size = IPMB_MSG_POOL_LEN;
+    stats->in_use = __builtin_popcount( __atomic_load_n( &ipmb_pool_used_mask, __ATOMIC_RELAXED ) );
+    stats->high_water = __atomic_load_n( &ipmb_pool_high_water, __ATOMIC_RELAXED );
+    stats->alloc_failures = __atomic_load_n( &ipmb_pool_alloc_failures, __ATOMIC_RELAXED );
+}
@@ -35,6 +35,7 @@
 #include "queue.h"
 #include "semphr.h"
 #include "board_ipmb.h"
+#include <stdbool.h>
 
 
 /**
@@ -52,6 +53,14 @@
  */
 #define IPMB_CLIENT_QUEUE_LEN   10
 
+/**
+ * @brief Amount of message buffers in the IPMB message pool
+ *
+ * Every message in the IPMB path (queued for transmission, waiting in the client queue, being handled or waiting for its response) holds one of these buffers.
+ * @note Must be lower than 32
+ */
+#define IPMB_MSG_POOL_LEN       24
+
 /**
  * @brief Maximum retries made by IPMB TX Task when sending a message
  */
@@ -60,7 +69,14 @@
 /**
  * @brief Timeout limit between the end of a request and start of a response (defined in IPMB timing specifications)
  */
-#define IPMB_MSG_TIMEOUT        250/portTICK_PERIOD_MS
+#define IPMB_MSG_TIMEOUT        (250/portTICK_PERIOD_MS)
+
+/**
+ * @brief Size of the pending requests table
+ *
+ * The table is indexed directly by the 6-bit rqSeq field, so each possible sequence number owns exactly one entry
+ */
+#define IPMB_SEQ_TABLE_LEN      64
 
 /**
  * @brief Timeout limit waiting a free space in client queue to put a received message
@@ -175,6 +191,56 @@ typedef struct ipmi_msg_cfg {
     uint32_t timestamp;                 /**< Tick count at the beginning of the process */
 } ipmi_msg_cfg;
 
+/**
+ * @brief Outstanding request entry
+ *
+ * One of these is kept for each rqSeq value, so several requests can wait for their responses at the same time
+ */
+typedef struct ipmb_pending_req {
+    ipmi_msg_cfg *req;                  /**< Request that owns this sequence number, NULL if the entry is free */
+    bool in_flight;                     /**< Request has been put on the wire and is waiting for its response */
+} ipmb_pending_req;
+
+/**
+ * @brief IPMB message pool statistics
+ */
+typedef struct ipmb_pool_stats {
+    uint8_t size;                       /**< Amount of buffers in the pool */
+    uint8_t in_use;                     /**< Buffers currently allocated */
+    uint8_t high_water;                 /**< Highest amount of buffers allocated at the same time */
+    uint32_t alloc_failures;            /**< Allocations refused because the pool was exhausted */
+} ipmb_pool_stats;
+
+/**
+ * @brief Number of per-netfn counters kept in #ipmb_stats (one per request/response netfn pair)
+ */
+#define IPMB_STATS_NETFN_COUNT          32
+
+/**
+ * @brief Number of buckets in the IPMB latency histograms
+ *
+ * Bucket 0 counts times below 1 tick, bucket n counts times from 2^(n-1) to 2^n - 1 ticks and the last bucket everything above.
+ */
+#define IPMB_STATS_HIST_BUCKETS         10
+
+/**
+ * @brief IPMB link-layer statistics
+ */
+typedef struct ipmb_stats {
+    uint32_t requests_rx[IPMB_STATS_NETFN_COUNT];       /**< Requests received, indexed by netfn >> 1 */
+    uint32_t responses_tx[IPMB_STATS_NETFN_COUNT];      /**< Responses sent, indexed by netfn >> 1 */
+    uint32_t requests_tx;                               /**< Requests sent (events) */
+    uint32_t responses_rx;                              /**< Responses received that matched a request */
+    uint32_t chksum_errors;                             /**< Frames dropped due to a bad checksum or length */
+    uint32_t naks;                                      /**< I2C transfers not acknowledged */
+    uint32_t arblost;                                   /**< I2C arbitration losses */
+    uint32_t retries;                                   /**< Message retransmissions */
+    uint32_t tx_failures;                               /**< Messages given up after #IPMB_MAX_RETRIES */
+    uint32_t client_queue_overflows;                    /**< Requests dropped because the client queue was full */
+    uint32_t turnaround_hist[IPMB_STATS_HIST_BUCKETS];  /**< Time from the reception of a request to its response on the wire, in ticks */
+    uint32_t handler_hist[IPMB_STATS_HIST_BUCKETS];     /**< Time spent in the IPMI handlers, in ticks */
+} ipmb_stats;
+
 /**
  * @brief IPMB errors enumeration
  */
@@ -206,12 +272,13 @@ extern uint8_t ipmb_addr;
  * When #ipmb_send_request or #ipmb_send_response put a message in #ipmb_txqueue, this task unblocks.
  * First step to send a message is differentiating requests from responses. It does this analyzing the parity of NetFN (even for requests, odd for responses).
  *
- * When sending a response, this task has to check if it matches with the sequence number from the last known request and the amount of time it took to be built (timeout checking). Last step is checking if it has already tried to send this message more than #IPMB_MAX_RETRIES value. <br>
+ * When sending a response, the only check made is whether it has already tried to send this message more than #IPMB_MAX_RETRIES times. <br>
  * After passing all checking, the message is formatted as the IPMB protocol demands and passed down to the I2C driver, using the function xI2CWrite(). <br>
  * If an error comes out of the I2C driver when sending the message, it increases the retry counter in the #ipmi_msg_cfg struct and send the message to the front of #ipmb_txqueue. <br>
  * If no errors occurs, the task that put the message in the queue is notified with a success flag.
  *
- * The proccess is analog when sending a request, but the only check that is made is the retry number. The task skip all checking because, when sending a request, the message is formatted using it's own functions #ipmb_send_request or #ipmb_send_response and they are guaranteed to put only valid messages in queue.
+ * Requests already own an entry in the pending requests table (indexed by their sequence number) when they get here. Once a request is on the wire, its entry is marked as in flight and waits there for the matching response. <br>
+ * This task also blocks on #ipmb_txqueue only until the oldest in-flight request expires: every request that went #IPMB_MSG_TIMEOUT ticks without a response is retransmitted, up to #IPMB_MAX_RETRIES times, and then dropped.
  * @param pvParameters: Default parameter to FreeRTOS tasks, not used here.
  * @see IPMB_RXTask
  * @see ipmb_send_request
@@ -223,12 +290,11 @@ void IPMB_TXTask ( void *pvParameters );
  * @brief IPMB Receiver Task
  *
  * Similarly to #IPMB_TXTask, this task remains blocked until a new message is received by the I2C driver. The message passes through checksum checking to assure its integrity. <br>
- * If the message is a request, we have to check if it's a new one or just a retransmission of the last. In order to do this, the sequential number is tested, since every request has a different one.<br>
- * Right after that, the arrival time and the message body are stored for future checking and the specified client is notified using #ipmb_notify_client.
+ * Requests are delivered to the client task using #ipmb_notify_client.
  *
- * If we have received a response instead, we match it with the last stored request and also check if the awating request hasn't timed-out yet.
+ * If we have received a response instead, we look up the pending requests table entry of its sequence number and check that it answers the request stored there (same command, netfn and address). A matching response releases the entry, so the sequence number can be used again.
  *
- * @note When a malformed message, a response without a request or a repeated request are received, they are just ignored, following the IPMB specifications.
+ * @note When a malformed message or a response without a request are received, they are just ignored, following the IPMB specifications.
  *
  * @param pvParameters: Default parameter to FreeRTOS tasks, not used here.
  * @see IPMB_TXTask
@@ -245,19 +311,80 @@ void ipmb_init ( void );
 
 /**
  * @brief Format and send a request via IPMB channel
+ *
+ * A free sequence number is reserved in the pending requests table for this request, so it doesn't have to wait for the response of any other request in flight.
+ * This function blocks only until the request has been put on the wire, the response is matched later by #IPMB_RXTask.
+ *
+ * @param req Request to be sent
+ *
+ * @retval ipmb_error_success The request was sent
+ * @retval ipmb_error_failure The request couldn't be sent or there's no free sequence number left
  */
 ipmb_error ipmb_send_request ( ipmi_msg * req );
 
 /**
  * @brief Format and send a response via IPMB channel
+ *
+ * The response is sent straight from the given buffer, only its header fields are filled from the request.
+ *
+ * @param req_cfg Request being answered, as received from the client queue
+ * @param resp_cfg Response buffer obtained from #ipmb_msg_alloc. Its ownership is passed to the IPMB layer, the caller must not use it after this call.
+ *
+ * @retval ipmb_error_success The response was sent
+ * @retval ipmb_error_failure The response couldn't be sent
+ */
+ipmb_error ipmb_send_response ( ipmi_msg_cfg * req_cfg, ipmi_msg_cfg * resp_cfg );
+
+/**
+ * @brief Takes a message buffer from the IPMB message pool
+ *
+ * The pool is lock-free, so this function may be called from any task.
+ *
+ * @return Pointer to a cleared message buffer, or NULL if the pool is exhausted
+ */
+ipmi_msg_cfg * ipmb_msg_alloc( void );
+
+/**
+ * @brief Returns a message buffer to the IPMB message pool
+ *
+ * @param msg_cfg Buffer obtained from #ipmb_msg_alloc (NULL is ignored)
+ */
+void ipmb_msg_free( ipmi_msg_cfg * msg_cfg );
+
+/**
+ * @brief Reads the IPMB message pool occupancy statistics
+ *
+ * @param[out] stats Pointer to the struct that will receive the statistics
+ */
+void ipmb_get_pool_stats( ipmb_pool_stats * stats );
+
+/**
+ * @brief Gets the IPMB link-layer statistics
+ *
+ * The counters are updated in place, so they're only guaranteed to be consistent with each other while the link is idle.
+ *
+ * @return Pointer to the statistics
+ */
+const ipmb_stats * ipmb_get_stats( void );
+
+/**
+ * @brief Clears the IPMB link-layer statistics
+ */
+void ipmb_reset_stats( void );
+
+/**
+ * @brief Records the time spent by an IPMI handler in the handler time histogram
+ *
+ * @param ticks Handler execution time
  */
-ipmb_error ipmb_send_response ( ipmi_msg * req, ipmi_msg * resp );
+void ipmb_stats_add_handler_time( TickType_t ticks );
 
 /**
  * @brief Creates and returns a queue in which the client can block to receive the incoming requests.
  *
  * The queue is created and its handler is written at the given pointer (queue).
  * Also keeps a copy of the handler to know where to write the incoming messages.
+ * The queue items are pointers to #ipmi_msg_cfg buffers from the IPMB message pool. The client owns each received buffer and must release it with #ipmb_msg_free.
  *
  * @param queue Pointer to a QueueHandle_t variable which will be written by this function.
  *
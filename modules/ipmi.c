@@ -32,12 +32,17 @@
 
 /* Project includes */
 #include "FreeRTOS.h"
+#include "semphr.h"
 #include "ipmi.h"
 #include "port.h"
 #include "task_priorities.h"
 #include "led.h"
 #include "payload.h"
 #include "uart_debug.h"
+#include "utils.h"
+#ifdef MODULE_SEL
+#include "sel.h"
+#endif
 
 /* Local variables */
 /**
@@ -55,41 +60,376 @@ volatile const t_req_handler_record *ipmiEntries = (t_req_handler_record *) &_ip
  */
 volatile const t_req_handler_record *ipmiEntries_end = (t_req_handler_record *) &_eipmi_handlers;
 
+/**
+ * @brief Hash index of the IPMI handlers list, keyed by netfn and command
+ *
+ * Each entry holds the position of a handler record in the list plus one, 0 marks an empty entry.
+ * Collisions are resolved by linear probing.
+ */
+static uint8_t ipmi_handler_index[IPMI_HANDLER_INDEX_SIZE];
+
+/**
+ * @brief Set if some handler didn't fit in #ipmi_handler_index, so lookups must fall back to a linear search
+ */
+static bool ipmi_handler_index_overflow;
+
+/**
+ * @brief Queue that feeds #IPMIDeferredTask with the requests of deferred handlers
+ */
+static QueueHandle_t ipmi_deferred_queue = NULL;
+
+/**
+ * @brief Deferred requests currently queued or being handled, used to spot retransmissions
+ *
+ * Filled by the dispatcher and cleared by the worker once the response is sent. Having as many slots as the queue has items
+ * guarantees the queue always has room for a request that got a slot.
+ */
+static ipmi_msg_cfg * ipmi_deferred_reqs[IPMI_DEFERRED_QUEUE_LEN];
+
+/**
+ * @brief Recently sent responses, used to answer retransmitted requests
+ */
+static ipmi_resp_cache_entry ipmi_resp_cache[IPMI_RESP_CACHE_LEN];
+
+static ipmi_resp_cache_stats resp_cache_stats;
+
+static const t_req_handler_record * ipmi_retrieve_handler_record( uint8_t netfn, uint8_t cmd );
+
+static uint16_t ipmi_resp_cache_crc( const ipmi_msg * req )
+{
+    return calculate_crc16( req->data, req->data_len, 0xFFFF );
+}
+
+/*
+ * The request data is part of the key: a requester may wrap its sequence numbers within the window, e.g. during a
+ * Get SDR or Read FRU Data burst, where only the offsets tell the requests apart
+ */
+static bool ipmi_resp_cache_match( const ipmi_resp_cache_entry * entry, const ipmi_msg * req, uint16_t req_crc )
+{
+    return ( entry->valid && ( entry->src_addr == req->src_addr ) && ( entry->seq == req->seq ) &&
+             ( entry->netfn == req->netfn ) && ( entry->cmd == req->cmd ) &&
+             ( entry->req_len == req->data_len ) && ( entry->req_crc == req_crc ) );
+}
+
+/**
+ * @brief Looks for a response already sent to the given request
+ *
+ * @param[in]  req Received request
+ * @param[out] rsp Filled with the cached completion code and data on a hit
+ *
+ * @return true if a response younger than #IPMI_RESP_CACHE_WINDOW was found
+ */
+static bool ipmi_resp_cache_lookup( const ipmi_msg * req, ipmi_msg * rsp )
+{
+    TickType_t now = xTaskGetTickCount();
+    uint16_t req_crc = ipmi_resp_cache_crc( req );
+    bool hit = false;
+
+    taskENTER_CRITICAL();
+    for ( int i = 0; i < IPMI_RESP_CACHE_LEN; i++ ) {
+        ipmi_resp_cache_entry *entry = &ipmi_resp_cache[i];
+
+        if ( !ipmi_resp_cache_match( entry, req, req_crc ) ) {
+            continue;
+        }
+
+        if ( ( now - entry->timestamp ) >= IPMI_RESP_CACHE_WINDOW ) {
+            /* The requester is reusing the sequence number for a new request */
+            entry->valid = false;
+            break;
+        }
+
+        rsp->completion_code = entry->completion_code;
+        rsp->data_len = entry->data_len;
+        memcpy( rsp->data, entry->data, entry->data_len );
+        hit = true;
+        break;
+    }
+
+    if ( hit ) {
+        resp_cache_stats.hits++;
+    } else {
+        resp_cache_stats.misses++;
+    }
+    taskEXIT_CRITICAL();
+
+    return hit;
+}
+
+/**
+ * @brief Keeps a copy of the response given to a request, replacing the oldest entry if the cache is full
+ *
+ * Transient answers (node busy, command in progress) aren't cached, so a retry runs the handler.
+ */
+static void ipmi_resp_cache_store( const ipmi_msg * req, const ipmi_msg * rsp )
+{
+    TickType_t now = xTaskGetTickCount();
+    uint16_t req_crc = ipmi_resp_cache_crc( req );
+    ipmi_resp_cache_entry *slot = NULL;
+
+    if ( ( rsp->completion_code == IPMI_CC_NODE_BUSY ) || ( rsp->completion_code == IPMI_CC_COMMAND_IN_PROGRESS ) ) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    for ( int i = 0; i < IPMI_RESP_CACHE_LEN; i++ ) {
+        ipmi_resp_cache_entry *entry = &ipmi_resp_cache[i];
+
+        if ( !entry->valid || ipmi_resp_cache_match( entry, req, req_crc ) ) {
+            slot = entry;
+            break;
+        }
+        if ( ( slot == NULL ) || ( ( now - entry->timestamp ) > ( now - slot->timestamp ) ) ) {
+            slot = entry;
+        }
+    }
+
+    slot->src_addr = req->src_addr;
+    slot->seq = req->seq;
+    slot->netfn = req->netfn;
+    slot->cmd = req->cmd;
+    slot->req_len = req->data_len;
+    slot->req_crc = req_crc;
+    slot->timestamp = now;
+    slot->completion_code = rsp->completion_code;
+    slot->data_len = rsp->data_len;
+    memcpy( slot->data, rsp->data, rsp->data_len );
+    slot->valid = true;
+    taskEXIT_CRITICAL();
+}
+
+void ipmi_get_resp_cache_stats( ipmi_resp_cache_stats * stats )
+{
+    taskENTER_CRITICAL();
+    *stats = resp_cache_stats;
+    taskEXIT_CRITICAL();
+}
+
+static uint8_t ipmi_handler_hash( uint8_t netfn, uint8_t cmd )
+{
+    /* Multiplicative (Fibonacci) hashing of the 16-bit key */
+    uint32_t key = ( (uint32_t) netfn << 8 ) | cmd;
+
+    return ( key * 2654435761UL ) >> ( 32 - IPMI_HANDLER_INDEX_BITS );
+}
+
+/**
+ * @brief Builds #ipmi_handler_index from the linker-collected handlers list
+ *
+ * Handlers registered more than once for the same netfn and command are reported and only the first one is kept, as the linear search used to do.
+ */
+static void ipmi_build_handler_index( void )
+{
+    const t_req_handler_record *entries = (const t_req_handler_record *) ipmiEntries;
+    uint32_t count = (const t_req_handler_record *) ipmiEntries_end - entries;
+
+    memset( ipmi_handler_index, 0, sizeof( ipmi_handler_index ) );
+    ipmi_handler_index_overflow = false;
+
+    for ( uint32_t i = 0; i < count; i++ ) {
+        uint8_t pos = ipmi_handler_hash( entries[i].netfn, entries[i].cmd );
+        uint32_t probes;
+
+        for ( probes = 0; probes < IPMI_HANDLER_INDEX_SIZE; probes++ ) {
+            uint8_t idx = ipmi_handler_index[pos];
+
+            if ( idx == 0 ) {
+                /* Positions above 254 can't be stored in the index */
+                if ( i < UINT8_MAX ) {
+                    ipmi_handler_index[pos] = i + 1;
+                } else {
+                    ipmi_handler_index_overflow = true;
+                }
+                break;
+            }
+
+            if ( ( entries[idx-1].netfn == entries[i].netfn ) && ( entries[idx-1].cmd == entries[i].cmd ) ) {
+                printf( "[IPMI] Duplicated handler for NetFn 0x%02X CMD 0x%02X, ignoring it!\n", entries[i].netfn, entries[i].cmd );
+                break;
+            }
+
+            pos = ( pos + 1 ) & ( IPMI_HANDLER_INDEX_SIZE - 1 );
+        }
+
+        if ( probes == IPMI_HANDLER_INDEX_SIZE ) {
+            ipmi_handler_index_overflow = true;
+        }
+    }
+
+    if ( ipmi_handler_index_overflow ) {
+        printf( "[IPMI] Too many handlers for the lookup index, increase IPMI_HANDLER_INDEX_BITS!\n" );
+    }
+}
+
+/**
+ * @brief Hands a request over to the deferred worker task
+ *
+ * @param[in] req_cfg Request buffer, owned by the worker task if #IPMI_CC_OK is returned
+ *
+ * @return #IPMI_CC_OK if the request was queued, #IPMI_CC_COMMAND_IN_PROGRESS if it is a retransmission of a request
+ * still being handled or #IPMI_CC_NODE_BUSY if the worker can't take more requests
+ */
+static uint8_t ipmi_defer_request( ipmi_msg_cfg * req_cfg )
+{
+    ipmi_msg *req = &req_cfg->buffer;
+    int free_slot = -1;
+
+    taskENTER_CRITICAL();
+    for ( int i = 0; i < IPMI_DEFERRED_QUEUE_LEN; i++ ) {
+        ipmi_msg *pending = ( ipmi_deferred_reqs[i] ) ? &ipmi_deferred_reqs[i]->buffer : NULL;
+
+        if ( pending == NULL ) {
+            if ( free_slot < 0 ) {
+                free_slot = i;
+            }
+            continue;
+        }
+
+        if ( ( pending->src_addr == req->src_addr ) && ( pending->seq == req->seq ) &&
+             ( pending->netfn == req->netfn ) && ( pending->cmd == req->cmd ) ) {
+            taskEXIT_CRITICAL();
+            return IPMI_CC_COMMAND_IN_PROGRESS;
+        }
+    }
+
+    if ( free_slot < 0 ) {
+        taskEXIT_CRITICAL();
+        return IPMI_CC_NODE_BUSY;
+    }
+    ipmi_deferred_reqs[free_slot] = req_cfg;
+    taskEXIT_CRITICAL();
+
+    if ( xQueueSend( ipmi_deferred_queue, &req_cfg, 0 ) != pdTRUE ) {
+        ipmi_deferred_reqs[free_slot] = NULL;
+        return IPMI_CC_NODE_BUSY;
+    }
+
+    return IPMI_CC_OK;
+}
+
+void IPMIDeferredTask( void * pvParameters )
+{
+    ipmi_msg_cfg *req_cfg;
+    ipmi_msg_cfg *resp_cfg;
+    const t_req_handler_record *record;
+    ipmb_error error_code;
+    TickType_t handler_start;
+
+    for ( ;; ) {
+        xQueueReceive( ipmi_deferred_queue, &req_cfg, portMAX_DELAY );
+
+        record = ipmi_retrieve_handler_record( req_cfg->buffer.netfn, req_cfg->buffer.cmd );
+        configASSERT( record );
+
+        /* Wait for a response buffer instead of dropping the request, the dispatcher keeps answering retries meanwhile */
+        while ( ( resp_cfg = ipmb_msg_alloc() ) == NULL ) {
+            vTaskDelay( 1 );
+        }
+
+        resp_cfg->buffer.completion_code = IPMI_CC_UNSPECIFIED_ERROR;
+        resp_cfg->buffer.data_len = 0;
+
+        handler_start = xTaskGetTickCount();
+        record->req_handler( &req_cfg->buffer, &resp_cfg->buffer );
+        ipmb_stats_add_handler_time( xTaskGetTickCount() - handler_start );
+
+        ipmi_resp_cache_store( &req_cfg->buffer, &resp_cfg->buffer );
+
+        /* The response carries the sequence number of the original request */
+        error_code = ipmb_send_response( req_cfg, resp_cfg );
+        configASSERT( (error_code == ipmb_error_success) );
+
+        taskENTER_CRITICAL();
+        for ( int i = 0; i < IPMI_DEFERRED_QUEUE_LEN; i++ ) {
+            if ( ipmi_deferred_reqs[i] == req_cfg ) {
+                ipmi_deferred_reqs[i] = NULL;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        ipmb_msg_free( req_cfg );
+    }
+}
+
 void IPMITask( void * pvParameters )
 {
-    ipmi_msg req_received;
-    ipmi_msg response;
+    ipmi_msg_cfg *req_cfg;
+    ipmi_msg_cfg *resp_cfg;
+    ipmi_msg *req_received;
     ipmb_error error_code;
-    t_req_handler req_handler = (t_req_handler) 0;
+    const t_req_handler_record *record;
+    uint8_t defer_cc;
+    TickType_t handler_start;
 
     for ( ;; ) {
 
-        if( xQueueReceive( ipmi_rxqueue, &req_received , portMAX_DELAY ) == pdFALSE) {
+        if( xQueueReceive( ipmi_rxqueue, &req_cfg , portMAX_DELAY ) == pdFALSE) {
             /* Should no return pdFALSE */
             configASSERT(pdFALSE);
             continue;
         }
+
+        req_received = &req_cfg->buffer;
 #if 0
         printf(" IPMI Message Received: \n ");
-        printf(" \tNETFn: 0x%X\tCMD: 0x%X\t Data: ", req_received.netfn, req_received.cmd);
-        for (int i=0; i < req_received.data_len; i++) {
-            printf("0x%X ", req_received.data[i]);
+        printf(" \tNETFn: 0x%X\tCMD: 0x%X\t Data: ", req_received->netfn, req_received->cmd);
+        for (int i=0; i < req_received->data_len; i++) {
+            printf("0x%X ", req_received->data[i]);
         }
         printf("\n");
 #endif
-        req_handler = (t_req_handler) 0;
-        req_handler = ipmi_retrieve_handler(req_received.netfn, req_received.cmd);
+        /* The response is built directly in the buffer that will be transmitted */
+        resp_cfg = ipmb_msg_alloc();
+
+        if (resp_cfg == NULL) {
+            /* No buffer left to answer, drop the request and let the MCH retry it */
+            ipmb_msg_free(req_cfg);
+            continue;
+        }
+
+        if (ipmi_resp_cache_lookup(req_received, &resp_cfg->buffer)) {
+            /* Retransmission of an already answered request, repeat the response without running the handler again */
+            error_code = ipmb_send_response(req_cfg, resp_cfg);
+            configASSERT((error_code == ipmb_error_success));
+
+            ipmb_msg_free(req_cfg);
+            continue;
+        }
+
+        record = ipmi_retrieve_handler_record(req_received->netfn, req_received->cmd);
+        defer_cc = IPMI_CC_OK;
+
+        if ((record != NULL) && (record->flags & IPMI_HANDLER_FLAG_DEFERRED)) {
+            defer_cc = ipmi_defer_request(req_cfg);
+
+            if (defer_cc == IPMI_CC_OK) {
+                /* The worker task answers it and releases the request buffer */
+                ipmb_msg_free(resp_cfg);
+                continue;
+            }
+        }
+
+        if (defer_cc != IPMI_CC_OK) {
+            /* Deferred handler still busy with this request or with too many others */
+            resp_cfg->buffer.completion_code = defer_cc;
+            resp_cfg->buffer.data_len = 0;
+            error_code = ipmb_send_response(req_cfg, resp_cfg);
+
+            configASSERT((error_code == ipmb_error_success));
 
-        if (req_handler != 0) {
+        } else if (record != NULL) {
 
-            response.completion_code = IPMI_CC_UNSPECIFIED_ERROR;
-            response.data_len = 0;
+            resp_cfg->buffer.completion_code = IPMI_CC_UNSPECIFIED_ERROR;
+            resp_cfg->buffer.data_len = 0;
 
             /// Call user-defined function, give request data and retrieve required response
-            /** @warning Since IPMI task have a high priority, this handler function should not wait other tasks to unblock */
-            req_handler(&req_received, &response);
+            /** @warning Since IPMI task have a high priority, this handler function should not wait other tasks to unblock, use IPMI_HANDLER_DEFERRED for slow handlers */
+            handler_start = xTaskGetTickCount();
+            record->req_handler(req_received, &resp_cfg->buffer);
+            ipmb_stats_add_handler_time(xTaskGetTickCount() - handler_start);
 
-            error_code = ipmb_send_response(&req_received, &response);
+            ipmi_resp_cache_store(req_received, &resp_cfg->buffer);
+            error_code = ipmb_send_response(req_cfg, resp_cfg);
 
             /** In case of error during IPMB response, the MMC may wait for a
                new command from the MCH. Check this for debugging purposes
@@ -101,81 +441,365 @@ void IPMITask( void * pvParameters )
              *  message to send "invalid command" response (IPMI table 5-2,
              *  page 44). */
 
-            response.completion_code = IPMI_CC_INV_CMD;
-            response.data_len = 0;
-            error_code = ipmb_send_response(&req_received, &response);
+            resp_cfg->buffer.completion_code = IPMI_CC_INV_CMD;
+            resp_cfg->buffer.data_len = 0;
+            error_code = ipmb_send_response(req_cfg, resp_cfg);
 
             configASSERT((error_code == ipmb_error_success));
         }
+
+        /* The request has been answered, give its buffer back to the pool */
+        ipmb_msg_free(req_cfg);
     }
 }
 
 TaskHandle_t TaskIPMI_Handle;
+TaskHandle_t TaskIPMIDeferred_Handle;
+TaskHandle_t TaskIPMIEvent_Handle;
+
+/*
+ * Given when an event is posted to the outbox. The event task's notification value is left to the IPMB layer,
+ * which reports the result of each request through it.
+ */
+static SemaphoreHandle_t ipmi_event_sem;
 
 void ipmi_init ( void )
 {
+    ipmi_build_handler_index();
     ipmb_init();
     ipmb_register_rxqueue( &ipmi_rxqueue );
+    ipmi_deferred_queue = xQueueCreate( IPMI_DEFERRED_QUEUE_LEN, sizeof(ipmi_msg_cfg *) );
+    vQueueAddToRegistry( ipmi_deferred_queue, "IPMI Deferred Queue" );
+    ipmi_event_sem = xSemaphoreCreateBinary();
     xTaskCreate( IPMITask, (const char*)"IPMI Dispatcher", 256, ( void * ) NULL, tskIPMI_PRIORITY, &TaskIPMI_Handle );
+    xTaskCreate( IPMIDeferredTask, (const char*)"IPMI Deferred", 256, ( void * ) NULL, tskIPMI_DEFERRED_PRIORITY, &TaskIPMIDeferred_Handle );
+    xTaskCreate( IPMIEventTask, (const char*)"IPMI Events", 150, ( void * ) NULL, tskIPMI_EVENT_PRIORITY, &TaskIPMIEvent_Handle );
 }
 
 /**
- * @brief Finds a handler associated with a given netfunction and command.
+ * @brief Finds the handler record associated with a given netfunction and command.
  *
  * @param[in] netfn 8-bit network function code
  * @param[in] cmd 8-bit command code
  *
- * @return Pointer to the function which will handle this command, as defined in the netfn handler list.
+ * @return Pointer to the handler record, NULL if the command isn't supported
  */
-t_req_handler ipmi_retrieve_handler( uint8_t netfn, uint8_t cmd )
+static const t_req_handler_record * ipmi_retrieve_handler_record( uint8_t netfn, uint8_t cmd )
 {
-    t_req_handler handler = 0;
+    const t_req_handler_record *record = NULL;
+    const t_req_handler_record *entries = (const t_req_handler_record *) ipmiEntries;
+    uint8_t pos = ipmi_handler_hash( netfn, cmd );
+
+    for ( uint32_t probes = 0; probes < IPMI_HANDLER_INDEX_SIZE; probes++ ) {
+        uint8_t idx = ipmi_handler_index[pos];
+
+        if ( idx == 0 ) {
+            break;
+        }
+        if ( ( entries[idx-1].netfn == netfn ) && ( entries[idx-1].cmd == cmd ) ) {
+            return &entries[idx-1];
+        }
+        pos = ( pos + 1 ) & ( IPMI_HANDLER_INDEX_SIZE - 1 );
+    }
+
+    if ( !ipmi_handler_index_overflow ) {
+        return record;
+    }
+
+    /* Some handlers are missing from the index, search the whole list */
     t_req_handler_record * p_ptr = (t_req_handler_record *) ipmiEntries;
 
     while (p_ptr < ipmiEntries_end) {
         if( (p_ptr->netfn == netfn) &&   \
             (p_ptr->cmd == cmd)) {
-            handler = p_ptr->req_handler;
+            record = p_ptr;
             break;
         }
         p_ptr++;
     }
 
-    return handler;
+    return record;
+}
+
+/**
+ * @brief Finds a handler associated with a given netfunction and command.
+ *
+ * @param[in] netfn 8-bit network function code
+ * @param[in] cmd 8-bit command code
+ *
+ * @return Pointer to the function which will handle this command, as defined in the netfn handler list.
+ */
+t_req_handler ipmi_retrieve_handler( uint8_t netfn, uint8_t cmd )
+{
+    const t_req_handler_record *record = ipmi_retrieve_handler_record( netfn, cmd );
+
+    return ( record ) ? record->req_handler : (t_req_handler) 0;
+}
+
+/**
+ * @brief Event outbox, filled by ipmi_event_send() and drained by #IPMIEventTask
+ */
+static ipmi_event_entry ipmi_event_outbox[IPMI_EVENT_OUTBOX_LEN];
+
+static ipmi_event_outbox_stats event_outbox_stats;
+
+/**
+ * @brief Order stamp given to each posted event, so events with the same priority leave in FIFO order
+ */
+static uint32_t ipmi_event_order;
+
+static ipmi_event_prio ipmi_event_priority( sensor_t * sensor, uint8_t offset )
+{
+    if ( GET_SENSOR_TYPE(sensor) == SENSOR_TYPE_HOT_SWAP ) {
+        return IPMI_EVENT_PRIO_HIGH;
+    }
+
+    if ( ( GET_EVENT_TYPE_CODE(sensor) & 0x7F ) == IPMI_EVENT_TYPE_THRESHOLD ) {
+        switch ( offset ) {
+        case IPMI_THRESHOLD_LNC_GL:
+        case IPMI_THRESHOLD_LNC_GH:
+        case IPMI_THRESHOLD_UNC_GL:
+        case IPMI_THRESHOLD_UNC_GH:
+            return IPMI_EVENT_PRIO_LOW;
+        default:
+            return IPMI_EVENT_PRIO_MEDIUM;
+        }
+    }
+
+    return IPMI_EVENT_PRIO_LOW;
 }
 
 /**
  * @brief Sends an event message via IPMB interface
  *
+ * The event is posted to the event outbox and sent later by #IPMIEventTask, so the calling task never waits for the MCH.
+ * A pending event of the opposite direction for the same sensor and offset cancels out with this one (except for hotswap events),
+ * and a pending event of the same direction is updated with the newer data.
+ * If the outbox is full, the newest pending event with a lower priority is dropped to make room, otherwise this event is dropped.
+ *
  * @param[in] sensor Pointer to sensor structure defined in sensor.h
  * @param[in] assert_deassert Flag to indicate an (de)assertion event
  * @param[in] evData Data buffer holding the event data, size indicated by \p length
  * @param[in] length Lenght of \p evData buffer
  *
- * @return ipmb_error return value from #ipmb_send_request
- *
- * @see ipmb_send_request()
+ * @return ipmb_error_success if the event was queued (or coalesced), ipmb_error_failure if it was dropped
  */
 ipmb_error ipmi_event_send( sensor_t * sensor, uint8_t assert_deassert, uint8_t *evData, uint8_t length)
 {
+    uint8_t offset = ( length >= 1 ) ? ( evData[0] & 0x0F ) : 0;
+    ipmi_event_prio prio = ipmi_event_priority( sensor, offset );
+    ipmi_event_entry *slot = NULL;
+    ipmi_event_entry *victim = NULL;
+    uint8_t depth = 0;
+    uint8_t data[IPMI_EVENT_MSG_LEN] = {
+        IPMI_EVENT_MESSAGE_REV,
+        GET_SENSOR_TYPE(sensor),
+        sensor->num,
+        assert_deassert | (GET_EVENT_TYPE_CODE(sensor) & 0x7F),
+        (length >= 1)? evData[0] : 0xFF,
+        (length >= 2)? evData[1] : 0xFF,
+        (length >= 3)? evData[2] : 0xFF
+    };
+
+#ifdef MODULE_SEL
+    /* Every event is logged, even if it never reaches the MCH */
+    sel_add_event( data );
+#endif
+
+    taskENTER_CRITICAL();
+    for ( int i = 0; i < IPMI_EVENT_OUTBOX_LEN; i++ ) {
+        ipmi_event_entry *entry = &ipmi_event_outbox[i];
+
+        if ( entry->state == IPMI_EVENT_FREE ) {
+            if ( slot == NULL ) {
+                slot = entry;
+            }
+            continue;
+        }
+
+        depth++;
+
+        if ( entry->state != IPMI_EVENT_PENDING ) {
+            continue;
+        }
+
+        if ( ( prio != IPMI_EVENT_PRIO_HIGH ) && ( entry->sensor_num == sensor->num ) && ( entry->offset == offset ) ) {
+            event_outbox_stats.coalesced++;
+
+            if ( entry->assert_deassert != assert_deassert ) {
+                /* The MCH hasn't seen the first one yet, both transitions cancel out */
+                entry->state = IPMI_EVENT_FREE;
+                event_outbox_stats.depth--;
+                taskEXIT_CRITICAL();
+                return ipmb_error_success;
+            }
+
+            /* Same transition still waiting, just refresh its data */
+            slot = entry;
+            depth--;
+            break;
+        }
+
+        if ( ( entry->prio < prio ) && ( ( victim == NULL ) || ( entry->prio < victim->prio ) ||
+                                         ( ( entry->prio == victim->prio ) && ( entry->order > victim->order ) ) ) ) {
+            victim = entry;
+        }
+    }
+
+    if ( slot == NULL ) {
+        event_outbox_stats.dropped++;
+
+        if ( victim == NULL ) {
+            taskEXIT_CRITICAL();
+            return ipmb_error_failure;
+        }
+
+        /* Make room by dropping a less important event */
+        slot = victim;
+        depth--;
+    }
+
+    slot->sensor_num = sensor->num;
+    slot->offset = offset;
+    slot->assert_deassert = assert_deassert;
+    slot->prio = prio;
+    slot->retries = 0;
+    slot->next_attempt = xTaskGetTickCount();
+    slot->order = ipmi_event_order++;
+
+    memcpy( slot->data, data, IPMI_EVENT_MSG_LEN );
+
+    slot->state = IPMI_EVENT_PENDING;
+
+    depth++;
+    event_outbox_stats.depth = depth;
+    if ( depth > event_outbox_stats.high_water ) {
+        event_outbox_stats.high_water = depth;
+    }
+    taskEXIT_CRITICAL();
+
+    if ( ipmi_event_sem ) {
+        xSemaphoreGive( ipmi_event_sem );
+    }
+
+    return ipmb_error_success;
+}
+
+/**
+ * @brief Picks the next event to be sent: highest priority first, oldest first among the same priority
+ *
+ * @param[out] wait Ticks until the earliest postponed event is due, portMAX_DELAY if there's none
+ *
+ * @return Event marked as being sent, NULL if no event is due
+ */
+static ipmi_event_entry * ipmi_event_next( TickType_t * wait )
+{
+    TickType_t now = xTaskGetTickCount();
+    ipmi_event_entry *next = NULL;
+
+    *wait = portMAX_DELAY;
+
+    taskENTER_CRITICAL();
+    for ( int i = 0; i < IPMI_EVENT_OUTBOX_LEN; i++ ) {
+        ipmi_event_entry *entry = &ipmi_event_outbox[i];
+        TickType_t due = entry->next_attempt - now;
+
+        if ( entry->state != IPMI_EVENT_PENDING ) {
+            continue;
+        }
+
+        /* Postponed after a failed attempt (due is "negative", i.e. huge, once the deadline has passed) */
+        if ( ( due != 0 ) && ( due <= IPMI_EVENT_RETRY_DELAY_MAX ) ) {
+            if ( due < *wait ) {
+                *wait = due;
+            }
+            continue;
+        }
+
+        if ( ( next == NULL ) || ( entry->prio > next->prio ) ||
+             ( ( entry->prio == next->prio ) && ( ( entry->order - next->order ) & 0x80000000UL ) ) ) {
+            next = entry;
+        }
+    }
+
+    if ( next ) {
+        next->state = IPMI_EVENT_SENDING;
+    }
+    taskEXIT_CRITICAL();
+
+    return next;
+}
+
+/**
+ * @brief Back-off before the next attempt to send an event
+ *
+ * @param retries Failed attempts so far (at least 1)
+ */
+static TickType_t ipmi_event_retry_delay( uint8_t retries )
+{
+    TickType_t delay = IPMI_EVENT_RETRY_DELAY;
+
+    while ( ( --retries > 0 ) && ( delay < IPMI_EVENT_RETRY_DELAY_MAX ) ) {
+        delay *= 2;
+    }
+
+    return ( delay > IPMI_EVENT_RETRY_DELAY_MAX ) ? IPMI_EVENT_RETRY_DELAY_MAX : delay;
+}
+
+void IPMIEventTask( void * pvParameters )
+{
+    ipmi_event_entry *entry;
+    TickType_t wait;
     ipmi_msg evt;
-    uint8_t data_len = 0;
 
-    evt.dest_LUN = 0;
-    evt.netfn = NETFN_SE;
-    evt.cmd = IPMI_PLATFORM_EVENT_CMD;
+    for ( ;; ) {
+        entry = ipmi_event_next( &wait );
+
+        if ( entry == NULL ) {
+            xSemaphoreTake( ipmi_event_sem, wait );
+            continue;
+        }
+
+        evt.dest_LUN = 0;
+        evt.netfn = NETFN_SE;
+        evt.cmd = IPMI_PLATFORM_EVENT_CMD;
+        memcpy( evt.data, entry->data, IPMI_EVENT_MSG_LEN );
+        evt.data_len = IPMI_EVENT_MSG_LEN;
 
-    evt.data[data_len++] = IPMI_EVENT_MESSAGE_REV;
-    evt.data[data_len++] = GET_SENSOR_TYPE(sensor);
-    evt.data[data_len++] = sensor->num;
-    evt.data[data_len++] = assert_deassert | (GET_EVENT_TYPE_CODE(sensor) & 0x7F);
-    evt.data[data_len++] = (length >= 1)? evData[0] : 0xFF;
-    evt.data[data_len++] = (length >= 2)? evData[1] : 0xFF;
-    evt.data[data_len++] = (length >= 3)? evData[2] : 0xFF;
+        /* Only this task waits for the IPMB layer, which retransmits the request until the MCH answers it */
+        if ( ipmb_send_request( &evt ) == ipmb_error_success ) {
+            taskENTER_CRITICAL();
+            entry->state = IPMI_EVENT_FREE;
+            event_outbox_stats.sent++;
+            event_outbox_stats.depth--;
+            taskEXIT_CRITICAL();
+            continue;
+        }
 
-    evt.data_len = data_len;
+        taskENTER_CRITICAL();
+        if ( entry->retries < UINT8_MAX ) {
+            entry->retries++;
+        }
+
+        /* Hotswap events are kept until the MCH gets them (e.g. while IPMB-L is not ready after boot) */
+        if ( ( entry->prio != IPMI_EVENT_PRIO_HIGH ) && ( entry->retries > IPMI_EVENT_MAX_RETRIES ) ) {
+            entry->state = IPMI_EVENT_FREE;
+            event_outbox_stats.dropped++;
+            event_outbox_stats.depth--;
+        } else {
+            entry->next_attempt = xTaskGetTickCount() + ipmi_event_retry_delay( entry->retries );
+            entry->state = IPMI_EVENT_PENDING;
+            event_outbox_stats.retries++;
+        }
+        taskEXIT_CRITICAL();
+    }
+}
 
-    return (ipmb_send_request( &evt ));
+void ipmi_get_event_outbox_stats( ipmi_event_outbox_stats * stats )
+{
+    taskENTER_CRITICAL();
+    *stats = event_outbox_stats;
+    taskEXIT_CRITICAL();
 }
 
 /**
@@ -339,3 +963,151 @@ IPMI_HANDLER(ipmi_custom_cmd_get_free_heap, NETFN_CUSTOM, IPMI_CUSTOM_CMD_MMC_GE
     rsp->data_len = len;
     rsp->completion_code = IPMI_CC_OK;
 }
+
+IPMI_HANDLER(ipmi_custom_cmd_get_resp_cache_stats, NETFN_CUSTOM, IPMI_CUSTOM_CMD_GET_RESP_CACHE_STATS, ipmi_msg *req, ipmi_msg *rsp)
+{
+    uint8_t len = rsp->data_len = 0;
+    ipmi_resp_cache_stats stats;
+
+    ipmi_get_resp_cache_stats( &stats );
+
+    rsp->data[len++] = stats.hits & 0xFF;
+    rsp->data[len++] = (stats.hits >> 8) & 0xFF;
+    rsp->data[len++] = (stats.hits >> 16) & 0xFF;
+    rsp->data[len++] = (stats.hits >> 24) & 0xFF;
+    rsp->data[len++] = stats.misses & 0xFF;
+    rsp->data[len++] = (stats.misses >> 8) & 0xFF;
+    rsp->data[len++] = (stats.misses >> 16) & 0xFF;
+    rsp->data[len++] = (stats.misses >> 24) & 0xFF;
+
+    rsp->data_len = len;
+    rsp->completion_code = IPMI_CC_OK;
+}
+
+IPMI_HANDLER(ipmi_custom_cmd_get_event_outbox_stats, NETFN_CUSTOM, IPMI_CUSTOM_CMD_GET_EVENT_OUTBOX_STATS, ipmi_msg *req, ipmi_msg *rsp)
+{
+    uint8_t len = rsp->data_len = 0;
+    ipmi_event_outbox_stats stats;
+
+    ipmi_get_event_outbox_stats( &stats );
+
+    rsp->data[len++] = IPMI_EVENT_OUTBOX_LEN;
+    rsp->data[len++] = stats.depth;
+    rsp->data[len++] = stats.high_water;
+    rsp->data[len++] = stats.sent & 0xFF;
+    rsp->data[len++] = (stats.sent >> 8) & 0xFF;
+    rsp->data[len++] = (stats.sent >> 16) & 0xFF;
+    rsp->data[len++] = (stats.sent >> 24) & 0xFF;
+    rsp->data[len++] = stats.dropped & 0xFF;
+    rsp->data[len++] = (stats.dropped >> 8) & 0xFF;
+    rsp->data[len++] = (stats.dropped >> 16) & 0xFF;
+    rsp->data[len++] = (stats.dropped >> 24) & 0xFF;
+    rsp->data[len++] = stats.coalesced & 0xFF;
+    rsp->data[len++] = (stats.coalesced >> 8) & 0xFF;
+    rsp->data[len++] = (stats.coalesced >> 16) & 0xFF;
+    rsp->data[len++] = (stats.coalesced >> 24) & 0xFF;
+    rsp->data[len++] = stats.retries & 0xFF;
+    rsp->data[len++] = (stats.retries >> 8) & 0xFF;
+    rsp->data[len++] = (stats.retries >> 16) & 0xFF;
+    rsp->data[len++] = (stats.retries >> 24) & 0xFF;
+
+    rsp->data_len = len;
+    rsp->completion_code = IPMI_CC_OK;
+}
+
+/**
+ * @brief Handler for the custom Get IPMB Statistics command
+ *
+ * Request data byte 1 selects what is returned:
+ * - #IPMB_STATS_SEL_LINK: checksum errors, NAKs, arbitration losses, retries, TX failures and client queue overflows (32-bit each)
+ * - #IPMB_STATS_SEL_TURNAROUND / #IPMB_STATS_SEL_HANDLER: histogram buckets (16-bit each, saturated)
+ * - #IPMB_STATS_SEL_NETFN: requests received and responses sent for the netfn given in byte 2 (32-bit each),
+ *   followed by the totals of requests sent and responses received
+ * - #IPMB_STATS_SEL_RESET: clears all the statistics
+ */
+IPMI_HANDLER(ipmi_custom_cmd_get_ipmb_stats, NETFN_CUSTOM, IPMI_CUSTOM_CMD_GET_IPMB_STATS, ipmi_msg *req, ipmi_msg *rsp)
+{
+    uint8_t len = rsp->data_len = 0;
+    const ipmb_stats *stats = ipmb_get_stats();
+    const uint32_t *values[6];
+    uint8_t count = 0;
+    const uint32_t *hist = NULL;
+
+    if (req->data_len < 1) {
+        rsp->completion_code = IPMI_CC_REQ_DATA_INV_LENGTH;
+        return;
+    }
+
+    switch (req->data[0]) {
+    case IPMB_STATS_SEL_LINK:
+        values[count++] = &stats->chksum_errors;
+        values[count++] = &stats->naks;
+        values[count++] = &stats->arblost;
+        values[count++] = &stats->retries;
+        values[count++] = &stats->tx_failures;
+        values[count++] = &stats->client_queue_overflows;
+        break;
+    case IPMB_STATS_SEL_TURNAROUND:
+        hist = stats->turnaround_hist;
+        break;
+    case IPMB_STATS_SEL_HANDLER:
+        hist = stats->handler_hist;
+        break;
+    case IPMB_STATS_SEL_NETFN:
+        if (req->data_len < 2) {
+            rsp->completion_code = IPMI_CC_REQ_DATA_INV_LENGTH;
+            return;
+        }
+        values[count++] = &stats->requests_rx[(req->data[1] >> 1) % IPMB_STATS_NETFN_COUNT];
+        values[count++] = &stats->responses_tx[(req->data[1] >> 1) % IPMB_STATS_NETFN_COUNT];
+        values[count++] = &stats->requests_tx;
+        values[count++] = &stats->responses_rx;
+        break;
+    case IPMB_STATS_SEL_RESET:
+        ipmb_reset_stats();
+        break;
+    default:
+        rsp->completion_code = IPMI_CC_INV_DATA_FIELD_IN_REQ;
+        return;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t value = *values[i];
+
+        rsp->data[len++] = value & 0xFF;
+        rsp->data[len++] = (value >> 8) & 0xFF;
+        rsp->data[len++] = (value >> 16) & 0xFF;
+        rsp->data[len++] = (value >> 24) & 0xFF;
+    }
+
+    if (hist) {
+        for (uint8_t i = 0; i < IPMB_STATS_HIST_BUCKETS; i++) {
+            uint16_t value = (hist[i] > UINT16_MAX) ? UINT16_MAX : hist[i];
+
+            rsp->data[len++] = value & 0xFF;
+            rsp->data[len++] = (value >> 8) & 0xFF;
+        }
+    }
+
+    rsp->data_len = len;
+    rsp->completion_code = IPMI_CC_OK;
+}
+
+IPMI_HANDLER(ipmi_custom_cmd_get_ipmb_pool_stats, NETFN_CUSTOM, IPMI_CUSTOM_CMD_GET_IPMB_POOL_STATS, ipmi_msg *req, ipmi_msg *rsp)
+{
+    uint8_t len = rsp->data_len = 0;
+    ipmb_pool_stats stats;
+
+    ipmb_get_pool_stats( &stats );
+
+    rsp->data[len++] = stats.size;
+    rsp->data[len++] = stats.in_use;
+    rsp->data[len++] = stats.high_water;
+    rsp->data[len++] = stats.alloc_failures & 0xFF;
+    rsp->data[len++] = (stats.alloc_failures >> 8) & 0xFF;
+    rsp->data[len++] = (stats.alloc_failures >> 16) & 0xFF;
+    rsp->data[len++] = (stats.alloc_failures >> 24) & 0xFF;
+
+    rsp->data_len = len;
+    rsp->completion_code = IPMI_CC_OK;
+}
@@ -472,6 +472,19 @@
 #define IPMI_CUSTOM_CMD_GET_GIT_HASH                            0x02
 #define IPMI_CUSTOM_CMD_WRITE_CLOCK_CONFIG                      0x03
 #define IPMI_CUSTOM_CMD_READ_CLOCK_CONFIG                       0x04
+#define IPMI_CUSTOM_CMD_GET_IPMB_POOL_STATS                     0x05
+#define IPMI_CUSTOM_CMD_GET_RESP_CACHE_STATS                    0x06
+#define IPMI_CUSTOM_CMD_GET_EVENT_OUTBOX_STATS                  0x07
+#define IPMI_CUSTOM_CMD_GET_IPMB_STATS                          0x08
+
+/**
+ * @brief Selectors of the IPMI_CUSTOM_CMD_GET_IPMB_STATS command
+ */
+#define IPMB_STATS_SEL_LINK                                     0x00
+#define IPMB_STATS_SEL_TURNAROUND                               0x01
+#define IPMB_STATS_SEL_HANDLER                                  0x02
+#define IPMB_STATS_SEL_NETFN                                    0x03
+#define IPMB_STATS_SEL_RESET                                    0xFF
 /**
  * @}
  */
@@ -532,12 +545,145 @@
  */
 typedef void (* t_req_handler)(ipmi_msg * req, ipmi_msg * resp);
 
+/**
+ * @brief Size (as a power of 2) of the hash index used to look up IPMI handlers
+ *
+ * Must be large enough to keep the index sparse: 7 bits (128 entries) hold up to ~60 handlers with short probe sequences.
+ */
+#define IPMI_HANDLER_INDEX_BITS 7
+#define IPMI_HANDLER_INDEX_SIZE (1 << IPMI_HANDLER_INDEX_BITS)
+
+/**
+ * @brief Handler flag: the handler is slow and must run on the deferred worker task
+ */
+#define IPMI_HANDLER_FLAG_DEFERRED      (1 << 0)
+
+/**
+ * @brief Number of deferred requests that can be queued or running on the worker task at the same time
+ */
+#define IPMI_DEFERRED_QUEUE_LEN         4
+
+/**
+ * @brief Number of recent responses kept to answer retransmitted requests
+ */
+#define IPMI_RESP_CACHE_LEN             8
+
+/**
+ * @brief Time during which a cached response is given back to a request with the same source, sequence, netfn, command and data
+ *
+ * Must be longer than the requester's retry period but shorter than the time it takes to reuse a sequence number.
+ */
+#define IPMI_RESP_CACHE_WINDOW          (2000/portTICK_PERIOD_MS)
+
+/**
+ * @brief Response cache entry
+ */
+typedef struct ipmi_resp_cache_entry {
+    bool valid;                         /**< Entry holds a response */
+    uint8_t src_addr;                   /**< Requester address */
+    uint8_t seq;                        /**< Request sequence number */
+    uint8_t netfn;                      /**< Request net function */
+    uint8_t cmd;                        /**< Request command */
+    uint8_t req_len;                    /**< Request data length */
+    uint16_t req_crc;                   /**< CRC-16 of the request data, tells apart requests reusing a sequence number */
+    uint8_t completion_code;            /**< Response completion code */
+    uint8_t data_len;                   /**< Amount of valid bytes in #data */
+    uint8_t data[IPMI_MSG_MAX_LENGTH];  /**< Response data */
+    TickType_t timestamp;               /**< Tick count when the response was sent */
+} ipmi_resp_cache_entry;
+
+/**
+ * @brief Number of events that can wait in the event outbox
+ */
+#define IPMI_EVENT_OUTBOX_LEN           16
+
+/**
+ * @brief Platform Event Message request data length
+ */
+#define IPMI_EVENT_MSG_LEN              7
+
+/**
+ * @brief Extra attempts made to send an event the IPMB layer couldn't deliver, before dropping it
+ *
+ * Hotswap (#IPMI_EVENT_PRIO_HIGH) events are never dropped: the module can't leave M1 without them.
+ */
+#define IPMI_EVENT_MAX_RETRIES          IPMB_MAX_RETRIES
+
+/**
+ * @brief Delay between attempts to send an event, doubled after each failed attempt
+ */
+#define IPMI_EVENT_RETRY_DELAY          IPMB_MSG_TIMEOUT
+
+/**
+ * @brief Longest delay between attempts to send an event
+ */
+#define IPMI_EVENT_RETRY_DELAY_MAX      (4000/portTICK_PERIOD_MS)
+
+/**
+ * @brief Event/Reading type code of threshold based sensors
+ */
+#define IPMI_EVENT_TYPE_THRESHOLD       0x01
+
+/**
+ * @brief Event priorities, higher values are sent first
+ */
+typedef enum ipmi_event_prio {
+    IPMI_EVENT_PRIO_LOW = 0,            /**< Non-critical thresholds and other events */
+    IPMI_EVENT_PRIO_MEDIUM,             /**< Critical and non-recoverable thresholds */
+    IPMI_EVENT_PRIO_HIGH                /**< Hotswap events */
+} ipmi_event_prio;
+
+/**
+ * @brief Event outbox entry states
+ */
+typedef enum ipmi_event_state {
+    IPMI_EVENT_FREE = 0,                /**< Entry is unused */
+    IPMI_EVENT_PENDING,                 /**< Event waiting to be sent */
+    IPMI_EVENT_SENDING                  /**< Event being sent, can't be coalesced anymore */
+} ipmi_event_state;
+
+/**
+ * @brief Event outbox entry
+ */
+typedef struct ipmi_event_entry {
+    ipmi_event_state state;             /**< Entry state */
+    ipmi_event_prio prio;               /**< Event priority */
+    uint8_t sensor_num;                 /**< Sensor number */
+    uint8_t offset;                     /**< Event offset (Event Data 1 [3:0]) */
+    uint8_t assert_deassert;            /**< ASSERTION_EVENT or DEASSERTION_EVENT */
+    uint8_t retries;                    /**< Failed attempts */
+    uint32_t order;                     /**< Posting order stamp */
+    TickType_t next_attempt;            /**< Tick count before which the event must not be sent */
+    uint8_t data[IPMI_EVENT_MSG_LEN];   /**< Platform Event Message request data */
+} ipmi_event_entry;
+
+/**
+ * @brief Event outbox statistics
+ */
+typedef struct ipmi_event_outbox_stats {
+    uint8_t depth;                      /**< Events currently in the outbox */
+    uint8_t high_water;                 /**< Highest amount of events in the outbox */
+    uint32_t sent;                      /**< Events delivered to the MCH */
+    uint32_t dropped;                   /**< Events dropped (outbox full or too many failed attempts) */
+    uint32_t coalesced;                 /**< Events merged with or cancelled by a later one */
+    uint32_t retries;                   /**< Failed attempts that were retried */
+} ipmi_event_outbox_stats;
+
+/**
+ * @brief Response cache statistics
+ */
+typedef struct ipmi_resp_cache_stats {
+    uint32_t hits;                      /**< Retransmissions answered from the cache */
+    uint32_t misses;                    /**< Requests that had to be handled */
+} ipmi_resp_cache_stats;
+
 /**
  * @brief IPMI Handler record structure used to index all handlers
  */
 typedef struct{
     uint8_t netfn;                 /**< Net Function */
     uint8_t cmd;                   /**< Command */
+    uint8_t flags;                 /**< Handler flags (IPMI_HANDLER_FLAG_*) */
     t_req_handler req_handler;     /**< IPMI handler function */
 } t_req_handler_record;
 
@@ -572,6 +718,19 @@ extern const t_req_handler_record *_eipmi_handlers;
     const t_req_handler_record __attribute__ ((section (".ipmi_handlers"))) ipmi_handler_##netfn_id##__##cmd_id##_s = { .req_handler = ipmi_handler_##netfn_id##__##cmd_id##_f , .netfn = netfn_id, .cmd = cmd_id }; \
     void ipmi_handler_##netfn_id##__##cmd_id##_f(args)
 
+/**
+ * @brief Declares a slow IPMI handler (e.g. EEPROM or flash writes, I2C accesses)
+ *
+ * Works like #IPMI_HANDLER, but the dispatcher hands the request over to #IPMIDeferredTask instead of calling the handler itself,
+ * so fast commands keep being answered while this one runs. The response is sent with the original sequence number once the handler returns.
+ * Retransmissions received meanwhile are answered with #IPMI_CC_COMMAND_IN_PROGRESS and new requests are refused with #IPMI_CC_NODE_BUSY
+ * if the worker queue is full.
+ */
+#define IPMI_HANDLER_DEFERRED(name, netfn_id, cmd_id, args...)          \
+    void ipmi_handler_##netfn_id##__##cmd_id##_f(args);                 \
+    const t_req_handler_record __attribute__ ((section (".ipmi_handlers"))) ipmi_handler_##netfn_id##__##cmd_id##_s = { .req_handler = ipmi_handler_##netfn_id##__##cmd_id##_f , .netfn = netfn_id, .cmd = cmd_id, .flags = IPMI_HANDLER_FLAG_DEFERRED }; \
+    void ipmi_handler_##netfn_id##__##cmd_id##_f(args)
+
 /* Function Prototypes */
 
 /**
@@ -584,10 +743,28 @@ extern const t_req_handler_record *_eipmi_handlers;
  */
 void IPMITask ( void *pvParameters );
 
+/**
+ * @brief IPMI deferred handlers worker task
+ *
+ * Runs the handlers declared with #IPMI_HANDLER_DEFERRED, one request at a time, and sends their responses.
+ *
+ * @param pvParameters Pointer to parameters buffer passed to this task in initialization
+ */
+void IPMIDeferredTask ( void *pvParameters );
+
+/**
+ * @brief IPMI event sender task
+ *
+ * Sends the events posted by ipmi_event_send() to the MCH, most important first, retrying the ones that fail.
+ *
+ * @param pvParameters Pointer to parameters buffer passed to this task in initialization
+ */
+void IPMIEventTask ( void *pvParameters );
+
 /**
  * @brief Initializes the IPMI Dispatcher
  *
- * This function initializes the IPMB Layer, registers the RX queue for incoming requests and creates the IPMI task
+ * This function builds the handlers lookup index, initializes the IPMB Layer, registers the RX queue for incoming requests and creates the IPMI dispatcher and deferred worker tasks
  */
 void ipmi_init ( void );
 
@@ -601,15 +778,32 @@ void ipmi_init ( void );
  */
 t_req_handler ipmi_retrieve_handler(uint8_t netfn, uint8_t cmd);
 
+/**
+ * @brief Reads the response cache hit/miss counters
+ *
+ * @param[out] stats Pointer to the struct that receives the counters
+ */
+void ipmi_get_resp_cache_stats( ipmi_resp_cache_stats * stats );
+
+/**
+ * @brief Reads the event outbox depth and counters
+ *
+ * @param[out] stats Pointer to the struct that receives the counters
+ */
+void ipmi_get_event_outbox_stats( ipmi_event_outbox_stats * stats );
+
 /**
  * @brief Sends an event message (Platform Event) via IPMI
  *
+ * Doesn't block: the event is queued in the event outbox and sent by #IPMIEventTask.
+ *
  * @param sensor          Pointer to sensor information struct
  * @param assert_deassert Evetn transition direction (0) for assertion, (1) for Deassertion
  * @param evData          Pointer to event message buffer
  * @param length          Event message buffer len (max len = 3)
  *
- * @return ipmb_error
+ * @return ipmb_error_success if the event was queued, ipmb_error_failure if the outbox was full.
+ * A queued hotswap event is retried until the MCH gets it, other events may still be dropped after #IPMI_EVENT_MAX_RETRIES.
  *
  * @see sdr.h
  * @see ipmb.h
@@ -0,0 +1,429 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file   kv_store.c
+ *
+ * @brief  Persistent key-value store in a 24xx64 EEPROM implementation
+ */
+
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "string.h"
+
+/* Project Includes */
+#include "port.h"
+#include "kv_store.h"
+#include "eeprom_24xx64.h"
+#include "i2c_mapping.h"
+#include "utils.h"
+#include "uart_debug.h"
+
+/* The board may place the store in another chip, or in part of it */
+#ifndef KV_EEPROM_ID
+#define KV_EEPROM_ID        CHIP_ID_EEPROM_64K
+#endif
+
+#ifndef KV_BASE_ADDR
+#define KV_BASE_ADDR        0x0000
+#endif
+
+/* Both sectors fit in the lower half of the chip, the upper half holds the SEL */
+#ifndef KV_SECTOR_SIZE
+#define KV_SECTOR_SIZE      0x0800
+#endif
+
+#define KV_BUS_TIMEOUT      pdMS_TO_TICKS(50)
+
+/* Sector header: magic (2 bytes), generation (4 bytes), CRC-16 (2 bytes), little endian */
+#define KV_HEADER_SIZE      8
+#define KV_MAGIC            0x4B56
+
+#define KV_RECORD_HEADER    4
+
+/* Records are scanned through a window, so that loading the log takes a few long reads */
+#define KV_SCAN_WINDOW      64
+
+typedef struct kv_entry {
+    uint8_t key;
+    uint8_t len;
+    uint8_t value[KV_VALUE_MAX];
+} kv_entry_t;
+
+static kv_entry_t kv_table[KV_MAX_KEYS];
+static SemaphoreHandle_t kv_mutex;
+static bool kv_loaded;              /* The log was read, so appending to it is safe */
+static uint8_t kv_sector;           /* Active sector */
+static uint32_t kv_generation;      /* Generation of the active sector, 0 if the store doesn't exist yet */
+static uint16_t kv_tail;            /* End of the log, in the active sector */
+
+static uint8_t kv_window[KV_SCAN_WINDOW];
+static uint16_t kv_window_start;
+static uint16_t kv_window_len;
+
+static uint16_t kv_sector_addr( uint8_t sector )
+{
+    return KV_BASE_ADDR + ( sector * KV_SECTOR_SIZE );
+}
+
+static kv_entry_t * kv_find( uint8_t key )
+{
+    for ( uint8_t i = 0; i < KV_MAX_KEYS; i++ ) {
+        if ( kv_table[i].key == key ) {
+            return &kv_table[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Update the RAM copy of a key (a zero length deletes it)
+ */
+static bool kv_apply( uint8_t key, const uint8_t *value, uint8_t len )
+{
+    kv_entry_t *entry = kv_find( key );
+
+    if ( entry == NULL ) {
+        if ( len == 0 ) {
+            return true;
+        }
+        entry = kv_find( KV_KEY_INVALID );
+        if ( entry == NULL ) {
+            return false;
+        }
+    }
+
+    entry->key = ( len > 0 ) ? key : KV_KEY_INVALID;
+    entry->len = len;
+    if ( len > 0 ) {
+        memcpy( entry->value, value, len );
+    }
+    return true;
+}
+
+/*
+ * The sector generation is part of the CRC, so the records left by an older log in the same
+ * sector are never taken for new ones (e.g. when a record header is torn right after its first bytes)
+ */
+static uint16_t kv_record_crc( uint32_t generation, uint8_t key, uint8_t len, const uint8_t *value )
+{
+    uint8_t hdr[6] = { generation & 0xFF, ( generation >> 8 ) & 0xFF, ( generation >> 16 ) & 0xFF, ( generation >> 24 ) & 0xFF, key, len };
+
+    return calculate_crc16( value, len, calculate_crc16( hdr, sizeof(hdr), 0xFFFF ) );
+}
+
+/**
+ * @brief Read a sector header
+ *
+ * @return MMC_OK if the header is valid, MMC_RESOURCE_ERR if the sector isn't formatted, MMC_IO_ERR if it couldn't be read
+ */
+static mmc_err kv_read_header( uint8_t sector, uint32_t *generation )
+{
+    uint8_t hdr[KV_HEADER_SIZE];
+
+    if ( eeprom_24xx64_read( KV_EEPROM_ID, kv_sector_addr( sector ), hdr, sizeof(hdr), KV_BUS_TIMEOUT ) != sizeof(hdr) ) {
+        return MMC_IO_ERR;
+    }
+
+    if ( ( ( hdr[0] | ( hdr[1] << 8 ) ) != KV_MAGIC ) ||
+         ( calculate_crc16( hdr, 6, 0xFFFF ) != ( hdr[6] | ( hdr[7] << 8 ) ) ) ) {
+        return MMC_RESOURCE_ERR;
+    }
+
+    *generation = hdr[2] | ( hdr[3] << 8 ) | ( hdr[4] << 16 ) | ( (uint32_t) hdr[5] << 24 );
+    return MMC_OK;
+}
+
+static bool kv_write_header( uint8_t sector, uint32_t generation )
+{
+    uint8_t hdr[KV_HEADER_SIZE];
+    uint16_t crc;
+
+    hdr[0] = KV_MAGIC & 0xFF;
+    hdr[1] = KV_MAGIC >> 8;
+    hdr[2] = generation & 0xFF;
+    hdr[3] = ( generation >> 8 ) & 0xFF;
+    hdr[4] = ( generation >> 16 ) & 0xFF;
+    hdr[5] = ( generation >> 24 ) & 0xFF;
+    crc = calculate_crc16( hdr, 6, 0xFFFF );
+    hdr[6] = crc & 0xFF;
+    hdr[7] = crc >> 8;
+
+    return ( eeprom_24xx64_write( KV_EEPROM_ID, kv_sector_addr( sector ), hdr, sizeof(hdr), KV_BUS_TIMEOUT ) == sizeof(hdr) );
+}
+
+/**
+ * @brief Write a record, followed by an end of log marker so that the bytes of an older, longer log are never parsed
+ */
+static bool kv_write_record( uint8_t sector, uint32_t generation, uint16_t offset, uint8_t key, const uint8_t *value, uint8_t len )
+{
+    uint8_t rec[KV_RECORD_HEADER + KV_VALUE_MAX + 1];
+    uint16_t crc = kv_record_crc( generation, key, len, value );
+    size_t rec_len = KV_RECORD_HEADER + len;
+
+    rec[0] = key;
+    rec[1] = len;
+    rec[2] = crc & 0xFF;
+    rec[3] = crc >> 8;
+    if ( len > 0 ) {
+        memcpy( &rec[KV_RECORD_HEADER], value, len );
+    }
+
+    if ( offset + rec_len < KV_SECTOR_SIZE ) {
+        rec[rec_len++] = KV_KEY_ERASED;
+    }
+
+    return ( eeprom_24xx64_write( KV_EEPROM_ID, kv_sector_addr( sector ) + offset, rec, rec_len, KV_BUS_TIMEOUT ) == rec_len );
+}
+
+static bool kv_write_end( uint8_t sector, uint16_t offset )
+{
+    uint8_t end = KV_KEY_ERASED;
+
+    return ( eeprom_24xx64_write( KV_EEPROM_ID, kv_sector_addr( sector ) + offset, &end, 1, KV_BUS_TIMEOUT ) == 1 );
+}
+
+static bool kv_scan_read( uint16_t address, uint8_t *data, uint8_t len )
+{
+    if ( ( address < kv_window_start ) || ( address + len > kv_window_start + kv_window_len ) ) {
+        kv_window_start = address;
+        kv_window_len = eeprom_24xx64_read( KV_EEPROM_ID, address, kv_window, KV_SCAN_WINDOW, KV_BUS_TIMEOUT );
+
+        if ( kv_window_len < len ) {
+            kv_window_len = 0;
+            return false;
+        }
+    }
+
+    memcpy( data, &kv_window[address - kv_window_start], len );
+    return true;
+}
+
+/**
+ * @brief Replay the log of a sector into the RAM table
+ *
+ * @return false if the sector couldn't be read (its log end is unknown)
+ */
+static bool kv_load( uint8_t sector )
+{
+    uint8_t rec[KV_RECORD_HEADER + KV_VALUE_MAX];
+    uint16_t base = kv_sector_addr( sector );
+    uint16_t offset = KV_HEADER_SIZE;
+    uint8_t key, len;
+
+    kv_window_len = 0;
+
+    while ( offset + KV_RECORD_HEADER <= KV_SECTOR_SIZE ) {
+        if ( !kv_scan_read( base + offset, rec, KV_RECORD_HEADER ) ) {
+            return false;
+        }
+
+        key = rec[0];
+        len = rec[1];
+
+        if ( ( key == KV_KEY_ERASED ) || ( key == KV_KEY_INVALID ) || ( len > KV_VALUE_MAX ) ||
+             ( offset + KV_RECORD_HEADER + len > KV_SECTOR_SIZE ) ) {
+            break;
+        }
+
+        if ( !kv_scan_read( base + offset + KV_RECORD_HEADER, &rec[KV_RECORD_HEADER], len ) ) {
+            return false;
+        }
+
+        /* A record torn by a power loss ends the log, the next record will overwrite it */
+        if ( kv_record_crc( kv_generation, key, len, &rec[KV_RECORD_HEADER] ) != ( rec[2] | ( rec[3] << 8 ) ) ) {
+            printf( "[KV] Discarding a torn record at 0x%04X\n", base + offset );
+            break;
+        }
+
+        if ( !kv_apply( key, &rec[KV_RECORD_HEADER], len ) ) {
+            printf( "[KV] Too many keys, key 0x%02X is dropped\n", key );
+        }
+
+        offset += KV_RECORD_HEADER + len;
+    }
+
+    kv_tail = offset;
+    return true;
+}
+
+/**
+ * @brief Copy the current values to the inactive sector and make it the active one
+ */
+static mmc_err kv_compact( void )
+{
+    uint8_t target = kv_sector ^ 1;
+    uint16_t offset = KV_HEADER_SIZE;
+
+    if ( !kv_write_end( target, offset ) ) {
+        return MMC_IO_ERR;
+    }
+
+    for ( uint8_t i = 0; i < KV_MAX_KEYS; i++ ) {
+        if ( kv_table[i].key == KV_KEY_INVALID ) {
+            continue;
+        }
+        if ( !kv_write_record( target, kv_generation + 1, offset, kv_table[i].key, kv_table[i].value, kv_table[i].len ) ) {
+            return MMC_IO_ERR;
+        }
+        offset += KV_RECORD_HEADER + kv_table[i].len;
+    }
+
+    /* The new sector only takes over once its records are stored and its header is written */
+    if ( !eeprom_24xx64_sync( KV_EEPROM_ID, KV_BUS_TIMEOUT ) ||
+         !kv_write_header( target, kv_generation + 1 ) ||
+         !eeprom_24xx64_sync( KV_EEPROM_ID, KV_BUS_TIMEOUT ) ) {
+        return MMC_IO_ERR;
+    }
+
+    kv_sector = target;
+    kv_generation++;
+    kv_tail = offset;
+
+    return MMC_OK;
+}
+
+void kv_init( void )
+{
+    uint32_t generation[2] = { 0, 0 };
+    mmc_err err[2];
+
+    kv_mutex = xSemaphoreCreateMutex();
+
+    for ( uint8_t sector = 0; sector < 2; sector++ ) {
+        err[sector] = kv_read_header( sector, &generation[sector] );
+    }
+
+    if ( ( err[0] == MMC_IO_ERR ) || ( err[1] == MMC_IO_ERR ) ) {
+        /* Writing without knowing the log end could overwrite valid records */
+        printf( "[KV] Could not read the EEPROM, the store is disabled\n" );
+        return;
+    }
+
+    if ( ( err[0] != MMC_OK ) && ( err[1] != MMC_OK ) ) {
+        /* Created on the first write */
+        kv_loaded = true;
+        return;
+    }
+
+    /* The sector with the newest generation is the active one */
+    kv_sector = ( ( err[1] == MMC_OK ) && ( ( err[0] != MMC_OK ) || ( (int32_t)( generation[1] - generation[0] ) > 0 ) ) ) ? 1 : 0;
+    kv_generation = generation[kv_sector];
+    kv_loaded = kv_load( kv_sector );
+
+    if ( !kv_loaded ) {
+        printf( "[KV] Could not read the EEPROM, the store is disabled\n" );
+        memset( kv_table, 0, sizeof(kv_table) );
+    }
+}
+
+mmc_err kv_get( uint8_t key, uint8_t *value, size_t max_len, size_t *len )
+{
+    kv_entry_t *entry;
+    mmc_err err = MMC_OK;
+
+    if ( ( key == KV_KEY_INVALID ) || ( key == KV_KEY_ERASED ) || ( value == NULL ) ) {
+        return MMC_INVALID_ARG_ERR;
+    }
+
+    if ( kv_mutex == NULL ) {
+        return MMC_RESOURCE_ERR;
+    }
+
+    xSemaphoreTake( kv_mutex, portMAX_DELAY );
+
+    entry = kv_find( key );
+
+    if ( entry == NULL ) {
+        err = MMC_RESOURCE_ERR;
+    } else if ( entry->len > max_len ) {
+        err = MMC_INVALID_ARG_ERR;
+    } else {
+        memcpy( value, entry->value, entry->len );
+        if ( len ) {
+            *len = entry->len;
+        }
+    }
+
+    xSemaphoreGive( kv_mutex );
+
+    return err;
+}
+
+mmc_err kv_set( uint8_t key, const uint8_t *value, size_t len )
+{
+    kv_entry_t *entry;
+    mmc_err err = MMC_OK;
+
+    if ( ( key == KV_KEY_INVALID ) || ( key == KV_KEY_ERASED ) || ( len > KV_VALUE_MAX ) || ( ( value == NULL ) && ( len > 0 ) ) ) {
+        return MMC_INVALID_ARG_ERR;
+    }
+
+    if ( kv_mutex == NULL ) {
+        return MMC_RESOURCE_ERR;
+    }
+
+    xSemaphoreTake( kv_mutex, portMAX_DELAY );
+
+    entry = kv_find( key );
+
+    if ( !kv_loaded ) {
+        err = MMC_RESOURCE_ERR;
+    } else if ( ( entry != NULL ) ? ( ( entry->len == len ) && ( memcmp( entry->value, value, len ) == 0 ) ) : ( len == 0 ) ) {
+        /* Unchanged value, nothing to write */
+        xSemaphoreGive( kv_mutex );
+        return MMC_OK;
+    } else if ( ( entry == NULL ) && ( kv_find( KV_KEY_INVALID ) == NULL ) ) {
+        err = MMC_OOM_ERR;
+    }
+
+    /* First write, create the store in the first sector */
+    if ( ( err == MMC_OK ) && ( kv_generation == 0 ) ) {
+        kv_sector = 0;
+        kv_tail = KV_HEADER_SIZE;
+        if ( !kv_write_end( kv_sector, kv_tail ) || !kv_write_header( kv_sector, 1 ) ) {
+            err = MMC_IO_ERR;
+        } else {
+            kv_generation = 1;
+        }
+    }
+
+    if ( ( err == MMC_OK ) && ( kv_tail + KV_RECORD_HEADER + len > KV_SECTOR_SIZE ) ) {
+        err = kv_compact();
+    }
+
+    if ( err == MMC_OK ) {
+        if ( kv_write_record( kv_sector, kv_generation, kv_tail, key, value, len ) ) {
+            kv_tail += KV_RECORD_HEADER + len;
+            kv_apply( key, value, len );
+        } else {
+            err = MMC_IO_ERR;
+        }
+    }
+
+    xSemaphoreGive( kv_mutex );
+
+    return err;
+}
+
+mmc_err kv_sync( void )
+{
+    return eeprom_24xx64_sync( KV_EEPROM_ID, KV_BUS_TIMEOUT ) ? MMC_OK : MMC_IO_ERR;
+}
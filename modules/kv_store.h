@@ -0,0 +1,105 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file   kv_store.h
+ *
+ * @brief  Persistent key-value store in a 24xx64 EEPROM
+ *
+ * Values are appended as records to a log that fills one of two EEPROM sectors, so repeated updates of a key
+ * are spread over the whole sector instead of always wearing the same cells. When the active sector is full,
+ * the latest value of every key is copied to the other sector, which then becomes active (compaction).
+ *
+ * Every value is also kept in RAM, so kv_get() never accesses the bus, and kv_set() does not write anything
+ * when the value is unchanged.
+ *
+ * Record layout: key (1 byte), value length (1 byte), CRC-16 of the sector generation, key, length and value (2 bytes),
+ * value.
+ * A record with a wrong CRC (e.g. torn by a power loss) ends the log and is overwritten by the next record.
+ */
+
+#ifndef KV_STORE_H_
+#define KV_STORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mmc_error.h"
+
+/**
+ * @brief Keys of the values in the store
+ *
+ * Values are identified by their key only, so keys must never be renumbered.
+ */
+enum {
+    KV_KEY_INVALID = 0x00,
+    KV_KEY_CLOCK_CONFIG = 0x01,     /**< Clock switch configuration */
+    KV_KEY_ERASED = 0xFF,           /**< Unprogrammed EEPROM, marks the end of the log */
+};
+
+/**
+ * @brief Maximum amount of different keys
+ */
+#define KV_MAX_KEYS         16
+
+/**
+ * @brief Maximum value length (in bytes)
+ */
+#define KV_VALUE_MAX        16
+
+/**
+ * @brief Read the store from the EEPROM
+ *
+ * Only reads the EEPROM, so it can be called before the scheduler is started.
+ */
+void kv_init( void );
+
+/**
+ * @brief Get the value of a key
+ *
+ * @param[in]  key      Key
+ * @param[out] value    Buffer to store the value
+ * @param[in]  max_len  Size of the buffer
+ * @param[out] len      Length of the value (may be NULL)
+ *
+ * @return MMC_OK if success, MMC_RESOURCE_ERR if the key has no value, MMC_INVALID_ARG_ERR if the value doesn't fit
+ */
+mmc_err kv_get( uint8_t key, uint8_t *value, size_t max_len, size_t *len );
+
+/**
+ * @brief Set the value of a key
+ *
+ * The value is appended to the log, unless it is equal to the stored one. It may take up to
+ * #EEPROM_WB_FLUSH_DELAY to reach the EEPROM, see kv_sync().
+ *
+ * @param key    Key
+ * @param value  New value, or NULL to delete the key
+ * @param len    Value length (0 to delete the key)
+ *
+ * @return MMC_OK if success, an error code otherwise
+ */
+mmc_err kv_set( uint8_t key, const uint8_t *value, size_t len );
+
+/**
+ * @brief Wait until every value set so far is stored in the EEPROM
+ *
+ * @return MMC_OK if success, an error code otherwise
+ */
+mmc_err kv_sync( void );
+
+#endif
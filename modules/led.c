@@ -24,6 +24,7 @@
 
 /* Project includes */
 #include "FreeRTOS.h"
+#include "task.h"
 #include "queue.h"
 #include "ipmi.h"
 #include "port.h"
@@ -53,91 +54,162 @@ void LED_init( void )
     xTaskCreate( LED_Task, (const char *) "LED Task", 150, (void * ) NULL, tskLED_PRIORITY, ( TaskHandle_t * ) NULL);
 }
 
-void LED_Task( void *Parameters )
-{
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(100);
-
-    LEDUpdate_t cfg;
-
-    uint8_t cycle = 0;
+/* Level of an LED that has not been driven yet (or whose hardware may have lost its level) */
+#define LED_LEVEL_UNKNOWN   0x7F
 
-    for ( ;; ) {
-        cycle++;
-
-        for ( uint8_t i = 0; i < sizeof(led_config)/sizeof(led_config[0]); i++ ) {
-            for ( uint8_t j = 0; j < sizeof(led_config[i])/sizeof(led_config[i][0]); j++ ) {
-                LEDManage( &led_config[i][j] );
-            }
-        }
+static inline bool led_is_due( TickType_t deadline, TickType_t now )
+{
+    return (int32_t)( now - deadline ) >= 0;
+}
 
-        if ( cycle == 10 ) {
-            /* Check for state changes */
-            cycle = 0;
-            if ( xQueueReceive( led_update_queue, &cfg, 0 ) == pdTRUE ) {
-                uint8_t fru,num;
-
-                fru = cfg.fru_id;
-                num = cfg.led_num;
-
-                led_config[fru][num].mode = cfg.mode;
-                led_config[fru][num].mode_cfg[cfg.mode].active = true;
-                /* Only update the settings if its an override */
-                if ( cfg.mode != LEDMODE_LOCAL ) {
-                    led_config[fru][num].mode_cfg[cfg.mode].init_status = cfg.new_state.init_status;
-                    led_config[fru][num].mode_cfg[cfg.mode].t_init = cfg.new_state.t_init;
-                    led_config[fru][num].mode_cfg[cfg.mode].t_toggle = cfg.new_state.t_toggle;
-                    led_config[fru][num].state = LEDSTATE_INIT;
-                    /* Reset the LED internal counter */
-                    led_config[fru][num].counter = 0;
-                }
-            }
-        }
-        vTaskDelayUntil( &xLastWakeTime, xFrequency );
+/**
+ * @brief Drive an LED, calling its acting function only if the level changes
+ */
+static void led_set_level( LEDConfig_t *led_cfg, uint8_t level )
+{
+    if ( led_cfg->level != level ) {
+        led_cfg->act_func( led_cfg->id, level );
+        led_cfg->level = level;
     }
-
 }
 
-void LEDManage( LEDConfig_t *led_cfg )
+/**
+ * @brief Start the current phase (initial or toggled level) of an LED
+ *
+ * @param led_cfg Pointer to the LED configuration
+ * @param start   Time the phase starts at (the previous deadline when blinking, so periods do not drift)
+ */
+static void led_start_phase( LEDConfig_t *led_cfg, TickType_t start )
 {
-    uint8_t mode = led_cfg->mode;
-    uint8_t status;
-    uint16_t counter_cmp, counter_tog;
+    LEDState_t *mode_cfg = &led_cfg->mode_cfg[led_cfg->mode];
+    uint8_t level;
+    uint16_t duration, next_duration;
 
-    /* Reload counter */
     if ( led_cfg->state == LEDSTATE_INIT ) {
-        status = led_cfg->mode_cfg[mode].init_status;
-        counter_cmp = led_cfg->mode_cfg[mode].t_init;
-        counter_tog = led_cfg->mode_cfg[mode].t_toggle;
+        level = mode_cfg->init_status;
+        duration = mode_cfg->t_init;
+        next_duration = mode_cfg->t_toggle;
     } else {
-        status = ~(led_cfg->mode_cfg[mode].init_status);
-        counter_cmp = led_cfg->mode_cfg[mode].t_toggle;
-        counter_tog = led_cfg->mode_cfg[mode].t_init;
+        level = (uint8_t) ~( mode_cfg->init_status );
+        duration = mode_cfg->t_toggle;
+        next_duration = mode_cfg->t_init;
     }
 
-    /* Special case for lamp_test (we must return to the highest priority state */
-    if ( (led_cfg->mode == LEDMODE_LAMPTEST) && (led_cfg->counter >= counter_cmp) ) {
+    /* Lamp test ends after its duration, other modes only change level if they blink */
+    led_cfg->timed = ( led_cfg->mode == LEDMODE_LAMPTEST ) || ( next_duration != 0 );
+    led_cfg->deadline = start + ( ( duration != 0 ) ? duration : 1 ) * LED_TIME_UNIT;
+
+    led_set_level( led_cfg, level );
+}
+
+/**
+ * @brief Handle the end of the current phase of an LED
+ */
+static void led_expire( LEDConfig_t *led_cfg )
+{
+    if ( led_cfg->mode == LEDMODE_LAMPTEST ) {
+        /* Lamp test is over, we must return to the highest priority state */
         led_cfg->mode_cfg[LEDMODE_LAMPTEST].active = false;
-        /* Reset counter */
-        led_cfg->counter = 0;
 
-        /* Revert to the previous state */
         if ( led_cfg->mode_cfg[LEDMODE_OVERRIDE].active ) {
             led_cfg->mode = LEDMODE_OVERRIDE;
         } else {
             led_cfg->mode = LEDMODE_LOCAL;
         }
+        led_cfg->state = LEDSTATE_INIT;
+        led_start_phase( led_cfg, xTaskGetTickCount() );
+        return;
     }
 
-    if ( ( led_cfg->counter >= counter_cmp ) && ( counter_tog != 0 ) ) {
-        /* General case for blinking operation - toggle LED */
-        led_cfg->state = !(led_cfg->state);
-        led_cfg->act_func( led_cfg->id, LEDACT_TOGGLE );
-        led_cfg->counter = 0;
-    } else {
-        /* Stay in the current state and increment counter */
-        led_cfg->act_func( led_cfg->id, status );
-        led_cfg->counter++;
+    /* General case for blinking operation - toggle LED */
+    led_cfg->state = ( led_cfg->state == LEDSTATE_INIT ) ? LEDSTATE_TOGGLED : LEDSTATE_INIT;
+    led_start_phase( led_cfg, led_cfg->deadline );
+}
+
+static void led_apply_update( LEDUpdate_t *cfg )
+{
+    LEDConfig_t *led_cfg;
+
+    if ( cfg->led_num == LED_NUM_ALL ) {
+        /* Drive every LED of the FRU again on the next pass (e.g. the RTM was just inserted) */
+        for ( uint8_t num = 0; num < sizeof(led_config[cfg->fru_id])/sizeof(led_config[cfg->fru_id][0]); num++ ) {
+            led_config[cfg->fru_id][num].level = LED_LEVEL_UNKNOWN;
+            led_start_phase( &led_config[cfg->fru_id][num], xTaskGetTickCount() );
+        }
+        return;
+    }
+
+    led_cfg = &led_config[cfg->fru_id][cfg->led_num];
+
+    led_cfg->mode = cfg->mode;
+    led_cfg->mode_cfg[cfg->mode].active = true;
+    /* Only update the settings if its an override */
+    if ( cfg->mode != LEDMODE_LOCAL ) {
+        led_cfg->mode_cfg[cfg->mode].init_status = cfg->new_state.init_status;
+        led_cfg->mode_cfg[cfg->mode].t_init = cfg->new_state.t_init;
+        led_cfg->mode_cfg[cfg->mode].t_toggle = cfg->new_state.t_toggle;
+    }
+    led_cfg->state = LEDSTATE_INIT;
+
+    led_start_phase( led_cfg, xTaskGetTickCount() );
+}
+
+void LED_Task( void *Parameters )
+{
+    LEDUpdate_t cfg;
+    LEDConfig_t *led;
+    TickType_t now, wait;
+
+    for ( uint8_t i = 0; i < sizeof(led_config)/sizeof(led_config[0]); i++ ) {
+        for ( uint8_t j = 0; j < sizeof(led_config[i])/sizeof(led_config[i][0]); j++ ) {
+            led_config[i][j].level = LED_LEVEL_UNKNOWN;
+            led_config[i][j].state = LEDSTATE_INIT;
+            led_start_phase( &led_config[i][j], xTaskGetTickCount() );
+        }
+    }
+
+    for ( ;; ) {
+        /* Sleep until the next LED transition, or until an update request arrives */
+        now = xTaskGetTickCount();
+        wait = portMAX_DELAY;
+
+        for ( uint8_t i = 0; i < sizeof(led_config)/sizeof(led_config[0]); i++ ) {
+            for ( uint8_t j = 0; j < sizeof(led_config[i])/sizeof(led_config[i][0]); j++ ) {
+                led = &led_config[i][j];
+
+                if ( !led->timed ) {
+                    continue;
+                }
+                if ( led_is_due( led->deadline, now ) ) {
+                    wait = 0;
+                } else if ( ( led->deadline - now ) < wait ) {
+                    wait = led->deadline - now;
+                }
+            }
+        }
+
+        if ( xQueueReceive( led_update_queue, &cfg, wait ) == pdTRUE ) {
+            led_apply_update( &cfg );
+        }
+
+        now = xTaskGetTickCount();
+
+        for ( uint8_t i = 0; i < sizeof(led_config)/sizeof(led_config[0]); i++ ) {
+            for ( uint8_t j = 0; j < sizeof(led_config[i])/sizeof(led_config[i][0]); j++ ) {
+                led = &led_config[i][j];
+
+                if ( led->timed && led_is_due( led->deadline, now ) ) {
+                    led_expire( led );
+                }
+            }
+        }
+    }
+}
+
+static void led_send_update( LEDUpdate_t *update )
+{
+    if ( xQueueSend( led_update_queue, update, 0 ) != pdTRUE ) {
+        /* TODO: Handle error */
     }
 }
 
@@ -154,14 +226,30 @@ void LEDUpdate( uint8_t fru, uint8_t led_num, uint8_t mode, uint8_t init_status,
         }
     };
 
+    if ( ( fru >= sizeof(led_config)/sizeof(led_config[0])) || ( led_num >= sizeof(led_config[fru])/sizeof(led_config[fru][0]) ) || ( mode >= LEDMODE_CNT ) ) {
+        return;
+    }
+
     if ( new_config.mode == LEDMODE_LOCAL ) {
         led_config[fru][led_num].mode_cfg[LEDMODE_OVERRIDE].active = false;
         led_config[fru][led_num].mode_cfg[LEDMODE_LAMPTEST].active = false;
     }
 
-    if ( xQueueSend( led_update_queue, &new_config, 0 ) != pdTRUE ) {
-        /* TODO: Handle error */
+    led_send_update( &new_config );
+}
+
+void LEDRefresh( uint8_t fru )
+{
+    LEDUpdate_t refresh = {
+        .fru_id = fru,
+        .led_num = LED_NUM_ALL
+    };
+
+    if ( fru >= sizeof(led_config)/sizeof(led_config[0]) ) {
+        return;
     }
+
+    led_send_update( &refresh );
 }
 
 /* AMC LED acting function */
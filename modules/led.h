@@ -22,9 +22,20 @@
 #ifndef LED_H_
 #define LED_H_
 
+#include "FreeRTOS.h"
 #include "port.h"
 #include <stdbool.h>
 
+/**
+ * @brief Time unit of the LED on/off durations (in ticks)
+ */
+#define LED_TIME_UNIT       pdMS_TO_TICKS(100)
+
+/**
+ * @brief LED number used by LEDRefresh() requests, meaning every LED of the FRU
+ */
+#define LED_NUM_ALL         0xFF
+
 enum LEDColor {
     LEDCOLOR_BLUE = 1,
     LEDCOLOR_RED,
@@ -74,7 +85,9 @@ typedef struct LEDConfig {
     uint8_t state;
     uint8_t mode;
     LEDState_t mode_cfg[LEDMODE_CNT];
-    uint16_t counter;
+    uint8_t level;                  /* Level last driven through act_func (LEDACT_TURN_ON/OFF) */
+    bool timed;                     /* The current phase ends at deadline */
+    TickType_t deadline;            /* End of the current blink phase or lamp test */
 } LEDConfig_t;
 
 typedef struct LEDUpdate {
@@ -87,8 +100,8 @@ typedef struct LEDUpdate {
 
 void LED_init( void );
 void LED_Task( void *Parameters );
-void LEDManage( LEDConfig_t *led_cfg );
 void LEDUpdate( uint8_t fru, uint8_t led_num, uint8_t mode, uint8_t init_status, uint16_t t_init, uint16_t t_toggle );
+void LEDRefresh( uint8_t fru );
 void led_act( uint8_t id, uint8_t action );
 #ifdef MODULE_RTM
 void rtm_led_act( uint8_t id, uint8_t action );
@@ -50,6 +50,12 @@
 #ifdef MODULE_BOARD_CONFIG
 #include "board_config.h"
 #endif
+#ifdef MODULE_KV_STORE
+#include "kv_store.h"
+#endif
+#ifdef MODULE_SEL
+#include "sel.h"
+#endif
 
 /*-----------------------------------------------------------*/
 int main( void )
@@ -79,6 +85,13 @@ int main( void )
 
     ipmb_addr = get_ipmb_addr( );
 
+#ifdef MODULE_KV_STORE
+    kv_init();
+#endif
+#ifdef MODULE_SEL
+    sel_init();
+#endif
+
 #ifdef MODULE_FRU
     fru_init(FRU_AMC);
 #endif
@@ -33,6 +33,7 @@
 /* Project Includes */
 #include "port.h"
 #include "mcp23016.h"
+#include "expander_shadow.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
 
@@ -71,40 +72,6 @@ static mmc_err mcp23016_read_reg ( uint8_t reg, uint8_t *readout )
     return MMC_OK;
 }
 
-/**
- * @brief MCP23016 General register write
- *
- * @param[in] reg   Selected register
- * @param[in] data  Value to write to register
- *
- * @return MMC_OK if success, an error code otherwise
- */
-
-static mmc_err mcp23016_write_reg (uint8_t reg, uint8_t data) {
-
-    uint8_t i2c_addr;
-    uint8_t i2c_id;
-    uint8_t tx_len = 0;
-    uint8_t cmd_data[2];
-
-    cmd_data[0] = reg;
-    cmd_data[1] = data;
-
-    if( i2c_take_by_chipid( CHIP_ID_MCP23016, &i2c_addr, &i2c_id, pdMS_TO_TICKS(10)) ) {
-        tx_len = xI2CMasterWrite(i2c_id, i2c_addr, cmd_data, sizeof(cmd_data));
-        i2c_give(i2c_id);
-    } else {
-        return MMC_TIMEOUT_ERR;
-    }
-
-    if (tx_len != sizeof(cmd_data)) {
-        return MMC_IO_ERR;
-    }
-
-    return MMC_OK;
-}
-
-
 /* Pins Read/Write */
 mmc_err mcp23016_read_port( uint8_t port_num, uint8_t *readout )
 {
@@ -125,48 +92,42 @@ mmc_err mcp23016_read_pin( uint8_t port_num, uint8_t pin, uint8_t *status )
     return err;
 }
 
+/* Outputs are written to the latch register (as a GP write would), which is the one kept in the shadow copy */
 mmc_err mcp23016_write_port( uint8_t port_num, uint8_t data )
 {
-    return mcp23016_write_reg( MCP23016_GP_REG + port_num, data );
+    return expander_write_reg( CHIP_ID_MCP23016, MCP23016_OLAT_REG + port_num, data );
 }
 
-mmc_err mcp23016_write_pin( uint8_t port_num, uint8_t pin, bool data )
+mmc_err mcp23016_write_port_masked( uint8_t port_num, uint8_t mask, uint8_t data )
 {
-    uint8_t output = 0;
-    mmc_err err;
-
-    err = mcp23016_read_port( port_num, &output );
-
-    if (err != MMC_OK) {
-        return err;
-    }
-
-    output &= ~( 1 << pin );
-    output |= ( data << pin );
+    return expander_update_reg( CHIP_ID_MCP23016, MCP23016_OLAT_REG + port_num, mask, data );
+}
 
-    return mcp23016_write_port( port_num, output );
+mmc_err mcp23016_write_pin( uint8_t port_num, uint8_t pin, bool data )
+{
+    return mcp23016_write_port_masked( port_num, ( 1 << pin ), ( data << pin ) );
 }
 
 /* Polarity Control */
 mmc_err mcp23016_set_port_pol( uint8_t port_num, uint8_t pol )
 {
-    return mcp23016_write_reg( MCP23016_IPOL_REG + port_num, pol );
+    return expander_write_reg( CHIP_ID_MCP23016, MCP23016_IPOL_REG + port_num, pol );
 }
 
 mmc_err mcp23016_get_port_pol( uint8_t port_num, uint8_t *pol )
 {
-    return mcp23016_read_reg( MCP23016_IPOL_REG + port_num, pol );
+    return expander_read_reg( CHIP_ID_MCP23016, MCP23016_IPOL_REG + port_num, pol );
 }
 
 /* Pins direction (output/input) */
 mmc_err mcp23016_set_port_dir( uint8_t port_num, uint8_t dir )
 {
-    return mcp23016_write_reg( MCP23016_IODIR_REG + port_num, dir );
+    return expander_write_reg( CHIP_ID_MCP23016, MCP23016_IODIR_REG + port_num, dir );
 }
 
 mmc_err mcp23016_get_port_dir( uint8_t port_num, uint8_t *dir )
 {
-    return mcp23016_read_reg( MCP23016_IODIR_REG + port_num, dir );
+    return expander_read_reg( CHIP_ID_MCP23016, MCP23016_IODIR_REG + port_num, dir );
 }
 
 
@@ -205,6 +166,8 @@ mmc_err mcp23016_write_reg_pair ( uint8_t reg, uint16_t data )
 
     if( i2c_take_by_chipid( CHIP_ID_MCP23016, &i2c_addr, &i2c_id, pdMS_TO_TICKS(10)) ) {
         tx_len = xI2CMasterWrite(i2c_id, i2c_addr, cmd_data, sizeof(cmd_data));
+        /* Both registers of the pair bypass the shadow copies */
+        expander_shadow_invalidate( CHIP_ID_MCP23016 );
         i2c_give(i2c_id);
     } else {
         return MMC_TIMEOUT_ERR;
@@ -117,6 +117,19 @@ mmc_err mcp23016_read_pin( uint8_t port_num, uint8_t pin, uint8_t *status );
  */
 mmc_err mcp23016_write_port( uint8_t port_num, uint8_t data );
 
+/**
+ * @brief Write some port output pins, leaving the others unchanged
+ *
+ * The output latch is kept in a shadow copy, so nothing is written if the masked pins already hold @p data.
+ *
+ * @param[in] port_num Port number (0, 1)
+ * @param[in] mask     Pins to write
+ * @param[in] data     8-bit value with the pins status
+ *
+ * @return MMC_OK if success, an error code otherwise
+ */
+mmc_err mcp23016_write_port_masked( uint8_t port_num, uint8_t mask, uint8_t data );
+
 /**
  * @brief Write a output pin
  *
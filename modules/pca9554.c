@@ -34,6 +34,7 @@
 /* Project Includes */
 #include "port.h"
 #include "pca9554.h"
+#include "expander_shadow.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
 
@@ -64,27 +65,11 @@ static uint8_t pca9554_read_reg ( uint8_t chip_id, uint8_t reg, uint8_t *readout
 }
 
 /**
- * @brief PCA9554 General register write
- *
- * @param[in]  chip_id Chip ID to communicate
- * @param[in]  reg     Selected register
- * @param[in]  data    Value to write to register
- *
- * @return Number of bytes written
+ * @brief Convert a shadowed register access result to the amount of bytes transferred
  */
-static uint8_t pca9554_write_reg ( uint8_t chip_id, uint8_t reg, uint8_t data )
+static inline uint8_t pca9554_xfer_len( mmc_err err )
 {
-    uint8_t i2c_addr;
-    uint8_t i2c_id;
-    uint8_t cmd_data[2] = {reg, data};
-    uint8_t tx_len = 0;
-
-    if( i2c_take_by_chipid( chip_id, &i2c_addr, &i2c_id, (TickType_t) 10) ) {
-        tx_len = xI2CMasterWrite(i2c_id, i2c_addr, cmd_data, sizeof(cmd_data));
-        i2c_give(i2c_id);
-    }
-
-    return tx_len;
+    return ( err == MMC_OK ) ? 1 : 0;
 }
 
 /* Pins Read/Write */
@@ -108,40 +93,33 @@ uint8_t pca9554_read_pin( uint8_t chip_id, uint8_t pin, uint8_t *status )
 
 uint8_t pca9554_write_port( uint8_t chip_id, uint8_t data )
 {
-    return pca9554_write_reg( chip_id, PCA9554_OUTPUT_REG, data );
+    return pca9554_xfer_len( expander_write_reg( chip_id, PCA9554_OUTPUT_REG, data ) );
 }
 
-uint8_t pca9554_write_pin( uint8_t chip_id, uint8_t pin, bool data )
+uint8_t pca9554_write_port_masked( uint8_t chip_id, uint8_t mask, uint8_t data )
 {
-    uint8_t output = 0;
-
-    pca9554_read_port( chip_id, &output );
-    output &= ~( 1 << pin );
-    output |= ( data << pin );
+    return pca9554_xfer_len( expander_update_reg( chip_id, PCA9554_OUTPUT_REG, mask, data ) );
+}
 
-    return pca9554_write_port( chip_id, output );
+uint8_t pca9554_write_pin( uint8_t chip_id, uint8_t pin, bool data )
+{
+    return pca9554_write_port_masked( chip_id, ( 1 << pin ), ( data << pin ) );
 }
 
 /* Polarity Control */
 uint8_t pca9554_set_port_pol( uint8_t chip_id, uint8_t pol )
 {
-    return pca9554_write_reg( chip_id, PCA9554_POLARITY_REG, pol );
+    return pca9554_xfer_len( expander_write_reg( chip_id, PCA9554_POLARITY_REG, pol ) );
 }
 
 uint8_t pca9554_set_pin_pol( uint8_t chip_id, uint8_t pin, bool pol )
 {
-    uint8_t pol_reg = 0;
-
-    pca9554_read_port( chip_id, &pol_reg );
-    pol_reg &= ~( 1 << pin );
-    pol_reg |= ( pol << pin );
-
-    return pca9554_set_port_pol( chip_id, pol_reg );
+    return pca9554_xfer_len( expander_update_reg( chip_id, PCA9554_POLARITY_REG, ( 1 << pin ), ( pol << pin ) ) );
 }
 
 uint8_t pca9554_get_port_pol( uint8_t chip_id, uint8_t *pol )
 {
-    return pca9554_read_reg( chip_id, PCA9554_POLARITY_REG, pol );
+    return pca9554_xfer_len( expander_read_reg( chip_id, PCA9554_POLARITY_REG, pol ) );
 }
 
 uint8_t pca9554_get_pin_pol( uint8_t chip_id, uint8_t pin, uint8_t *pol )
@@ -159,23 +137,17 @@ uint8_t pca9554_get_pin_pol( uint8_t chip_id, uint8_t pin, uint8_t *pol )
 /* Pins direction (output/input) */
 uint8_t pca9554_set_port_dir( uint8_t chip_id, uint8_t dir )
 {
-    return pca9554_write_reg( chip_id, PCA9554_CFG_REG, dir );
+    return pca9554_xfer_len( expander_write_reg( chip_id, PCA9554_CFG_REG, dir ) );
 }
 
 uint8_t pca9554_set_pin_dir( uint8_t chip_id, uint8_t pin, bool dir )
 {
-    uint8_t dir_reg = 0;
-
-    pca9554_read_port( chip_id, &dir_reg );
-    dir_reg &= ~( 1 << pin );
-    dir_reg |= ( dir << pin );
-
-    return pca9554_set_port_dir( chip_id, dir_reg );
+    return pca9554_xfer_len( expander_update_reg( chip_id, PCA9554_CFG_REG, ( 1 << pin ), ( dir << pin ) ) );
 }
 
 uint8_t pca9554_get_port_dir( uint8_t chip_id, uint8_t *dir )
 {
-    return pca9554_read_reg( chip_id, PCA9554_CFG_REG, dir );
+    return pca9554_xfer_len( expander_read_reg( chip_id, PCA9554_CFG_REG, dir ) );
 }
 
 uint8_t pca9554_get_pin_dir( uint8_t chip_id, uint8_t pin, uint8_t *dir )
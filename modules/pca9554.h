@@ -102,6 +102,19 @@ uint8_t pca9554_read_pin( uint8_t chip_id, uint8_t pin, uint8_t *status );
  */
 uint8_t pca9554_write_port( uint8_t chip_id, uint8_t data );
 
+/**
+ * @brief Write some output pins, leaving the others unchanged
+ *
+ * The output register is kept in a shadow copy, so nothing is written if the masked pins already hold @p data.
+ *
+ * @param[in]  chip_id Chip ID to communicate
+ * @param[in]  mask    Pins to write
+ * @param[in]  data    8-bit value with the pins status
+ *
+ * @return 1 if the pins hold the requested status, 0 on failure
+ */
+uint8_t pca9554_write_port_masked( uint8_t chip_id, uint8_t mask, uint8_t data );
+
 /**
  * @brief Write a output pin
  *
@@ -34,6 +34,15 @@
 uint8_t pcf8574_read_port();
 uint8_t pcf8574_read_pin(uint8_t pin_num);
 
+/**
+ * @brief Write some port pins, leaving the others unchanged
+ *
+ * The port latch is kept in a shadow copy, so nothing is written if the masked pins already hold @p data.
+ *
+ * @param pin_mask Pins to write
+ * @param data     Pins status (a high pin is also an input)
+ */
+void pcf8574_update_port(uint8_t pin_mask, uint8_t data);
 void pcf8574_set_port_dir_output(uint8_t pin_mask);
 void pcf8574_set_port_dir_input(uint8_t pin_mask);
 void pcf8574_set_port_high(uint8_t pin_mask);
@@ -76,6 +76,9 @@ void RTM_Manage( void * Parameters )
                 /* Initialize basic hardware to enable communication */
                 rtm_hardware_init();
 
+                /* The RTM LEDs are only driven on level changes, restore their current levels */
+                LEDRefresh( FRU_RTM );
+
                 /* Create/Read the RTM FRU info before sending the hotswap event */
                 fru_init(FRU_RTM);
 
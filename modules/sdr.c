@@ -30,6 +30,7 @@
 #include "sdr.h"
 #include "mcp9808.h"
 #include "sensors.h"
+#include "sensor_sched.h"
 #include "ipmi.h"
 #include "fpga_spi.h"
 
@@ -38,8 +39,7 @@
 
 volatile uint8_t sdr_count = 0;
 
-sensor_t *sdr_head = NULL;
-sensor_t *sdr_tail = NULL;
+sensor_t *sdr_table[SDR_MAX_ENTRIES];
 
 static uint16_t reservationID;
 static uint32_t sdr_change_count;
@@ -97,56 +97,64 @@ void sensor_init( void )
 
 #ifdef MODULE_HOTSWAP
     hotswap_init();
-#else
-#define vTaskHotSwap_Handle NULL
-#endif
-#ifdef MODULE_LM75
-    LM75_init();
-#endif
-#ifdef MODULE_MCP9808
-    MCP9808_init();
-#endif
-#ifdef MODULE_MAX6642
-    MAX6642_init();
-#endif
-#if defined(MODULE_INA220_CURRENT) || defined(MODULE_INA220_VOLTAGE)
-    ina220_init();
-#endif
-#ifdef MODULE_ADT7420
-    ADT7420_init();
-#endif
-#ifdef MODULE_INA219
-    ina219_init();
-#endif
-#if defined(MODULE_INA3221_CURRENT) || defined(MODULE_INA3221_VOLTAGE)
-    ina3221_init();
 #endif
+
+    /* Every sensor driver is polled from a single scheduler task */
+    sensor_sched_init();
 }
 
 void sdr_init( void )
 {
-    sdr_head = NULL;
-    sdr_tail = NULL;
+    sdr_count = 0;
 
     /* Populate AMC SDR Device Locator Record */
-    sdr_head = sdr_insert_entry( TYPE_12, (void *) &SDR0, NULL, 0, 0 );
+    sdr_insert_entry( TYPE_12, (void *) &SDR0, NULL, 0, 0 );
 #ifdef MODULE_RTM
     sdr_insert_entry( TYPE_12, (void *) &SDR_RTM_DEV_LOCATOR, NULL, 0, 0 );
 #endif
 }
 
-sensor_t * sdr_insert_entry( SDR_TYPE type, void * sdr, TaskHandle_t *monitor_task, uint8_t diag_id, uint8_t chipid )
+/**
+ * @brief Writes the fields that are only known at run time (record ID, sensor number, owner and entity instance) into the record image
+ */
+static void sdr_patch_image( sensor_t * entry )
+{
+    uint8_t * img = entry->image;
+
+    img[0] = entry->num;
+    img[1] = 0;
+    img[5] = entry->ownerID;
+
+    if ( entry->sdr_type == TYPE_01 || entry->sdr_type == TYPE_02 ) {
+        img[7] = entry->num;
+        img[9] = entry->entityinstance;
+    } else if ( entry->sdr_type == TYPE_11 || entry->sdr_type == TYPE_12 ) {
+        img[13] = entry->entityinstance;
+    }
+}
+
+sensor_t * sdr_insert_entry( SDR_TYPE type, void * sdr, const struct sensor_driver_ops * driver, uint8_t diag_id, uint8_t chipid )
 {
     uint8_t sdr_len = sdr_get_size_by_type(type);
 
-    sensor_t * entry = pvPortMalloc( sizeof(sensor_t) );
+    if ( sdr_count >= SDR_MAX_ENTRIES ) {
+        printf( "[SDR] Repository full, increase SDR_MAX_ENTRIES!\n" );
+        return NULL;
+    }
+
+    /* The record image is kept right after the sensor struct */
+    sensor_t * entry = pvPortMalloc( sizeof(sensor_t) + sdr_len );
+
+    if ( entry == NULL ) {
+        return NULL;
+    }
     memset( entry, 0, sizeof(sensor_t) );
 
     entry->num = sdr_count;
     entry->sdr_type = type;
     entry->sdr = sdr;
     entry->sdr_length = sdr_len;
-    entry->task_handle = monitor_task;
+    entry->driver = driver;
     entry->diag_devID = diag_id;
     entry->chipid = chipid;
     entry->ownerID = ipmb_addr;
@@ -155,12 +163,12 @@ sensor_t * sdr_insert_entry( SDR_TYPE type, void * sdr, TaskHandle_t *monitor_ta
     entry->state = SENSOR_STATE_LOW_NON_REC;
     entry->event_scan = 0xC0; /* Start with sensor enabled */
 
-    /* Link the sdr list */
-    if (sdr_tail) {
-        sdr_tail->next = entry;
-    }
-    sdr_tail = entry;
-    entry->next = NULL;
+    /* Serialize the record once, so Get SDR only has to copy it */
+    entry->image = (uint8_t *) ( entry + 1 );
+    memcpy( entry->image, sdr, sdr_len );
+    sdr_patch_image( entry );
+
+    sdr_table[sdr_count] = entry;
 
     sdr_count++;
     sdr_change_count++;
@@ -170,11 +178,9 @@ sensor_t * sdr_insert_entry( SDR_TYPE type, void * sdr, TaskHandle_t *monitor_ta
 
 sensor_t * sdr_add_settings(uint8_t chipid, void * settings)
 {
-    sensor_t * sensor;
-
-    for (sensor = sdr_head; sensor != NULL; sensor = sensor->next) {
-        if (sensor->chipid == chipid) {
-            sensor->settings = settings;
+    for (uint8_t i = 0; i < sdr_count; i++) {
+        if (sdr_table[i]->chipid == chipid) {
+            sdr_table[i]->settings = settings;
         }
     }
 
@@ -183,11 +189,9 @@ sensor_t * sdr_add_settings(uint8_t chipid, void * settings)
 
 sensor_t * find_sensor_by_sdr( void * sdr )
 {
-    sensor_t * cur;
-
-    for ( cur = sdr_head; cur != NULL; cur = cur->next ) {
-        if (cur->sdr == sdr) {
-            return cur;
+    for ( uint8_t i = 0; i < sdr_count; i++ ) {
+        if (sdr_table[i]->sdr == sdr) {
+            return sdr_table[i];
         }
     }
     return NULL;
@@ -196,53 +200,32 @@ sensor_t * find_sensor_by_sdr( void * sdr )
 
 sensor_t * find_sensor_by_id( uint8_t id )
 {
-    sensor_t * cur;
-
-    for ( cur = sdr_head; cur != NULL; cur = cur->next ) {
-        if (cur->num == id) {
-            return cur;
-        }
+    /* Record IDs and sensor numbers are the repository indexes */
+    if ( id >= sdr_count ) {
+        return NULL;
     }
-    return NULL;
+    return sdr_table[id];
 }
 
 void sdr_remove_entry( sensor_t * entry )
 {
-    sensor_t * cur = sdr_head;
-    sensor_t * prev = NULL;
-
-    if (entry == sdr_head) {
-        sdr_pop();
+    if ( entry == NULL || entry->num >= sdr_count || sdr_table[entry->num] != entry ) {
+        return;
     }
 
-    while (cur != entry) {
-        prev = cur;
-        cur = cur->next;
-        if (cur == NULL) {
-            /* We reached the end of the list and didn't find the entry */
-            return;
-        }
+    /* Close the gap, renumbering the following records */
+    for ( uint8_t i = entry->num; i < sdr_count - 1; i++ ) {
+        sdr_table[i] = sdr_table[i+1];
+        sdr_table[i]->num = i;
+        sdr_patch_image( sdr_table[i] );
     }
 
-    /* Relink the table */
-    prev->next = cur->next;
-
     sdr_count--;
+    sdr_table[sdr_count] = NULL;
     sdr_change_count++;
 
     /* Free the entry */
-    vPortFree(cur);
-}
-
-void sdr_pop( void )
-{
-    sensor_t * new_head;
-
-    if ( sdr_head ) {
-        new_head = sdr_head->next;
-        vPortFree( sdr_head );
-        sdr_head = new_head;
-    }
+    vPortFree(entry);
 }
 
 void sensor_enable(sensor_t *sensor)
@@ -349,17 +332,20 @@ IPMI_HANDLER(ipmi_se_get_sdr, NETFN_SE, IPMI_GET_DEVICE_SDR_CMD, ipmi_msg *req,
         return;
     }
 
-    sensor_t * cur_sensor = find_sensor_by_id( record_id );
+    sensor_t * cur_sensor = ( record_id <= UINT8_MAX ) ? find_sensor_by_id( record_id ) : NULL;
 
-    if ( cur_sensor == NULL ) {
+    if ( ( cur_sensor == NULL ) || ( (size + offset) > cur_sensor->sdr_length ) ) {
         rsp->completion_code = IPMI_CC_REQ_DATA_NOT_PRESENT;
         return;
     }
 
-    if ( (record_id >= sdr_count) || ((size + offset) > cur_sensor->sdr_length)) {
-        rsp->completion_code = IPMI_CC_REQ_DATA_NOT_PRESENT;
+    /* Next record ID comes before the record data */
+    if ( size > sizeof(rsp->data) - 2 ) {
+        rsp->completion_code = IPMI_CC_CANT_RET_NUM_REQ_BYTES;
         return;
-    } else if (record_id == sdr_count - 1) {
+    }
+
+    if (record_id == sdr_count - 1) {
         rsp->data[len++] = 0xFF;
         rsp->data[len++] = 0xFF;
     } else {
@@ -367,33 +353,9 @@ IPMI_HANDLER(ipmi_se_get_sdr, NETFN_SE, IPMI_GET_DEVICE_SDR_CMD, ipmi_msg *req,
         rsp->data[len++] = (record_id + 1) >> 8; /* next record ID */
     }
 
-    uint8_t tmp_c, index;
-    uint8_t * pSDR = (uint8_t *) cur_sensor->sdr;
-    uint8_t sdr_type = pSDR[3];
-
-    for (uint8_t i = 0; i < size; i++) {
-        index = i + offset;
-        tmp_c = pSDR[index];
-
-        /* Return not-const data from SDR */
-        if (index == 0) {
-            tmp_c = record_id;
-        } else if (index == 5) {
-            tmp_c = ipmb_addr;
-        } else if ( sdr_type == TYPE_01 || sdr_type == TYPE_02 ) {
-            if (index == 9) {
-                tmp_c = cur_sensor->entityinstance;
-            }
-            if (index == 7) {
-                tmp_c = record_id;
-            }
-        } else if ( sdr_type == TYPE_11 || sdr_type == TYPE_12 ) {
-            if (index == 13) {
-                tmp_c = cur_sensor->entityinstance;
-            }
-        }
-        rsp->data[len++] = tmp_c;
-    }
+    /* The image already holds the run time fields */
+    memcpy( &rsp->data[len], &cur_sensor->image[offset], size );
+    len += size;
 
     rsp->data_len = len;
 }
@@ -418,13 +380,18 @@ IPMI_HANDLER(ipmi_se_get_sensor_reading, NETFN_SE, IPMI_GET_SENSOR_READING_CMD,
 
     sensor_t * cur_sensor = find_sensor_by_id( sensor_number );
 
-    if (sensor_number > sdr_count) {
+    if (cur_sensor == NULL) {
         rsp->completion_code = IPMI_CC_PARAM_OUT_OF_RANGE;
         rsp->data_len = 0;
         return;
     }
 
-    if (vTaskHotSwap_Handle != NULL && *(cur_sensor->task_handle) == vTaskHotSwap_Handle) {
+    bool hotswap_sensor = false;
+#ifdef MODULE_HOTSWAP
+    hotswap_sensor = (cur_sensor->driver == &hotswap_driver);
+#endif
+
+    if (hotswap_sensor) {
         rsp->data[len++] = 0x00;
         rsp->data[len++] = cur_sensor->event_scan;
         /* Current State Mask */
@@ -449,15 +416,15 @@ IPMI_HANDLER(ipmi_se_get_sensor_threshold, NETFN_SE, IPMI_GET_SENSOR_THRESHOLD_C
     int sensor_number = req->data[0];
     int len = rsp->data_len;
 
+    sensor_t *cur_sensor = find_sensor_by_id( sensor_number );
+
     /* Check if the requested sensor exists */
-    if (sensor_number > sdr_count) {
+    if (cur_sensor == NULL) {
         rsp->completion_code = IPMI_CC_PARAM_OUT_OF_RANGE;
         rsp->data_len = 0;
         return;
     }
 
-    sensor_t *cur_sensor = find_sensor_by_id( sensor_number );
-
     /* Check if the selected sensor has a Full Sensor Record */
     if ( cur_sensor->sdr_type != TYPE_01) {
         rsp->completion_code = IPMI_CC_INV_DATA_FIELD_IN_REQ;
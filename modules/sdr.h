@@ -183,6 +183,8 @@ typedef struct {
     char IDstring[16];
 } SDR_type_12h_t;
 
+struct sensor_driver_ops;
+
 typedef struct sensor_t {
     uint8_t num;
     SDR_TYPE sdr_type;
@@ -197,7 +199,8 @@ typedef struct sensor_t {
     uint8_t event_scan;
     uint8_t ownerID; /* This field is repeated here because its value is assigned during initialization, so it can't be const */
     uint8_t entityinstance; /* This field is repeated here because its value is assigned during initialization, so it can't be const */
-    TaskHandle_t * task_handle;
+    const struct sensor_driver_ops * driver; /* Driver that polls this sensor, see sensor_sched.h (NULL for records without a reading) */
+    void * driver_data; /* Per-sensor state owned by the driver */
     struct {
         uint16_t upper_non_recoverable_go_high:1;
         uint16_t upper_non_recoverable_go_low:1;
@@ -213,12 +216,17 @@ typedef struct sensor_t {
         uint16_t lower_non_critical_go_low:1;
     } asserted_event;
     void* settings;
-    struct sensor_t *next;
+    uint8_t * image; /* Record bytes as sent in Get SDR, with the record ID, owner and entity instance already patched */
 } sensor_t;
 
+/* Maximum number of records in the SDR repository, may be overridden by the board */
+#ifndef SDR_MAX_ENTRIES
+#define SDR_MAX_ENTRIES                 96
+#endif
+
 extern volatile uint8_t sdr_count;
-extern sensor_t *sdr_head;
-extern sensor_t *sdr_tail;
+/* SDR repository, indexed by record ID (which is also the sensor number) */
+extern sensor_t *sdr_table[SDR_MAX_ENTRIES];
 
 extern const SDR_type_12h_t SDR0;
 extern const SDR_type_12h_t SDR_RTM_DEV_LOCATOR;
@@ -237,10 +245,9 @@ void sensor_enable(sensor_t *sensor);
 void sensor_disable(sensor_t *sensor);
 void check_sensor_event( sensor_t * sensor );
 void sensor_state_check( sensor_t *sensor );
-sensor_t * sdr_insert_entry( SDR_TYPE type, void * sdr, TaskHandle_t *monitor_task, uint8_t diag_id, uint8_t slave_addr);
+sensor_t * sdr_insert_entry( SDR_TYPE type, void * sdr, const struct sensor_driver_ops * driver, uint8_t diag_id, uint8_t slave_addr);
 sensor_t * sdr_add_settings(uint8_t chipid, void * settings);
 void sdr_remove_entry( sensor_t * entry );
-void sdr_pop( void );
 sensor_t * sdr_add_settings(uint8_t chipid, void * settings);
 sensor_t * find_sensor_by_sdr( void * sdr );
 sensor_t * find_sensor_by_id( uint8_t id );
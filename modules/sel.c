@@ -0,0 +1,565 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file   sel.c
+ *
+ * @brief  Persistent System Event Log in a 24xx64 EEPROM implementation
+ */
+
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "string.h"
+
+/* Project Includes */
+#include "port.h"
+#include "sel.h"
+#include "ipmi.h"
+#include "ipmb.h"
+#include "eeprom_24xx64.h"
+#include "i2c_mapping.h"
+#include "task_priorities.h"
+#include "utils.h"
+#include "uart_debug.h"
+
+/* The board may place the log in another chip, or in another part of it */
+#ifndef SEL_EEPROM_ID
+#define SEL_EEPROM_ID           CHIP_ID_EEPROM_64K
+#endif
+
+#ifndef SEL_BASE_ADDR
+#define SEL_BASE_ADDR           0x1000
+#endif
+
+#ifndef SEL_AREA_SIZE
+#define SEL_AREA_SIZE           0x1000
+#endif
+
+#define SEL_SLOTS               ( SEL_AREA_SIZE / SEL_SLOT_SIZE )
+
+/* Slot layout: SEL record, sequence number (4 bytes), CRC-16 (2 bytes), little endian */
+#define SEL_SEQ_OFFSET          SEL_RECORD_SIZE
+#define SEL_CRC_OFFSET          ( SEL_SEQ_OFFSET + 4 )
+#define SEL_SLOT_USED           ( SEL_CRC_OFFSET + 2 )
+
+/* Not 0xFFFF, so that other data left in the area (e.g. by an older layout) is not taken for entries */
+#define SEL_CRC_SEED            0x5E1C
+
+/* Record IDs 0000h and FFFFh are reserved (first and last entry) */
+#define SEL_RECORD_ID_COUNT     0xFFFE
+#define SEL_RECORD_ID_FIRST     0x0000
+#define SEL_RECORD_ID_LAST      0xFFFF
+
+/* The log is scanned through a window, a multiple of the slot size */
+#define SEL_SCAN_WINDOW         ( 2 * SEL_SLOT_SIZE )
+
+#define SEL_LOAD_RETRY_DELAY    pdMS_TO_TICKS(10000)
+
+/* Delay before writing the queued entries again after a failed flush */
+#define SEL_WRITE_RETRY_DELAY   pdMS_TO_TICKS(5000)
+
+#define SEL_VERSION             0x51
+#define SEL_OP_RESERVE          ( 1 << 1 )
+#define SEL_OP_OVERFLOW         ( 1 << 7 )
+
+/* Entries logged by the MMC itself are not tied to any sensor in the SDR */
+#define SEL_MMC_SENSOR_NUM      0xFF
+#define SEL_SENSOR_SPECIFIC     0x6F
+
+#define SEL_SENSOR_SYSTEM_BOOT  0x1D
+#define SEL_BOOT_POWER_UP       0x00
+#define SEL_BOOT_HARD_RESET     0x01
+#define SEL_BOOT_SYSTEM_RESTART 0x07
+#define SEL_BOOT_SOFTWARE_RESET 0x05
+
+#define SEL_SENSOR_WATCHDOG_2   0x23
+#define SEL_WATCHDOG_HARD_RESET 0x01
+
+TaskHandle_t vTaskSEL_Handle;
+
+static SemaphoreHandle_t sel_mutex;
+
+/* Given when an entry is queued, so the wake-up doesn't depend on the drivers the flush goes through */
+static SemaphoreHandle_t sel_wake;
+static volatile bool sel_loaded;        /* The end of the log is known, so entries can be written */
+static uint32_t sel_first;              /* Sequence number of the oldest entry */
+static uint32_t sel_next;               /* Sequence number of the next entry */
+static uint32_t sel_last_add = 0xFFFFFFFF;
+static uint16_t sel_reservation;
+
+/* Entries waiting to be written, shared with the callers of sel_add_event() */
+static uint8_t sel_queue[SEL_QUEUE_LEN][SEL_RECORD_SIZE];
+static uint8_t sel_queue_head;
+static uint8_t sel_queue_count;
+static uint32_t sel_dropped;
+
+static uint8_t sel_window[SEL_SCAN_WINDOW];
+
+static uint16_t sel_record_id( uint32_t seq )
+{
+    return ( seq % SEL_RECORD_ID_COUNT ) + 1;
+}
+
+static uint16_t sel_slot_addr( uint32_t seq )
+{
+    return SEL_BASE_ADDR + ( ( seq % SEL_SLOTS ) * SEL_SLOT_SIZE );
+}
+
+static void sel_queue_push( const uint8_t *record )
+{
+    bool queued = false;
+
+    taskENTER_CRITICAL();
+    if ( sel_queue_count < SEL_QUEUE_LEN ) {
+        memcpy( sel_queue[( sel_queue_head + sel_queue_count ) % SEL_QUEUE_LEN], record, SEL_RECORD_SIZE );
+        sel_queue_count++;
+        queued = true;
+    } else {
+        sel_dropped++;
+    }
+    taskEXIT_CRITICAL();
+
+    if ( queued && ( sel_wake != NULL ) ) {
+        xSemaphoreGive( sel_wake );
+    }
+}
+
+void sel_add_event( const uint8_t *event_msg )
+{
+    uint8_t record[SEL_RECORD_SIZE];
+    uint32_t timestamp = xTaskGetTickCount() / configTICK_RATE_HZ;
+
+    /* The record ID is assigned when the entry is written */
+    record[0] = 0;
+    record[1] = 0;
+    record[2] = SEL_RECORD_SYSTEM_EVENT;
+    record[3] = timestamp & 0xFF;
+    record[4] = ( timestamp >> 8 ) & 0xFF;
+    record[5] = ( timestamp >> 16 ) & 0xFF;
+    record[6] = ( timestamp >> 24 ) & 0xFF;
+    record[7] = ipmb_addr;
+    record[8] = 0x00;
+    memcpy( &record[9], event_msg, IPMI_EVENT_MSG_LEN );
+
+    sel_queue_push( record );
+}
+
+static void sel_add_mmc_event( uint8_t sensor_type, uint8_t offset )
+{
+    uint8_t event_msg[IPMI_EVENT_MSG_LEN] = { IPMI_EVENT_MESSAGE_REV, sensor_type, SEL_MMC_SENSOR_NUM, SEL_SENSOR_SPECIFIC, offset, 0xFF, 0xFF };
+
+    sel_add_event( event_msg );
+}
+
+static void sel_add_fault( const fault_dump_t *dump )
+{
+    uint8_t record[SEL_RECORD_SIZE] = { 0 };
+
+    record[2] = SEL_RECORD_OEM_FAULT;
+    record[3] = dump->type;
+    for ( uint8_t i = 0; i < 4; i++ ) {
+        record[4 + i] = ( dump->pc >> ( 8 * i ) ) & 0xFF;
+        record[8 + i] = ( dump->lr >> ( 8 * i ) ) & 0xFF;
+        record[12 + i] = ( dump->psr >> ( 8 * i ) ) & 0xFF;
+    }
+
+    sel_queue_push( record );
+}
+
+/**
+ * @brief Check the CRC of a slot
+ *
+ * @return true if the slot holds an entry, whose sequence number is written to @p seq
+ */
+static bool sel_slot_check( const uint8_t *slot, uint32_t *seq )
+{
+    if ( calculate_crc16( slot, SEL_CRC_OFFSET, SEL_CRC_SEED ) != ( slot[SEL_CRC_OFFSET] | ( slot[SEL_CRC_OFFSET + 1] << 8 ) ) ) {
+        return false;
+    }
+
+    *seq = slot[SEL_SEQ_OFFSET] | ( slot[SEL_SEQ_OFFSET + 1] << 8 ) | ( slot[SEL_SEQ_OFFSET + 2] << 16 ) |
+        ( (uint32_t) slot[SEL_SEQ_OFFSET + 3] << 24 );
+    return true;
+}
+
+static bool sel_write_slot( uint32_t seq, const uint8_t *record )
+{
+    uint8_t slot[SEL_SLOT_USED];
+    uint16_t id = sel_record_id( seq );
+    uint16_t crc;
+
+    memcpy( slot, record, SEL_RECORD_SIZE );
+    slot[0] = id & 0xFF;
+    slot[1] = id >> 8;
+    slot[SEL_SEQ_OFFSET] = seq & 0xFF;
+    slot[SEL_SEQ_OFFSET + 1] = ( seq >> 8 ) & 0xFF;
+    slot[SEL_SEQ_OFFSET + 2] = ( seq >> 16 ) & 0xFF;
+    slot[SEL_SEQ_OFFSET + 3] = ( seq >> 24 ) & 0xFF;
+    crc = calculate_crc16( slot, SEL_CRC_OFFSET, SEL_CRC_SEED );
+    slot[SEL_CRC_OFFSET] = crc & 0xFF;
+    slot[SEL_CRC_OFFSET + 1] = crc >> 8;
+
+    return ( eeprom_24xx64_write( SEL_EEPROM_ID, sel_slot_addr( seq ), slot, sizeof(slot), SEL_BUS_TIMEOUT ) == sizeof(slot) );
+}
+
+/**
+ * @brief Find the entries of the log
+ *
+ * Slots are written in sequence order, so the log is the run of valid slots that ends at the highest
+ * sequence number. Older data (e.g. a slot torn by a power loss) ends the run.
+ *
+ * @return false if the EEPROM couldn't be read
+ */
+static bool sel_load( void )
+{
+    uint32_t valid[( SEL_SLOTS + 31 ) / 32] = { 0 };
+    uint32_t seq, newest = 0;
+    bool found = false;
+    uint16_t slot;
+
+    for ( uint16_t addr = 0; addr < SEL_AREA_SIZE; addr += SEL_SCAN_WINDOW ) {
+        if ( eeprom_24xx64_read( SEL_EEPROM_ID, SEL_BASE_ADDR + addr, sel_window, SEL_SCAN_WINDOW, SEL_BUS_TIMEOUT ) != SEL_SCAN_WINDOW ) {
+            return false;
+        }
+
+        for ( uint16_t offset = 0; offset < SEL_SCAN_WINDOW; offset += SEL_SLOT_SIZE ) {
+            slot = ( addr + offset ) / SEL_SLOT_SIZE;
+
+            if ( !sel_slot_check( &sel_window[offset], &seq ) || ( ( seq % SEL_SLOTS ) != slot ) ) {
+                continue;
+            }
+
+            valid[slot / 32] |= 1UL << ( slot % 32 );
+
+            if ( !found || ( (int32_t)( seq - newest ) > 0 ) ) {
+                newest = seq;
+                found = true;
+            }
+        }
+    }
+
+    if ( !found ) {
+        sel_first = sel_next = 0;
+        return true;
+    }
+
+    sel_next = newest + 1;
+    sel_first = newest;
+
+    while ( ( sel_first > 0 ) && ( sel_next - sel_first < SEL_SLOTS ) ) {
+        slot = ( sel_first - 1 ) % SEL_SLOTS;
+
+        if ( !( valid[slot / 32] & ( 1UL << ( slot % 32 ) ) ) ) {
+            break;
+        }
+        sel_first--;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Write the queued entries, the mutex must be held
+ */
+static bool sel_flush( void )
+{
+    uint8_t record[SEL_RECORD_SIZE];
+    bool pending;
+    bool ok = true;
+
+    for ( ;; ) {
+        taskENTER_CRITICAL();
+        pending = ( sel_queue_count > 0 );
+        if ( pending ) {
+            memcpy( record, sel_queue[sel_queue_head], SEL_RECORD_SIZE );
+        }
+        taskEXIT_CRITICAL();
+
+        if ( !pending ) {
+            break;
+        }
+
+        /* Once the ring is full, the slot about to be written holds the oldest entry */
+        if ( sel_next - sel_first >= SEL_SLOTS ) {
+            sel_first = sel_next - SEL_SLOTS + 1;
+        }
+
+        /* On errors the entry stays queued and is written to the same slot on the next flush */
+        if ( !sel_write_slot( sel_next, record ) ) {
+            ok = false;
+            break;
+        }
+        sel_next++;
+
+        if ( record[2] == SEL_RECORD_SYSTEM_EVENT ) {
+            sel_last_add = record[3] | ( record[4] << 8 ) | ( record[5] << 16 ) | ( (uint32_t) record[6] << 24 );
+        }
+
+        taskENTER_CRITICAL();
+        sel_queue_head = ( sel_queue_head + 1 ) % SEL_QUEUE_LEN;
+        sel_queue_count--;
+        taskEXIT_CRITICAL();
+    }
+
+    return eeprom_24xx64_sync( SEL_EEPROM_ID, SEL_BUS_TIMEOUT ) && ok;
+}
+
+void sel_init( void )
+{
+    fault_dump_t dump;
+    uint32_t cause = reset_cause_pop();
+
+    sel_mutex = xSemaphoreCreateMutex();
+    sel_wake = xSemaphoreCreateBinary();
+
+    /* A power-on reset clears the other flags, and the LPC175x/6x has no flag for software resets */
+    if ( cause & ( SYSCTL_RST_POR | SYSCTL_RST_BOD ) ) {
+        sel_add_mmc_event( SEL_SENSOR_SYSTEM_BOOT, SEL_BOOT_POWER_UP );
+    } else if ( cause & SYSCTL_RST_EXTRST ) {
+        sel_add_mmc_event( SEL_SENSOR_SYSTEM_BOOT, SEL_BOOT_HARD_RESET );
+    } else if ( cause & SYSCTL_RST_WDT ) {
+        sel_add_mmc_event( SEL_SENSOR_WATCHDOG_2, SEL_WATCHDOG_HARD_RESET );
+        sel_add_mmc_event( SEL_SENSOR_SYSTEM_BOOT, SEL_BOOT_SYSTEM_RESTART );
+    } else {
+        sel_add_mmc_event( SEL_SENSOR_SYSTEM_BOOT, SEL_BOOT_SOFTWARE_RESET );
+    }
+
+    if ( fault_dump_pop( &dump ) ) {
+        sel_add_fault( &dump );
+    }
+
+    xTaskCreate( vTaskSEL, "SEL", 256, (void *) NULL, tskSEL_PRIORITY, &vTaskSEL_Handle );
+}
+
+bool sel_sync( TickType_t timeout )
+{
+    bool ok;
+
+    if ( ( sel_mutex == NULL ) || ( xSemaphoreTake( sel_mutex, timeout ) != pdTRUE ) ) {
+        return false;
+    }
+
+    ok = sel_loaded && sel_flush();
+
+    xSemaphoreGive( sel_mutex );
+
+    return ok;
+}
+
+void vTaskSEL( void * Parameters )
+{
+    bool ok;
+    bool pending;
+
+    xSemaphoreTake( sel_mutex, portMAX_DELAY );
+
+    /* Writing without knowing the end of the log could overwrite the newest entries */
+    while ( !sel_load() ) {
+        printf( "[SEL] Could not read the EEPROM, retrying\n" );
+        xSemaphoreGive( sel_mutex );
+        vTaskDelay( SEL_LOAD_RETRY_DELAY );
+        xSemaphoreTake( sel_mutex, portMAX_DELAY );
+    }
+    sel_loaded = true;
+
+    printf( "[SEL] %d entries\n", (int)( sel_next - sel_first ) );
+
+    xSemaphoreGive( sel_mutex );
+
+    for ( ;; ) {
+        xSemaphoreTake( sel_mutex, portMAX_DELAY );
+        ok = sel_flush();
+        xSemaphoreGive( sel_mutex );
+
+        if ( !ok ) {
+            /* The entries are still queued, write them again later */
+            printf( "[SEL] Could not write the EEPROM, retrying\n" );
+            vTaskDelay( SEL_WRITE_RETRY_DELAY );
+            continue;
+        }
+
+        /* Entries queued while flushing are written in the next batch without waiting for another one */
+        taskENTER_CRITICAL();
+        pending = ( sel_queue_count > 0 );
+        taskEXIT_CRITICAL();
+
+        if ( !pending ) {
+            xSemaphoreTake( sel_wake, portMAX_DELAY );
+        }
+
+        /* Gather the entries that follow the first one into a single batch */
+        vTaskDelay( SEL_FLUSH_DELAY );
+    }
+}
+
+/**
+ * @brief Find the sequence number of a record ID
+ *
+ * @return false if the record is not in the log
+ */
+static bool sel_find( uint16_t id, uint32_t *seq )
+{
+    uint32_t count = sel_next - sel_first;
+    uint32_t delta;
+
+    if ( count == 0 ) {
+        return false;
+    }
+
+    if ( id == SEL_RECORD_ID_FIRST ) {
+        *seq = sel_first;
+        return true;
+    }
+
+    if ( id == SEL_RECORD_ID_LAST ) {
+        *seq = sel_next - 1;
+        return true;
+    }
+
+    delta = ( sel_record_id( sel_next - 1 ) + SEL_RECORD_ID_COUNT - id ) % SEL_RECORD_ID_COUNT;
+    if ( delta >= count ) {
+        return false;
+    }
+
+    *seq = sel_next - 1 - delta;
+    return true;
+}
+
+IPMI_HANDLER(ipmi_storage_get_sel_info, NETFN_STORAGE, IPMI_GET_SEL_INFO_CMD, ipmi_msg * req, ipmi_msg * rsp )
+{
+    uint8_t len = rsp->data_len = 0;
+    uint16_t entries;
+    uint16_t free_space;
+    uint32_t last_add;
+    uint8_t op = SEL_OP_RESERVE;
+
+    if ( !sel_loaded ) {
+        rsp->completion_code = IPMI_CC_CANT_RESP_BMC_INIT;
+        return;
+    }
+
+    /* Only counters are read, so the IPMI task never waits for a flush in progress */
+    taskENTER_CRITICAL();
+    entries = sel_next - sel_first;
+    last_add = sel_last_add;
+    if ( ( sel_first != 0 ) || ( sel_dropped != 0 ) ) {
+        op |= SEL_OP_OVERFLOW;
+    }
+    taskEXIT_CRITICAL();
+
+    free_space = ( SEL_SLOTS - entries ) * SEL_RECORD_SIZE;
+
+    rsp->data[len++] = SEL_VERSION;
+    rsp->data[len++] = entries & 0xFF;
+    rsp->data[len++] = entries >> 8;
+    rsp->data[len++] = free_space & 0xFF;
+    rsp->data[len++] = free_space >> 8;
+    rsp->data[len++] = last_add & 0xFF;
+    rsp->data[len++] = ( last_add >> 8 ) & 0xFF;
+    rsp->data[len++] = ( last_add >> 16 ) & 0xFF;
+    rsp->data[len++] = ( last_add >> 24 ) & 0xFF;
+    /* Never erased */
+    rsp->data[len++] = 0xFF;
+    rsp->data[len++] = 0xFF;
+    rsp->data[len++] = 0xFF;
+    rsp->data[len++] = 0xFF;
+    rsp->data[len++] = op;
+
+    rsp->data_len = len;
+    rsp->completion_code = IPMI_CC_OK;
+}
+
+IPMI_HANDLER(ipmi_storage_reserve_sel, NETFN_STORAGE, IPMI_RESERVE_SEL_CMD, ipmi_msg * req, ipmi_msg * rsp )
+{
+    uint8_t len = rsp->data_len = 0;
+
+    /* 0000h is not a valid reservation ID */
+    if ( ++sel_reservation == 0 ) {
+        sel_reservation = 1;
+    }
+
+    rsp->data[len++] = sel_reservation & 0xFF;
+    rsp->data[len++] = sel_reservation >> 8;
+
+    rsp->data_len = len;
+    rsp->completion_code = IPMI_CC_OK;
+}
+
+IPMI_HANDLER_DEFERRED(ipmi_storage_get_sel_entry, NETFN_STORAGE, IPMI_GET_SEL_ENTRY_CMD, ipmi_msg * req, ipmi_msg * rsp )
+{
+    uint8_t len = rsp->data_len = 0;
+    uint8_t slot[SEL_SLOT_USED];
+    uint16_t reservation, id, next_id;
+    uint8_t offset, count;
+    uint32_t seq, slot_seq;
+
+    if ( req->data_len < 6 ) {
+        rsp->completion_code = IPMI_CC_REQ_DATA_INV_LENGTH;
+        return;
+    }
+
+    reservation = req->data[0] | ( req->data[1] << 8 );
+    id = req->data[2] | ( req->data[3] << 8 );
+    offset = req->data[4];
+    count = req->data[5];
+
+    if ( offset >= SEL_RECORD_SIZE ) {
+        rsp->completion_code = IPMI_CC_PARAM_OUT_OF_RANGE;
+        return;
+    }
+
+    /* Only partial reads need a reservation */
+    if ( ( offset != 0 ) && ( reservation != sel_reservation ) ) {
+        rsp->completion_code = IPMI_CC_RES_CANCELED;
+        return;
+    }
+
+    if ( ( count == 0xFF ) || ( offset + count > SEL_RECORD_SIZE ) ) {
+        count = SEL_RECORD_SIZE - offset;
+    }
+
+    if ( ( sel_mutex == NULL ) || ( xSemaphoreTake( sel_mutex, SEL_BUS_TIMEOUT ) != pdTRUE ) ) {
+        rsp->completion_code = IPMI_CC_NODE_BUSY;
+        return;
+    }
+
+    if ( !sel_loaded ) {
+        rsp->completion_code = IPMI_CC_CANT_RESP_BMC_INIT;
+    } else if ( !sel_find( id, &seq ) ) {
+        rsp->completion_code = IPMI_CC_REQ_DATA_NOT_PRESENT;
+    } else if ( ( eeprom_24xx64_read( SEL_EEPROM_ID, sel_slot_addr( seq ), slot, sizeof(slot), SEL_BUS_TIMEOUT ) != sizeof(slot) ) ||
+                !sel_slot_check( slot, &slot_seq ) || ( slot_seq != seq ) ) {
+        rsp->completion_code = IPMI_CC_UNSPECIFIED_ERROR;
+    } else {
+        next_id = ( seq + 1 != sel_next ) ? sel_record_id( seq + 1 ) : SEL_RECORD_ID_LAST;
+
+        rsp->data[len++] = next_id & 0xFF;
+        rsp->data[len++] = next_id >> 8;
+        memcpy( &rsp->data[len], &slot[offset], count );
+        len += count;
+
+        rsp->completion_code = IPMI_CC_OK;
+    }
+
+    xSemaphoreGive( sel_mutex );
+
+    rsp->data_len = len;
+}
@@ -0,0 +1,112 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file   sel.h
+ *
+ * @brief  Persistent System Event Log in a 24xx64 EEPROM
+ *
+ * Every event sent to the MCH is also logged, together with the cause of each reset and the context saved by
+ * the fault handlers. New entries are queued in RAM and written to the EEPROM in batches by a low priority task.
+ *
+ * The log is a ring of #SEL_SLOT_SIZE bytes slots, written in order, so every slot is programmed once per
+ * round of the ring and the oldest entry is the one overwritten. Each slot holds one IPMI SEL record,
+ * the sequence number of the entry and a CRC-16; after a reset the log is found again by looking for the
+ * highest sequence number, and a slot torn by a power loss fails its CRC and is skipped.
+ *
+ * The log is read through the Get SEL Info, Reserve SEL and Get SEL Entry commands. Timestamps are
+ * relative to the MMC start (seconds), since it has no real time clock.
+ */
+
+#ifndef SEL_H_
+#define SEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+
+/**
+ * @brief Size of a SEL record (in bytes)
+ */
+#define SEL_RECORD_SIZE             16
+
+/**
+ * @brief Size of a slot in the EEPROM (in bytes), one EEPROM page
+ */
+#define SEL_SLOT_SIZE               32
+
+/**
+ * @brief Amount of entries that may wait in RAM to be written, newer entries are dropped
+ */
+#define SEL_QUEUE_LEN               16
+
+/**
+ * @brief Time the task waits for more entries before writing a batch (in ticks)
+ */
+#define SEL_FLUSH_DELAY             pdMS_TO_TICKS(1000)
+
+/**
+ * @brief Timeout of the EEPROM accesses (in ticks)
+ */
+#define SEL_BUS_TIMEOUT             pdMS_TO_TICKS(50)
+
+/**
+ * @brief SEL record types
+ */
+enum {
+    SEL_RECORD_SYSTEM_EVENT = 0x02,     /**< Event message, as sent to the MCH */
+    SEL_RECORD_OEM_FAULT = 0xE0,        /**< Fault context: type, PC, LR and PSR (non-timestamped OEM record) */
+};
+
+/**
+ * @brief Creates the SEL task and logs the cause of the last reset
+ *
+ * Must be called after the IPMB address is known, it can be called before the scheduler is started.
+ */
+void sel_init( void );
+
+/**
+ * @brief Adds an event to the log
+ *
+ * Never blocks, so it can be called from any task (but not from interrupts).
+ *
+ * @param event_msg Platform Event Message request data (event message revision, sensor type, sensor number,
+ *                  event direction and type, event data 1 to 3)
+ */
+void sel_add_event( const uint8_t *event_msg );
+
+/**
+ * @brief Writes every queued entry to the EEPROM
+ *
+ * Meant to be called right before a planned reset.
+ *
+ * @param timeout Maximum time to wait for the log and the bus (in ticks)
+ *
+ * @return true if every entry was written
+ */
+bool sel_sync( TickType_t timeout );
+
+/**
+ * @brief SEL task, loads the log and writes the queued entries
+ *
+ * @param Parameters Pointer to parameter list passed to task upon initialization (not used here)
+ */
+void vTaskSEL( void * Parameters );
+
+#endif
@@ -36,58 +36,28 @@
 
 /* Project Includes */
 #include "sdr.h"
-#include "task_priorities.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
 #include "adt7420.h"
 #include "utils.h"
 #include "uart_debug.h"
 
-TaskHandle_t vTaskADT7420_Handle;
-
-void vTaskADT7420( void* Parameters )
+static bool adt7420_read( sensor_t * sensor, uint8_t i2c_interf, uint8_t i2c_addr, uint8_t * raw )
 {
-    const TickType_t xFrequency = ADT7420_UPDATE_RATE;
-
-    uint8_t i2c_addr, i2c_interf;
-    sensor_t * temp_sensor;
-    uint8_t temp[2];
-    uint16_t converted_temp;
-
-    for ( ;; ) {
-        /* Iterate through the SDR Table to find all the LM75 entries */
-
-        for ( temp_sensor = sdr_head; temp_sensor != NULL; temp_sensor = temp_sensor->next) {
-
-            if ( temp_sensor->task_handle == NULL ) {
-                continue;
-            }
+    i2c_xfer_t xfer = { .rx = raw, .rx_len = 2 };
 
-            /* Check if this task should update the selected SDR */
-            if ( *(temp_sensor->task_handle) != xTaskGetCurrentTaskHandle() ) {
-                continue;
-            }
-
-            /* Try to gain the I2C bus */
-            if ( i2c_take_by_chipid( temp_sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY ) == pdTRUE ) {
-
-                /* Update the temperature reading */
-                if (xI2CMasterRead( i2c_interf, i2c_addr, &temp[0], 2) == 2) {
-                    converted_temp = ((temp[0] << 1) | (temp[1] >> 7));
-                    temp_sensor->readout_value = converted_temp;
-                }
-                /* Check for threshold events */
-                sensor_state_check(temp_sensor);
-                check_sensor_event(temp_sensor);
-                i2c_give(i2c_interf);
-            }
-        }
-        vTaskDelay(xFrequency);
-    }
+    return ( i2c_transfer( i2c_interf, i2c_addr, &xfer, 1 ) == 1 );
 }
 
-
-void ADT7420_init( void )
+static void adt7420_convert( sensor_t * sensor, const uint8_t * raw )
 {
-    xTaskCreate( vTaskADT7420, "ADT7420", 200, (void *) NULL, tskADT7420SENSOR_PRIORITY, &vTaskADT7420_Handle);
+    sensor->readout_value = ((raw[0] << 1) | (raw[1] >> 7));
 }
+
+const sensor_driver_ops adt7420_driver = {
+    .name = "ADT7420",
+    .period = pdMS_TO_TICKS(ADT7420_UPDATE_RATE),
+    .uses_bus = true,
+    .read = adt7420_read,
+    .convert = adt7420_convert
+};
@@ -41,27 +41,16 @@
 #ifndef ADT7420_H_
 #define ADT7420_H_
 
+#include "sensor_sched.h"
+
 /**
  * @brief Rate at which the ADT7420 sensors are read (in ms)
  */
 #define ADT7420_UPDATE_RATE        500
 
-extern TaskHandle_t vTaskADT7420_Handle;
-
-/**
- * @brief Initializes ADT7420 monitoring task
- *
- * @return None
- */
-void ADT7420_init( void );
-
 /**
- * @brief Monitoring task for ADT7420 sensor
- *
- * This task unblocks after every #ADT7420_UPDATE_RATE ms and updates the read from all the ADT7420 sensors listed in this module's SDR table
- *
- * @param Parameters Pointer to parameter list passed to task upon initialization (not used here)
+ * @brief ADT7420 driver, polled by the sensor scheduler every #ADT7420_UPDATE_RATE ms
  */
-void vTaskADT7420( void* Parameters );
+extern const sensor_driver_ops adt7420_driver;
 
 #endif
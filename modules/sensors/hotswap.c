@@ -31,10 +31,10 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
+#include "timers.h"
 #include "port.h"
 #include "sdr.h"
 #include "hotswap.h"
-#include "task_priorities.h"
 #include "ipmi.h"
 #include "led.h"
 #include "board_led.h"
@@ -47,7 +47,9 @@
 #include "rtm.h"
 #endif
 
-TaskHandle_t vTaskHotSwap_Handle;
+/* The AMC handle edges are signalled by an interrupt, debounced by a one-shot timer */
+static bool hotswap_irq_mode;
+static TimerHandle_t hotswap_debounce_timer;
 
 static bool hotswap_get_handle_status( uint8_t *state )
 {
@@ -55,6 +57,12 @@ static bool hotswap_get_handle_status( uint8_t *state )
 
     bool pin_read = gpio_read_pin(PIN_PORT(GPIO_HOT_SWAP_HANDLE), PIN_NUMBER(GPIO_HOT_SWAP_HANDLE));
 
+    /* The debounce timer only expires once the handle has been stable for HOTSWAP_DEBOUNCE_TIME */
+    if ( hotswap_irq_mode ) {
+        *state = pin_read;
+        return true;
+    }
+
     falling = (falling << 1) | !pin_read | 0x80;
     rising = (rising << 1) | pin_read | 0x80;
 
@@ -71,23 +79,23 @@ sensor_t * hotswap_amc_sensor;
 SDR_type_02h_t * hotswap_rtm_pSDR;
 sensor_t * hotswap_rtm_sensor;
 
+/* Init old_state with a different value, so that the uC always send its state on startup */
+static uint8_t new_state_amc = 0x01, old_state_amc = 0xFF;
+#ifdef MODULE_RTM
+static uint8_t new_state_rtm = 0x01, old_state_rtm = 0xFF;
+#endif
+
 void hotswap_init( void )
 {
-    /* Create Hot Swap task */
-    xTaskCreate( vTaskHotSwap, "Hot Swap", 150, (void *) NULL, tskHOTSWAP_PRIORITY, &vTaskHotSwap_Handle);
-
     SDR_type_02h_t * hotswap_pSDR;
     sensor_t * hotswap_sensor;
 
     /* Iterate through the SDR Table to find all the Hotswap entries */
-    for ( hotswap_sensor = sdr_head; hotswap_sensor != NULL; hotswap_sensor = hotswap_sensor->next) {
+    for ( uint8_t sdr_idx = 0; sdr_idx < sdr_count; sdr_idx++ ) {
+        hotswap_sensor = sdr_table[sdr_idx];
 
-        if ( hotswap_sensor->task_handle == NULL ) {
-            continue;
-        }
-
-        /* Check if this task should update the selected SDR */
-        if ( *(hotswap_sensor->task_handle) != vTaskHotSwap_Handle ) {
+        /* Check if this driver should update the selected SDR */
+        if ( hotswap_sensor->driver != &hotswap_driver ) {
             continue;
         }
 
@@ -106,99 +114,140 @@ void hotswap_init( void )
     }
 }
 
-void vTaskHotSwap( void *Parameters )
+static void hotswap_handle_edge( uint8_t port, uint8_t pin, BaseType_t *higher_prio_woken )
 {
-    /* Init old_state with a different value, so that the uC always send its state on startup */
-    static uint8_t new_state_amc = 0x01, old_state_amc = 0xFF;
-#ifdef MODULE_RTM
-    static uint8_t new_state_rtm = 0x01, old_state_rtm = 0xFF;
-#endif
+    /* Every edge restarts the debounce time */
+    xTimerResetFromISR( hotswap_debounce_timer, higher_prio_woken );
+}
+
+static void hotswap_debounce_expired( TimerHandle_t timer )
+{
+    sensor_sched_wake( hotswap_amc_sensor );
+}
 
-    TickType_t xLastWakeTime;
-    const TickType_t xFrequency = 50;
+static void hotswap_sensor_init( sensor_t * sensor )
+{
+    if ( sensor != hotswap_amc_sensor ) {
+        return;
+    }
 
     /* Perform hotswap first read */
     while (!hotswap_get_handle_status( &new_state_amc ) );
 
+    /* Switch to edge detection if the handle pin supports it, polling otherwise */
+    hotswap_debounce_timer = xTimerCreate( "HS Debounce", HOTSWAP_DEBOUNCE_TIME, pdFALSE, NULL, hotswap_debounce_expired );
+
+    if ( ( hotswap_debounce_timer != NULL ) &&
+         gpio_int_register( PIN_PORT(GPIO_HOT_SWAP_HANDLE), PIN_NUMBER(GPIO_HOT_SWAP_HANDLE), hotswap_handle_edge ) ) {
+        hotswap_irq_mode = true;
+        sensor_sched_set_period( sensor, SENSOR_SCHED_NO_PERIOD );
+    }
+
     /* Override Blue LED state so that if the handle is closed when the MMC is starting, the LED remains in the correct state */
     if ( new_state_amc == 0 ) {
         LEDUpdate( FRU_AMC, LED_BLUE, LEDMODE_OVERRIDE, LEDINIT_OFF, 0, 0 );
     } else {
         LEDUpdate( FRU_AMC, LED_BLUE, LEDMODE_OVERRIDE, LEDINIT_ON, 0, 0 );
     }
+}
 
-    /* Initialise the xLastWakeTime variable with the current time. */
-    xLastWakeTime = xTaskGetTickCount();
-
-    for ( ;; ) {
-        vTaskDelayUntil( &xLastWakeTime, xFrequency );
+static void hotswap_poll_amc( bool standalone_mode )
+{
+    if (!hotswap_get_handle_status( &new_state_amc )) {
+        return;
+    }
 
-        if (!hotswap_get_handle_status( &new_state_amc )) {
-            continue;
+    if ( new_state_amc ^ old_state_amc ) {
+        if ( new_state_amc == 0 ) {
+            printf("AMC Hotswap handle pressed!\n");
+        } else {
+            printf("AMC Hotswap handle released!\n");
         }
-
-        bool standalone_mode = false;
-        if (get_ipmb_addr() == IPMB_ADDR_DISCONNECTED) {
-            standalone_mode = true;
+        if ( hotswap_send_event( hotswap_amc_sensor, new_state_amc ) == ipmb_error_success ) {
+            hotswap_set_mask_bit( HOTSWAP_AMC, 1 << new_state_amc );
+            hotswap_clear_mask_bit( HOTSWAP_AMC, 1 << (!new_state_amc) );
+            old_state_amc = new_state_amc;
         }
-
-        if ( new_state_amc ^ old_state_amc ) {
-            if ( new_state_amc == 0 ) {
-                printf("AMC Hotswap handle pressed!\n");
-            } else {
-                printf("AMC Hotswap handle released!\n");
-            }
-            if ( hotswap_send_event( hotswap_amc_sensor, new_state_amc ) == ipmb_error_success ) {
-                hotswap_set_mask_bit( HOTSWAP_AMC, 1 << new_state_amc );
-                hotswap_clear_mask_bit( HOTSWAP_AMC, 1 << (!new_state_amc) );
-                old_state_amc = new_state_amc;
-            }
-            if (standalone_mode) {
-                old_state_amc = new_state_amc;
-            }
-        }
-
-#ifdef MODULE_RTM
-        if ( !rtm_present ) {
-            /* Keep this flag in a different state so that when the RTM board connects, we send its hotswap status right after */
-            old_state_rtm = 0xFF;
-            continue;
+        if (standalone_mode) {
+            old_state_amc = new_state_amc;
         }
+    }
 
-        if (!rtm_get_hotswap_handle_status( &new_state_rtm )) {
-            continue;
-        }
+    /* Keep polling until the event is queued (hotswap events stay in the outbox until the MCH gets them), then wait for the next edge */
+    if ( hotswap_irq_mode ) {
+        sensor_sched_set_period( hotswap_amc_sensor, ( new_state_amc == old_state_amc ) ? SENSOR_SCHED_NO_PERIOD : HOTSWAP_POLL_RATE );
+    }
+}
 
-        if ( new_state_rtm ^ old_state_rtm ) {
-            if ( new_state_rtm == 0 ) {
-                printf("RTM Hotswap handle pressed!\n");
+#ifdef MODULE_RTM
+static void hotswap_poll_rtm( bool standalone_mode )
+{
+    if ( !rtm_present ) {
+        /* Keep this flag in a different state so that when the RTM board connects, we send its hotswap status right after */
+        old_state_rtm = 0xFF;
+        return;
+    }
 
-                if (standalone_mode) {
-                    payload_send_message(FRU_RTM, PAYLOAD_MESSAGE_RTM_ENABLE);
-                }
-            } else {
-                printf("RTM Hotswap handle released!\n");
+    if (!rtm_get_hotswap_handle_status( &new_state_rtm )) {
+        return;
+    }
 
-                if (standalone_mode) {
-                     payload_send_message(FRU_RTM, PAYLOAD_MESSAGE_QUIESCE);
-                }
+    if ( new_state_rtm ^ old_state_rtm ) {
+        if ( new_state_rtm == 0 ) {
+            printf("RTM Hotswap handle pressed!\n");
 
+            if (standalone_mode) {
+                payload_send_message(FRU_RTM, PAYLOAD_MESSAGE_RTM_ENABLE);
             }
-            if ( hotswap_send_event( hotswap_rtm_sensor, new_state_rtm ) == ipmb_error_success ) {
-                hotswap_set_mask_bit( HOTSWAP_RTM, 1 << new_state_rtm );
-                hotswap_clear_mask_bit( HOTSWAP_RTM, 1 << (!new_state_rtm) );
-                old_state_rtm = new_state_rtm;
-            }
+        } else {
+            printf("RTM Hotswap handle released!\n");
 
             if (standalone_mode) {
-                old_state_rtm = new_state_rtm;
+                 payload_send_message(FRU_RTM, PAYLOAD_MESSAGE_QUIESCE);
             }
 
         }
+        if ( hotswap_send_event( hotswap_rtm_sensor, new_state_rtm ) == ipmb_error_success ) {
+            hotswap_set_mask_bit( HOTSWAP_RTM, 1 << new_state_rtm );
+            hotswap_clear_mask_bit( HOTSWAP_RTM, 1 << (!new_state_rtm) );
+            old_state_rtm = new_state_rtm;
+        }
+
+        if (standalone_mode) {
+            old_state_rtm = new_state_rtm;
+        }
+
+    }
+}
 #endif
+
+static bool hotswap_poll( sensor_t * sensor, uint8_t i2c_interf, uint8_t i2c_addr, uint8_t * raw )
+{
+    bool standalone_mode = false;
+    if (ipmb_addr == IPMB_ADDR_DISCONNECTED) {
+        standalone_mode = true;
     }
+
+    if ( sensor == hotswap_amc_sensor ) {
+        hotswap_poll_amc( standalone_mode );
+#ifdef MODULE_RTM
+    } else if ( sensor == hotswap_rtm_sensor ) {
+        hotswap_poll_rtm( standalone_mode );
+#endif
+    }
+
+    /* The readout value is kept by the mask bit helpers, there is nothing to convert */
+    return false;
 }
 
+const sensor_driver_ops hotswap_driver = {
+    .name = "Hot Swap",
+    .period = HOTSWAP_POLL_RATE,
+    .uses_bus = false,
+    .init = hotswap_sensor_init,
+    .read = hotswap_poll
+};
+
 ipmb_error hotswap_send_event( sensor_t *sensor, uint8_t evt )
 {
     return ipmi_event_send( sensor, ASSERTION_EVENT, &evt, sizeof( evt ) );
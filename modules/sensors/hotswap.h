@@ -37,12 +37,19 @@
 #define _HOTSWAP_H_
 
 #include "sdr.h"
+#include "sensor_sched.h"
 #ifdef MODULE_RTM
 #include "rtm_user.h"
 #endif
 
 #define DEBOUNCE_TIME 250
 
+/* Handle polling period (in ticks) */
+#define HOTSWAP_POLL_RATE       50
+
+/* Time the AMC handle has to be stable after its last edge before it is read (in ticks) */
+#define HOTSWAP_DEBOUNCE_TIME   pdMS_TO_TICKS(50)
+
 /* Module handle sensor status */
 #define HOTSWAP_STATE_HANDLE_CLOSED             0x00
 #define HOTSWAP_STATE_HANDLE_OPENED             0x01
@@ -69,19 +76,15 @@ enum {
 };
 
 /**
- * @brief Hotswap Task handle
- */
-extern TaskHandle_t vTaskHotSwap_Handle;
-
-/**
- * @brief Periodically reads the Hotswap sensor state and checks if its state has changed
+ * @brief Hotswap driver, debounces the handles and sends their events
  *
- * @param Parameters Pointer to parameter list passed to task upon initialization (not used here)
+ * The AMC handle is read after its edge interrupt has been quiet for #HOTSWAP_DEBOUNCE_TIME when the handle pin can
+ * generate interrupts. Otherwise, and for the RTM handle, the sensor scheduler polls the handles every #HOTSWAP_POLL_RATE ticks.
  */
-void vTaskHotSwap( void *Parameters );
+extern const sensor_driver_ops hotswap_driver;
 
 /**
- * @brief Initializes hotswap sensor informatiosn on SDR and creates #vTaskHotSwap
+ * @brief Finds the AMC and RTM hotswap sensors on the SDR table
  *
  * @return None
  */
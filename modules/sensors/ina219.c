@@ -37,150 +37,105 @@
 /* Project Includes */
 #include "port.h"
 #include "sdr.h"
-#include "task_priorities.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
 #include "ina219.h"
+#include "sensor_sched.h"
 #include "fpga_spi.h"
 #include "fru.h"
 
-TaskHandle_t vTaskINA219_Handle;
-
 static ina219_data_t ina219_data[MAX_INA219_COUNT];
 
-static Bool ina219_readvalue( ina219_data_t * data, uint8_t reg, uint16_t *read) {
-    uint8_t i2c_interf, i2c_addr;
-    uint8_t val[2] = {0};
-
-    /* Try to gain the I2C bus */
-    if (i2c_take_by_chipid(data->sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE) {
-        if (xI2CMasterWriteRead(i2c_interf, i2c_addr, &reg, 1, &val[0], sizeof(val)/sizeof(val[0])) == 2) {
-            *read = (val[0] << 8) | (val[1]);
-        }
-        i2c_give(i2c_interf);
-        return true;
-    }
-
-    return false;
-}
-
-void vTaskINA219(void *Parameters)
+static uint8_t ina219_setup(ina219_data_t * data)
 {
-    TickType_t xLastWakeTime;
-
-    /* Task will run every 100ms */
-    const TickType_t xFrequency = INA219_UPDATE_RATE / portTICK_PERIOD_MS;
-
-    sensor_t * sensor;
-
-    /* Initialise the xLastWakeTime variable with the current time. */
-    xLastWakeTime = xTaskGetTickCount();
-
-    int16_t value;
-    uint8_t i = 0;
-
-    for (;;) {
-
-        /* Read all registers from the INA219s */
-        for ( i = 0; i < MAX_INA219_COUNT; i++) {
-
-            sensor = ina219_data[i].sensor;
-
-            if (sensor == NULL) {
-                continue;
-            }
-
-            switch ((GET_SENSOR_TYPE(sensor))) {
-            case SENSOR_TYPE_VOLTAGE:
-
-                ina219_readvalue(&ina219_data[i], INA219_BUS_VOLTAGE_REG, &ina219_data[i].regs[INA219_BUS_VOLTAGE_REG]);
-                sensor->readout_value = (ina219_data[i].regs[INA219_BUS_VOLTAGE_REG] >> 3) / 16;
-
-                break;
-            case SENSOR_TYPE_CURRENT:
+    uint16_t cal;
 
-                ina219_readvalue(&ina219_data[i], INA219_CURRENT_REG, &ina219_data[i].regs[INA219_CURRENT_REG]);
-                value = (int16_t) (ina219_data[i].regs[INA219_CURRENT_REG] * ina219_data[i].current_lsb * 12.5);
-                sensor->readout_value = value;
+    cal = (uint16_t) (0.04096 / (data->current_lsb * (data->config->shunt_resistor / 1.0e3)));
 
-                break;
-            default:
-                /* Shunt voltage and power not implemented */
-                break;
-            }
+    uint8_t cal_reg[3] = { INA219_CALIBRATION_REG, (cal >> 8), (cal & 0xFF) };
+    uint8_t cfg_reg[3] = { INA219_CONFIGURATION_REG, (data->config->config_reg.cfg_word >> 8), (data->config->config_reg.cfg_word & 0xFF) };
 
-            /* Check for threshold events */
-            sensor_state_check(sensor);
-            check_sensor_event(sensor);
-        }
+    /* Calibration and configuration are written under a single bus take */
+    const i2c_xfer_t xfers[] = {
+        { .tx = cal_reg, .tx_len = sizeof(cal_reg) },
+        { .tx = cfg_reg, .tx_len = sizeof(cfg_reg) },
+    };
 
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+    if (i2c_transfer_by_chipid(data->sensor->chipid, xfers, 2, portMAX_DELAY) != 2) {
+        return -1;
     }
+    return 0;
 }
 
-static uint8_t ina219_calibrate(ina219_data_t * data)
+static uint8_t ina219_sensor_reg(sensor_t * sensor)
 {
-    uint16_t cal;
-    uint8_t i2c_interf, i2c_addr;
-
-    cal = (uint16_t) (0.04096 / (data->current_lsb * (data->config->shunt_resistor / 1.0e3)));
-
-    uint8_t cal_reg[3] = { INA219_CALIBRATION_REG, (cal >> 8), (cal & 0xFF) };
-
-    if (i2c_take_by_chipid(data->sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE) {
-        xI2CMasterWrite(i2c_interf, i2c_addr, cal_reg, sizeof(cal_reg) / sizeof(cal_reg[0]));
-        i2c_give(i2c_interf);
-        return 0;
+    switch ((GET_SENSOR_TYPE(sensor))) {
+    case SENSOR_TYPE_VOLTAGE:
+        return INA219_BUS_VOLTAGE_REG;
+    case SENSOR_TYPE_CURRENT:
+        return INA219_CURRENT_REG;
+    default:
+        /* Shunt voltage and power not implemented */
+        return 0xFF;
     }
-    return -1;
 }
 
-static uint8_t ina219_configure(ina219_data_t * data)
+static void ina219_sensor_init(sensor_t * sensor)
 {
-    uint8_t i2c_interf, i2c_addr;
-    uint8_t cfg_reg[3] = { INA219_CONFIGURATION_REG, (data->config->config_reg.cfg_word >> 8), (data->config->config_reg.cfg_word & 0xFF) };
+    static uint8_t ina219_count;
+    ina219_data_t * data;
 
-    if (i2c_take_by_chipid(data->sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE) {
-        xI2CMasterWrite(i2c_interf, i2c_addr, cfg_reg, sizeof(cfg_reg) / sizeof(cfg_reg[0]));
-        i2c_give(i2c_interf);
-        return 0;
+    if (ina219_count >= MAX_INA219_COUNT) {
+        return;
     }
-    return -1;
-}
 
-void ina219_init(void)
-{
-    sensor_t *sensor;
-    uint8_t i = 0;
+    data = &ina219_data[ina219_count++];
+    data->sensor = sensor;
+    data->config = (ina219_config_t *) sensor->settings;
+    data->current_lsb = ((float) data->config->maximum_expected_current) / (2 << 15);
+    sensor->driver_data = data;
 
-    xTaskCreate(vTaskINA219, "INA219", 200, (void *) NULL, tskINA220SENSOR_PRIORITY, &vTaskINA219_Handle);
+    ina219_setup(data);
 
-    /* Iterate through the SDR Table to find all the INA219 entries */
-    for (sensor = sdr_head; sensor != NULL; sensor = sensor->next) {
+    sensor->signed_flag = 0;
+    if ((GET_SENSOR_TYPE(sensor)) == SENSOR_TYPE_CURRENT) {
+        sensor->signed_flag = 1;
+    }
+}
 
-        if (sensor->task_handle == NULL) {
-            continue;
-        }
+static bool ina219_read(sensor_t * sensor, uint8_t i2c_interf, uint8_t i2c_addr, uint8_t * raw)
+{
+    uint8_t reg = ina219_sensor_reg(sensor);
+    i2c_xfer_t xfer = { .tx = &reg, .tx_len = 1, .rx = raw, .rx_len = 2 };
 
-        /* Check if this task should update the selected SDR */
-        if (*(sensor->task_handle) != vTaskINA219_Handle) {
-            continue;
-        }
+    if ((sensor->driver_data == NULL) || (reg == 0xFF)) {
+        return false;
+    }
 
-        if (i < MAX_INA219_COUNT) {
-            ina219_data[i].sensor = sensor;
-            ina219_data[i].config = (ina219_config_t *) sensor->settings;
-            ina219_data[i].current_lsb = ((float) ina219_data[i].config->maximum_expected_current) / (2 << 15);
+    return (i2c_transfer(i2c_interf, i2c_addr, &xfer, 1) == 1);
+}
 
-            ina219_calibrate(&ina219_data[i]);
-            ina219_configure(&ina219_data[i]);
+static void ina219_convert(sensor_t * sensor, const uint8_t * raw)
+{
+    ina219_data_t * data = sensor->driver_data;
+    uint8_t reg = ina219_sensor_reg(sensor);
+    int16_t value;
 
-            ina219_data[i].sensor->signed_flag = 0;
-            if ((GET_SENSOR_TYPE(ina219_data[i].sensor)) == SENSOR_TYPE_CURRENT) {
-                ina219_data[i].sensor->signed_flag = 1;
-            }
+    data->regs[reg] = (raw[0] << 8) | (raw[1]);
 
-            i++;
-        }
+    if (reg == INA219_BUS_VOLTAGE_REG) {
+        sensor->readout_value = (data->regs[INA219_BUS_VOLTAGE_REG] >> 3) / 16;
+    } else {
+        value = (int16_t) (data->regs[INA219_CURRENT_REG] * data->current_lsb * 12.5);
+        sensor->readout_value = value;
     }
 }
+
+const sensor_driver_ops ina219_driver = {
+    .name = "INA219",
+    .period = pdMS_TO_TICKS(INA219_UPDATE_RATE),
+    .uses_bus = true,
+    .init = ina219_sensor_init,
+    .read = ina219_read,
+    .convert = ina219_convert
+};
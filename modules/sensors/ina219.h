@@ -36,6 +36,7 @@
 #include "FreeRTOS.h"
 #include "ina220.h"
 #include "port.h"
+#include "sensor_sched.h"
 
 #define MAX_INA219_COUNT        12
 
@@ -172,22 +173,9 @@ typedef struct
     uint16_t regs[INA219_REGISTERS];
 } ina219_data_t;
 
-extern TaskHandle_t vTaskINA219_Handle;
-
 /**
- * @brief Initializes INA219 monitoring task
- *
- * @return None
- */
-void ina219_init(void);
-
-/**
- * @brief Monitoring task for INA219 sensor
- *
- * This task unblocks after every #INA219_UPDATE_RATE ms and updates the read from all the INA219 sensors listed in this module's SDR table
- *
- * @param Parameters Pointer to parameter list passed to task upon initialization (not used here)
+ * @brief INA219 driver, polled by the sensor scheduler every #INA219_UPDATE_RATE ms
  */
-void vTaskINA219(void* Parameters);
+extern const sensor_driver_ops ina219_driver;
 
 #endif
@@ -35,15 +35,13 @@
 /* Project Includes */
 #include "port.h"
 #include "sdr.h"
-#include "task_priorities.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
 #include "ina220.h"
+#include "sensor_sched.h"
 #include "fpga_spi.h"
 #include "fru.h"
 
-TaskHandle_t vTaskINA220_Handle;
-
 const ina220_config_t ina220_cfg = {
     .config_reg_default.cfg_struct = { .bus_voltage_range = INA220_16V_SCALE_RANGE,
                                        .pga_gain = INA220_PGA_GAIN_40MV,
@@ -61,59 +59,80 @@ const ina220_config_t ina220_cfg = {
 
 static ina220_data_t ina220_data[MAX_INA220_COUNT];
 
-void vTaskINA220( void *Parameters )
+static uint8_t ina220_sensor_reg( sensor_t * sensor )
 {
-    uint8_t i;
-    TickType_t xLastWakeTime;
-    /* Task will run every 100ms */
-    const TickType_t xFrequency = INA220_UPDATE_RATE / portTICK_PERIOD_MS;
-
-    sensor_t * ina220_sensor;
-    ina220_data_t * data_ptr;
-
-    /* Initialise the xLastWakeTime variable with the current time. */
-    xLastWakeTime = xTaskGetTickCount();
-
-    for (;;) {
-        /* Read all registers from the INA220s */
-        for ( i = 0; i < MAX_INA220_COUNT; i++) {
-            // ina220_readall( &ina220_data[i] );
-
-            ina220_sensor = ina220_data[i].sensor;
-            data_ptr = &ina220_data[i];
-
-            if (ina220_sensor == NULL) {
-                continue;
-            }
-
-            switch ((GET_SENSOR_TYPE(ina220_sensor))) {
-            case SENSOR_TYPE_VOLTAGE:
-                ina220_readvalue(&ina220_data[i], INA220_BUS_VOLTAGE, &ina220_data[i].regs[INA220_BUS_VOLTAGE]);
-                ina220_sensor->readout_value = (data_ptr->regs[INA220_BUS_VOLTAGE] >> data_ptr->config->bus_voltage_shift)/16;
-                break;
-            case SENSOR_TYPE_CURRENT:
-                ina220_readvalue(&ina220_data[i], INA220_CURRENT, &ina220_data[i].regs[INA220_CURRENT]);
-                /* Current in mA */
-                ina220_sensor->readout_value = data_ptr->regs[INA220_CURRENT]/32;
-                break;
-            default:
-                /* Shunt voltage and power not implemented */
-                break;
-            }
-
-            /* Check for threshold events */
-            sensor_state_check(ina220_sensor);
-            check_sensor_event(ina220_sensor);
-
-        }
-        vTaskDelayUntil( &xLastWakeTime, xFrequency );
+    switch ((GET_SENSOR_TYPE(sensor))) {
+    case SENSOR_TYPE_VOLTAGE:
+        return INA220_BUS_VOLTAGE;
+    case SENSOR_TYPE_CURRENT:
+        return INA220_CURRENT;
+    default:
+        /* Shunt voltage and power not implemented */
+        return 0xFF;
     }
 }
 
-uint8_t ina220_config( ina220_data_t * data )
+static void ina220_sensor_init( sensor_t * sensor )
+{
+    static uint8_t ina220_count;
+    ina220_data_t * data;
+
+    if ( ina220_count >= MAX_INA220_COUNT ) {
+        return;
+    }
+
+    data = &ina220_data[ina220_count++];
+    data->sensor = sensor;
+    data->rshunt = 0;
+    sensor->driver_data = data;
+
+    /* Writes both the configuration and the calibration registers */
+    ina220_config( data );
+
+    sensor->signed_flag = 0;
+    if ((GET_SENSOR_TYPE(sensor)) == SENSOR_TYPE_CURRENT ) {
+        sensor->signed_flag = 1;
+    }
+}
+
+static bool ina220_sched_read( sensor_t * sensor, uint8_t i2c_interf, uint8_t i2c_addr, uint8_t * raw )
 {
-    uint8_t i2c_interf, i2c_addr;
+    uint8_t reg = ina220_sensor_reg( sensor );
+    i2c_xfer_t xfer = { .tx = &reg, .tx_len = 1, .rx = raw, .rx_len = 2 };
+
+    if ( ( sensor->driver_data == NULL ) || ( reg == 0xFF ) ) {
+        return false;
+    }
+
+    return ( i2c_transfer( i2c_interf, i2c_addr, &xfer, 1 ) == 1 );
+}
+
+static void ina220_convert( sensor_t * sensor, const uint8_t * raw )
+{
+    ina220_data_t * data_ptr = sensor->driver_data;
+    uint8_t reg = ina220_sensor_reg( sensor );
+
+    data_ptr->regs[reg] = (raw[0] << 8) | (raw[1]);
+
+    if ( reg == INA220_BUS_VOLTAGE ) {
+        sensor->readout_value = (data_ptr->regs[INA220_BUS_VOLTAGE] >> data_ptr->config->bus_voltage_shift)/16;
+    } else {
+        /* Current in mA */
+        sensor->readout_value = data_ptr->regs[INA220_CURRENT]/32;
+    }
+}
 
+const sensor_driver_ops ina220_driver = {
+    .name = "INA220",
+    .period = pdMS_TO_TICKS(INA220_UPDATE_RATE),
+    .uses_bus = true,
+    .init = ina220_sensor_init,
+    .read = ina220_sched_read,
+    .convert = ina220_convert
+};
+
+uint8_t ina220_config( ina220_data_t * data )
+{
     data->config = &ina220_cfg;
 
     if ((data->rshunt == 0) || (data->rshunt > data->config->calibration_factor)) {
@@ -123,91 +142,58 @@ uint8_t ina220_config( ina220_data_t * data )
     }
     data->curr_reg_config = data->config->config_reg_default;
 
-    if( i2c_take_by_chipid( data->sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE ) {
-
-        uint8_t cfg_buff[3] = { INA220_CONFIG, ( data->curr_reg_config.cfg_word >> 8) , ( data->curr_reg_config.cfg_word & 0xFFFF) };
+    uint16_t cal = data->config->calibration_reg;
+    uint8_t cfg_buff[3] = { INA220_CONFIG, ( data->curr_reg_config.cfg_word >> 8) , ( data->curr_reg_config.cfg_word & 0xFF) };
+    uint8_t cal_buff[3] = { INA220_CALIBRATION, (cal >> 8), (cal & 0xFF) };
 
-        xI2CMasterWrite( i2c_interf, i2c_addr, cfg_buff, sizeof(cfg_buff)/sizeof(cfg_buff[0]) );
+    const i2c_xfer_t xfers[] = {
+        { .tx = cfg_buff, .tx_len = sizeof(cfg_buff) },
+        { .tx = cal_buff, .tx_len = sizeof(cal_buff) },
+    };
 
-        i2c_give( i2c_interf );
-        return 0;
+    if ( i2c_transfer_by_chipid( data->sensor->chipid, xfers, 2, portMAX_DELAY ) != 2 ) {
+        return -1;
     }
-    return -1;
+    return 0;
 }
 
 Bool ina220_readvalue( ina220_data_t * data, uint8_t reg, uint16_t *read )
 {
-    uint8_t i2c_interf, i2c_addr;
     uint8_t val[2] = {0};
+    i2c_xfer_t xfer = { .tx = &reg, .tx_len = 1, .rx = val, .rx_len = sizeof(val) };
 
-    if( i2c_take_by_chipid( data->sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE ) {
-
-        xI2CMasterWriteRead( i2c_interf, i2c_addr, &reg, 1, &val[0], sizeof(val)/sizeof(val[0]) );
-
-        i2c_give( i2c_interf );
-
-        *read = (val[0] << 8) | (val[1]);
-        return true;
+    if ( i2c_transfer_by_chipid( data->sensor->chipid, &xfer, 1, portMAX_DELAY ) != 1 ) {
+        return false;
     }
 
-    return false;
+    *read = (val[0] << 8) | (val[1]);
+    return true;
 }
 
 void ina220_readall( ina220_data_t * data )
 {
-    /* Read all INA220 Registers */
+    static const uint8_t regs[INA220_REGISTERS] = { 0, 1, 2, 3, 4, 5 };
+    uint8_t val[INA220_REGISTERS][2] = {{0}};
+    i2c_xfer_t xfers[INA220_REGISTERS];
+    uint8_t done;
+
+    /* Read all INA220 Registers under a single bus take */
     for ( uint8_t i = 0; i < INA220_REGISTERS; i++ ) {
-        ina220_readvalue( data, i, &(data->regs[i]) );
+        xfers[i] = (i2c_xfer_t) { .tx = &regs[i], .tx_len = 1, .rx = val[i], .rx_len = 2 };
     }
-}
-
-Bool ina220_calibrate( ina220_data_t * data )
-{
-    uint8_t i2c_interf, i2c_addr;
-    uint16_t cal = data->config->calibration_reg;
-    uint8_t cal_reg[3] = { INA220_CALIBRATION, (cal >> 8), (cal & 0xFFFF) };
-
-    if( i2c_take_by_chipid( data->sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE ) {
 
-        xI2CMasterWrite( i2c_interf, i2c_addr, &cal_reg[0], sizeof(cal_reg)/sizeof(cal_reg[0]) );
+    done = i2c_transfer_by_chipid( data->sensor->chipid, xfers, INA220_REGISTERS, portMAX_DELAY );
 
-        i2c_give( i2c_interf );
-        return true;
+    for ( uint8_t i = 0; i < done; i++ ) {
+        data->regs[i] = (val[i][0] << 8) | (val[i][1]);
     }
-
-    return false;
 }
 
-void ina220_init( void )
+Bool ina220_calibrate( ina220_data_t * data )
 {
-    sensor_t *temp_sensor;
-    uint8_t i = 0;
-
-    xTaskCreate( vTaskINA220, "INA220", 200, (void *) NULL, tskINA220SENSOR_PRIORITY, &vTaskINA220_Handle);
-
-    /* Iterate through the SDR Table to find all the INA220 entries */
-    for ( temp_sensor = sdr_head; temp_sensor != NULL; temp_sensor = temp_sensor->next) {
-
-        if ( temp_sensor->task_handle == NULL ) {
-            continue;
-        }
-
-        /* Check if this task should update the selected SDR */
-        if ( *(temp_sensor->task_handle) != vTaskINA220_Handle ) {
-            continue;
-        }
-
-        if (i < MAX_INA220_COUNT ) {
-            ina220_data[i].sensor = temp_sensor;
-            ina220_data[i].rshunt = 0;
-            ina220_config( &ina220_data[i] );
-            ina220_calibrate( &ina220_data[i] );
-            ina220_data[i].sensor->signed_flag = 0;
-
-            if ((GET_SENSOR_TYPE(ina220_data[i].sensor)) == SENSOR_TYPE_CURRENT ) {
-                ina220_data[i].sensor->signed_flag = 1;
-            }
-            i++;
-        }
-    }
+    uint16_t cal = data->config->calibration_reg;
+    uint8_t cal_reg[3] = { INA220_CALIBRATION, (cal >> 8), (cal & 0xFF) };
+    i2c_xfer_t xfer = { .tx = cal_reg, .tx_len = sizeof(cal_reg) };
+
+    return ( i2c_transfer_by_chipid( data->sensor->chipid, &xfer, 1, portMAX_DELAY ) == 1 );
 }
@@ -43,6 +43,7 @@
 #include "FreeRTOS.h"
 #include "port.h"
 #include "sdr.h"
+#include "sensor_sched.h"
 
 #define MAX_INA220_COUNT        12
 #define INA220_UPDATE_RATE      100
@@ -196,13 +197,14 @@ typedef struct {
     uint16_t regs[INA220_REGISTERS];
 } ina220_data_t;
 
-extern TaskHandle_t vTaskINA220_Handle;
+/**
+ * @brief INA220 driver, polled by the sensor scheduler every #INA220_UPDATE_RATE ms
+ */
+extern const sensor_driver_ops ina220_driver;
 
 uint8_t ina220_config( ina220_data_t * data );
 Bool ina220_calibrate( ina220_data_t * data );
 Bool ina220_readvalue( ina220_data_t * data, uint8_t reg, uint16_t *read );
 void ina220_readall( ina220_data_t * data );
-void ina220_init( void );
-void vTaskINA220( void* Parameters );
 
 #endif
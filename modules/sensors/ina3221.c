@@ -34,154 +34,69 @@
 /* Project Includes */
 #include "port.h"
 #include "sdr.h"
-#include "task_priorities.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
 #include "fpga_spi.h"
 #include "fru.h"
 #include "ina3221.h"
+#include "sensor_sched.h"
 
-TaskHandle_t vTaskINA3221_Handle;
-
-static ina3221_data_t ina3221_data[MAX_INA3221_COUNT];
-
-void vTaskINA3221( void *Parameters )
+static uint8_t ina3221_sensor_reg( sensor_t * sensor )
 {
-    uint8_t chip_num;
-    uint8_t channel;
-    TickType_t xLastWakeTime;
-    /* Task will run every 100ms */
-    const TickType_t xFrequency = pdMS_TO_TICKS(INA3221_UPDATE_RATE);
-
-    sensor_t * ina3221_sensor;
-    ina3221_data_t * data_ptr;
-    SDR_type_01h_t * sdr;
-
-    /* Initialise the xLastWakeTime variable with the current time. */
-    xLastWakeTime = xTaskGetTickCount();
-
-    for (;;) {
-        /* Read all registers from the INA3221s */
-        for ( chip_num = 0; chip_num < MAX_INA3221_COUNT; chip_num++) {
-
-            if (!(ina3221_data[chip_num].chipid)){
-                break;
-            }
-
-            if (!(ina3221_read_voltages( &ina3221_data[chip_num] ))) {
-            	break;
-            }
-
-            for ( uint8_t i = 0; i < 6; i++ ) {
-
-                ina3221_sensor = ina3221_data[chip_num].sensors[i];
-                data_ptr = &ina3221_data[chip_num];
-
-                if (ina3221_sensor == NULL) {
-                    continue;
-                }
-
-                sdr = (SDR_type_01h_t*)ina3221_sensor->sdr;
-                channel = sdr->OEM;
-
-                switch ((GET_SENSOR_TYPE(ina3221_sensor))) {
-                case SENSOR_TYPE_VOLTAGE:
-                    ina3221_sensor->readout_value = data_ptr->regs[2 * channel + 1] >> 6;
-                    break;
-                case SENSOR_TYPE_CURRENT:
-                    ina3221_sensor->readout_value = (((data_ptr->regs[2 * channel] >> 3) * 40) / ina3221_data[chip_num].config->shunt_resistor[channel]) >> 5;
-                    break;
-                default:
-                    break;
-                }
-
-                /* Check for threshold events */
-                sensor_state_check(ina3221_sensor);
-                check_sensor_event(ina3221_sensor);
-            }
-
-        }
-        vTaskDelayUntil( &xLastWakeTime, xFrequency );
+    uint8_t channel = ((SDR_type_01h_t *) sensor->sdr)->OEM;
+
+    switch ((GET_SENSOR_TYPE(sensor))) {
+    case SENSOR_TYPE_VOLTAGE:
+        return INA3221_BUS_VOLTAGE + 2 * channel;
+    case SENSOR_TYPE_CURRENT:
+        return INA3221_SHUNT_VOLTAGE + 2 * channel;
+    default:
+        return 0xFF;
     }
 }
 
-uint8_t ina3221_read_reg( ina3221_data_t * data, uint8_t reg, uint16_t *read )
+static void ina3221_sensor_init( sensor_t * sensor )
 {
-    uint8_t i2c_interf, i2c_addr;
-    uint8_t val[2] = {0};
-    uint8_t rx_len = 0;
-
-    if( i2c_take_by_chipid( data->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE ) {
-
-        rx_len = xI2CMasterWriteRead( i2c_interf, i2c_addr, &reg, 1, &val[0], sizeof(val)/sizeof(val[0]) );
-
-        i2c_give( i2c_interf );
-
-        *read = (val[0] << 8) | (val[1]);
-    }
-
-    return rx_len;
+    sensor->signed_flag = ((GET_SENSOR_TYPE(sensor)) == SENSOR_TYPE_CURRENT );
 }
 
-uint8_t ina3221_read_voltages( ina3221_data_t * data )
+static bool ina3221_read( sensor_t * sensor, uint8_t i2c_interf, uint8_t i2c_addr, uint8_t * raw )
 {
-	uint8_t ret = 0xFF;
-    /* Read INA3221 Bus Voltage and Shunt Voltage Registers */
-    for ( uint8_t i = 0; i < INA3221_VOLTAGE_REGISTERS; i++ ) {
-        ret &= ina3221_read_reg(data, i + 1, &(data->regs[i]) );
+    uint8_t reg = ina3221_sensor_reg( sensor );
+    i2c_xfer_t xfer = { .tx = &reg, .tx_len = 1, .rx = raw, .rx_len = 2 };
+
+    if ( reg == 0xFF ) {
+        return false;
     }
-    return ret;
-}
 
+    return ( i2c_transfer( i2c_interf, i2c_addr, &xfer, 1 ) == 1 );
+}
 
-void ina3221_init( void )
+static void ina3221_convert( sensor_t * sensor, const uint8_t * raw )
 {
-    sensor_t *tmp_sensor;
-    SDR_type_01h_t* sdr;
-    uint8_t ina_channel_num;
-    uint8_t chip_num;
-    uint8_t sens_num;
-    uint8_t signed_flag;
-
-    xTaskCreate( vTaskINA3221, "INA3221", 200, (void *) NULL, tskINA3221SENSOR_PRIORITY, &vTaskINA3221_Handle);
-
-    /* Iterate through the SDR Table to find all the INA3221 entries */
-    for ( tmp_sensor = sdr_head; tmp_sensor != NULL; tmp_sensor = tmp_sensor->next) {
-
-        if ( tmp_sensor->task_handle == NULL ) {
-            continue;
-        }
-
-        /* Check if this task should update the selected SDR */
-        if ( *(tmp_sensor->task_handle) != vTaskINA3221_Handle ) {
-            continue;
-        }
-
-        sdr = (SDR_type_01h_t*)tmp_sensor->sdr;
-        ina_channel_num = sdr->OEM;
-
-        for (chip_num = 0; chip_num < MAX_INA3221_COUNT; chip_num++) {
-
-            if (tmp_sensor->chipid == ina3221_data[chip_num].chipid
-                    || !(ina3221_data[chip_num].chipid)) {
-
-                if ((GET_SENSOR_TYPE(tmp_sensor)) == SENSOR_TYPE_VOLTAGE ) {
-                    signed_flag = 0;
-                    sens_num = ina_channel_num;
-                } else if ((GET_SENSOR_TYPE(tmp_sensor)) == SENSOR_TYPE_CURRENT ) {
-                    signed_flag = 1;
-                    sens_num = ina_channel_num + 3;
-                } else {
-                    break;
-                }
-
-                ina3221_data[chip_num].chipid = tmp_sensor->chipid;
-                ina3221_data[chip_num].config = (ina3221_config_t *) tmp_sensor->settings;
-                ina3221_data[chip_num].sensors[sens_num] = tmp_sensor;
-                ina3221_data[chip_num].sensors[sens_num]->signed_flag = signed_flag;
-
-                break;
-            }
+    const ina3221_config_t * config = (const ina3221_config_t *) sensor->settings;
+    uint8_t channel = ((SDR_type_01h_t *) sensor->sdr)->OEM;
+    uint16_t reg = (raw[0] << 8) | (raw[1]);
+
+    switch ((GET_SENSOR_TYPE(sensor))) {
+    case SENSOR_TYPE_VOLTAGE:
+        sensor->readout_value = reg >> 6;
+        break;
+    case SENSOR_TYPE_CURRENT:
+        if ( config != NULL ) {
+            sensor->readout_value = (((reg >> 3) * 40) / config->shunt_resistor[channel]) >> 5;
         }
+        break;
+    default:
+        break;
     }
 }
+
+const sensor_driver_ops ina3221_driver = {
+    .name = "INA3221",
+    .period = pdMS_TO_TICKS(INA3221_UPDATE_RATE),
+    .uses_bus = true,
+    .init = ina3221_sensor_init,
+    .read = ina3221_read,
+    .convert = ina3221_convert
+};
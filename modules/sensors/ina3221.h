@@ -40,6 +40,7 @@
 
 #include "FreeRTOS.h"
 #include "port.h"
+#include "sensor_sched.h"
 
 #define MAX_INA3221_COUNT        6
 #define INA3221_UPDATE_RATE      100
@@ -114,20 +115,11 @@ typedef struct {
     uint16_t shunt_resistor[3]; /* mOhm */
 } ina3221_config_t;
 
-typedef struct {
-    uint8_t chipid;
-    sensor_t * sensors[6];
-    const ina3221_config_t * config;
-    uint32_t rshunt;
-    ina3221_config_reg_t curr_reg_config;
-    uint16_t regs[INA3221_VOLTAGE_REGISTERS];
-} ina3221_data_t;
-
-extern TaskHandle_t vTaskINA3221_Handle;
-
-uint8_t ina3221_read_reg( ina3221_data_t * data, uint8_t reg, uint16_t *read );
-uint8_t ina3221_read_voltages( ina3221_data_t * data );
-void ina3221_init( void );
-void vTaskINA3221( void* Parameters );
+/**
+ * @brief INA3221 driver, polled by the sensor scheduler every #INA3221_UPDATE_RATE ms
+ *
+ * The SDR OEM field selects the chip channel and the settings (see sdr_add_settings()) point to a #ina3221_config_t
+ */
+extern const sensor_driver_ops ina3221_driver;
 
 #endif
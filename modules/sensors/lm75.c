@@ -35,58 +35,29 @@
 
 /* Project Includes */
 #include "sdr.h"
-#include "task_priorities.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
 #include "lm75.h"
+#include "sensor_sched.h"
 #include "utils.h"
 #include "uart_debug.h"
 
-TaskHandle_t vTaskLM75_Handle;
-
-void vTaskLM75( void* Parameters )
+static bool lm75_read( sensor_t * sensor, uint8_t i2c_interf, uint8_t i2c_addr, uint8_t * raw )
 {
-    const TickType_t xFrequency = pdMS_TO_TICKS(LM75_UPDATE_RATE);
-
-    uint8_t i2c_addr, i2c_interf;
-    sensor_t * temp_sensor;
-    uint8_t temp[2];
-    uint16_t converted_temp;
-
-    for ( ;; ) {
-        /* Iterate through the SDR Table to find all the LM75 entries */
-
-        for ( temp_sensor = sdr_head; temp_sensor != NULL; temp_sensor = temp_sensor->next) {
-
-            if ( temp_sensor->task_handle == NULL ) {
-                continue;
-            }
+    i2c_xfer_t xfer = { .rx = raw, .rx_len = 2 };
 
-            /* Check if this task should update the selected SDR */
-            if ( *(temp_sensor->task_handle) != xTaskGetCurrentTaskHandle() ) {
-                continue;
-            }
-
-            /* Try to gain the I2C bus */
-            if ( i2c_take_by_chipid( temp_sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY ) == pdTRUE ) {
-
-                /* Update the temperature reading */
-                if (xI2CMasterRead( i2c_interf, i2c_addr, &temp[0], 2) == 2) {
-                    converted_temp = ((temp[0] << 1) | ((temp[1]>>7)));
-                    temp_sensor->readout_value = converted_temp;
-                }
-                /* Check for threshold events */
-                i2c_give(i2c_interf);
-                sensor_state_check(temp_sensor);
-                check_sensor_event(temp_sensor);
-            }
-        }
-        vTaskDelay(xFrequency);
-    }
+    return ( i2c_transfer( i2c_interf, i2c_addr, &xfer, 1 ) == 1 );
 }
 
-
-void LM75_init( void )
+static void lm75_convert( sensor_t * sensor, const uint8_t * raw )
 {
-    xTaskCreate( vTaskLM75, "LM75", 200, (void *) NULL, tskLM75SENSOR_PRIORITY, &vTaskLM75_Handle);
+    sensor->readout_value = ((raw[0] << 1) | ((raw[1]>>7)));
 }
+
+const sensor_driver_ops lm75_driver = {
+    .name = "LM75",
+    .period = pdMS_TO_TICKS(LM75_UPDATE_RATE),
+    .uses_bus = true,
+    .read = lm75_read,
+    .convert = lm75_convert
+};
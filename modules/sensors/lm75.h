@@ -41,32 +41,21 @@
 #ifndef LM75_H_
 #define LM75_H_
 
+#include "sensor_sched.h"
+
 /**
  * @brief Rate at which the LM75 sensors are read (in ms)
  */
 #define LM75_UPDATE_RATE        500
 
-extern TaskHandle_t vTaskLM75_Handle;
+/**
+ * @brief LM75 driver, polled by the sensor scheduler every #LM75_UPDATE_RATE ms
+ */
+extern const sensor_driver_ops lm75_driver;
 
 extern const SDR_type_01h_t SDR_LM75_uC;
 extern const SDR_type_01h_t SDR_LM75_ADN4604;
 extern const SDR_type_01h_t SDR_LM75_DCDC;
 extern const SDR_type_01h_t SDR_LM75_RAM;
 
-/**
- * @brief Initializes LM75 monitoring task
- *
- * @return None
- */
-void LM75_init( void );
-
-/**
- * @brief Monitoring task for LM75 sensor
- *
- * This task unblocks after every #LM75_UPDATE_RATE ms and updates the read from all the LM75 sensors listed in this module's SDR table
- *
- * @param Parameters Pointer to parameter list passed to task upon initialization (not used here)
- */
-void vTaskLM75( void* Parameters );
-
 #endif
@@ -34,184 +34,101 @@
 
 /* Project Includes */
 #include "sdr.h"
-#include "task_priorities.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
 #include "max6642.h"
 #include "utils.h"
 #include "uart_debug.h"
 
-TaskHandle_t vTaskMAX6642_Handle;
-
-void vTaskMAX6642( void* Parameters )
+static bool max6642_sched_read( sensor_t * sensor, uint8_t i2c_interf, uint8_t i2c_addr, uint8_t * raw )
 {
-    const TickType_t xFrequency = pdMS_TO_TICKS(MAX6642_UPDATE_RATE);
-
-    sensor_t * temp_sensor;
-
-    for ( ;; ) {
-        /* Iterate through the SDR Table to find all the LM75 entries */
+    const uint8_t cmd = MAX6642_CMD_READ_REMOTE;
+    i2c_xfer_t xfer = { .tx = &cmd, .tx_len = 1, .rx = raw, .rx_len = 1 };
 
-        for ( temp_sensor = sdr_head; temp_sensor != NULL; temp_sensor = temp_sensor->next ) {
+    return ( i2c_transfer( i2c_interf, i2c_addr, &xfer, 1 ) == 1 );
+}
 
-            if ( temp_sensor->task_handle == NULL ) {
-                continue;
-            }
+static void max6642_convert( sensor_t * sensor, const uint8_t * raw )
+{
+    sensor->readout_value = raw[0];
+}
 
-            /* Check if this task should update the selected SDR */
-            if ( *(temp_sensor->task_handle) != xTaskGetCurrentTaskHandle() ) {
-                continue;
-            }
+const sensor_driver_ops max6642_driver = {
+    .name = "MAX6642",
+    .period = pdMS_TO_TICKS(MAX6642_UPDATE_RATE),
+    .uses_bus = true,
+    .read = max6642_sched_read,
+    .convert = max6642_convert
+};
 
-            /* Update the temperature reading */
-            max6642_read_remote( temp_sensor, (uint8_t *) &(temp_sensor->readout_value) );
+/**
+ * @brief Sends a command byte and reads its one byte answer
+ */
+static Bool max6642_read_cmd( sensor_t *sensor, uint8_t cmd, uint8_t *value )
+{
+    i2c_xfer_t xfer = { .tx = &cmd, .tx_len = 1, .rx = value, .rx_len = 1 };
 
-            /* Check for threshold events */
-            sensor_state_check(temp_sensor);
-            check_sensor_event(temp_sensor);
-        }
-        vTaskDelay(xFrequency);
-    }
+    return ( i2c_transfer_by_chipid( sensor->chipid, &xfer, 1, portMAX_DELAY ) == 1 );
 }
 
-void MAX6642_init( void )
+/**
+ * @brief Writes a command byte followed by its argument
+ */
+static void max6642_write_cmd( sensor_t *sensor, uint8_t cmd, uint8_t value )
 {
-    xTaskCreate( vTaskMAX6642, "MAX6642", 200, (void *) NULL, tskMAX6642SENSOR_PRIORITY, &vTaskMAX6642_Handle );
+    uint8_t msg[2] = { cmd, value };
+    i2c_xfer_t xfer = { .tx = msg, .tx_len = sizeof(msg) };
+
+    i2c_transfer_by_chipid( sensor->chipid, &xfer, 1, portMAX_DELAY );
 }
 
 Bool max6642_read_local( sensor_t *sensor, uint8_t *temp )
 {
-    uint8_t i2c_interf, i2c_addr;
-    uint8_t read = 0;
-    const uint8_t cmd = MAX6642_CMD_READ_LOCAL;
-    if ( i2c_take_by_chipid( sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY ) == pdTRUE ) {
-
-        xI2CMasterWriteRead( i2c_interf, i2c_addr, &cmd, 1, &read, 1 );
-        i2c_give( i2c_interf );
-
-        *temp = read;
-        return true;
-    }
-
-    return false;
+    return max6642_read_cmd( sensor, MAX6642_CMD_READ_LOCAL, temp );
 }
 
 Bool max6642_read_remote( sensor_t *sensor, uint8_t *temp )
 {
-    uint8_t i2c_interf, i2c_addr;
-    uint8_t read = 0;
-    const uint8_t cmd = MAX6642_CMD_READ_REMOTE;
-
-    if ( i2c_take_by_chipid( sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY ) == pdTRUE ) {
-
-        xI2CMasterWriteRead( i2c_interf, i2c_addr, &cmd, 1, &read, 1 );
-        i2c_give( i2c_interf );
-
-        *temp = read;
-        return true;
-    }
-
-    return false;
+    return max6642_read_cmd( sensor, MAX6642_CMD_READ_REMOTE, temp );
 }
 
 Bool max6642_read_local_extd( sensor_t *sensor, uint8_t *temp )
 {
-    uint8_t i2c_interf, i2c_addr;
-    uint8_t read = 0;
-    const uint8_t cmd = MAX6642_CMD_READ_LOCAL_EXTD;
-
-    if ( i2c_take_by_chipid( sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY ) == pdTRUE ) {
-
-        xI2CMasterWriteRead( i2c_interf, i2c_addr, &cmd, 1, &read, 1 );
-        i2c_give( i2c_interf );
-
-        *temp = read;
-        return true;
-    }
-
-    return false;
+    return max6642_read_cmd( sensor, MAX6642_CMD_READ_LOCAL_EXTD, temp );
 }
 
 Bool max6642_read_remote_extd( sensor_t *sensor, uint8_t *temp )
 {
-    uint8_t i2c_interf, i2c_addr;
-    uint8_t read = 0;
-    const uint8_t cmd = MAX6642_CMD_READ_REMOTE_EXTD;
-
-    if ( i2c_take_by_chipid( sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY ) == pdTRUE ) {
-
-        xI2CMasterWriteRead( i2c_interf, i2c_addr, &cmd, 1, &read, 1 );
-        i2c_give( i2c_interf );
-
-        *temp = read;
-        return true;
-    }
-
-    return false;
+    return max6642_read_cmd( sensor, MAX6642_CMD_READ_REMOTE_EXTD, temp );
 }
 
 uint8_t max6642_read_status( sensor_t *sensor )
 {
-    uint8_t i2c_interf, i2c_addr;
     uint8_t stat = 0;
-    const uint8_t cmd = MAX6642_CMD_READ_STATUS;
-
-    if ( i2c_take_by_chipid( sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY ) == pdTRUE ) {
-
-        xI2CMasterWriteRead( i2c_interf, i2c_addr, &cmd, 1, &stat, 1 );
-        i2c_give( i2c_interf );
-    }
 
+    max6642_read_cmd( sensor, MAX6642_CMD_READ_STATUS, &stat );
     return stat;
 }
 
 uint8_t max6642_read_cfg( sensor_t *sensor )
 {
-    uint8_t i2c_interf, i2c_addr;
     uint8_t cfg = 0;
-    const uint8_t cmd = MAX6642_CMD_READ_CONFIG;
-
-    if ( i2c_take_by_chipid( sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE ) {
-
-        xI2CMasterWriteRead( i2c_interf, i2c_addr, &cmd, 1, &cfg, 1 );
-        i2c_give( i2c_interf );
-    }
 
+    max6642_read_cmd( sensor, MAX6642_CMD_READ_CONFIG, &cfg );
     return cfg;
 }
 
 void max6642_write_cfg( sensor_t *sensor, uint8_t cfg )
 {
-    uint8_t i2c_interf, i2c_addr;
-    uint8_t msg[2] = { MAX6642_CMD_WRITE_CONFIG, cfg };
-
-    if ( i2c_take_by_chipid( sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE ) {
-
-        xI2CMasterWrite( i2c_interf, i2c_addr, &msg[0], 2);
-        i2c_give( i2c_interf );
-    }
+    max6642_write_cmd( sensor, MAX6642_CMD_WRITE_CONFIG, cfg );
 }
 
 void max6642_write_local_limit( sensor_t *sensor, uint8_t limit )
 {
-    uint8_t i2c_interf, i2c_addr;
-    uint8_t msg[2] = { MAX6642_CMD_WRITE_LOCAL_LIMIT, limit };
-
-    if ( i2c_take_by_chipid( sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE ) {
-
-        xI2CMasterWrite( i2c_interf, i2c_addr, &msg[0], 2);
-        i2c_give( i2c_interf );
-    }
+    max6642_write_cmd( sensor, MAX6642_CMD_WRITE_LOCAL_LIMIT, limit );
 }
 
 void max6642_write_remote_limit( sensor_t *sensor, uint8_t limit )
 {
-    uint8_t i2c_interf, i2c_addr;
-    uint8_t msg[2] = { MAX6642_CMD_WRITE_REMOTE_LIMIT, limit };
-
-    if ( i2c_take_by_chipid( sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY) == pdTRUE ) {
-
-        xI2CMasterWrite( i2c_interf, i2c_addr, &msg[0], 2);
-        i2c_give( i2c_interf );
-    }
+    max6642_write_cmd( sensor, MAX6642_CMD_WRITE_REMOTE_LIMIT, limit );
 }
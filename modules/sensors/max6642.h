@@ -36,6 +36,7 @@
 #define MAX6642_H_
 
 #include "port.h"
+#include "sensor_sched.h"
 
 #define MAX6642_UPDATE_RATE             500
 
@@ -66,26 +67,12 @@
 #define MAX6642_STATUS_OPEN_MASK        (1 << 4)
 
 /**
- * @brief MAX6642 monitor Task Handle
+ * @brief MAX6642 driver, polled by the sensor scheduler every #MAX6642_UPDATE_RATE ms
  */
-extern TaskHandle_t vTaskMAX6642_Handle;
+extern const sensor_driver_ops max6642_driver;
 
 extern const SDR_type_01h_t SDR_MAX6642_FPGA;
 
-/**
- * @brief Initializes MAX6642 sensor and creates #vTaskMAX6642
- *
- * @return None
- */
-void MAX6642_init( void );
-
-/**
- * @brief MAX6642 Monitor Task
- *
- * @param Parameters Pointer to parameter list passed to task upon initialization (not used here)
- */
-void vTaskMAX6642( void *Parameters );
-
 /**
  * @brief Reads MAX6642's local temperature value
  *
@@ -35,7 +35,6 @@
 
 /* Project Includes */
 #include "sdr.h"
-#include "task_priorities.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
 #include "mcp9808.h"
@@ -51,54 +50,25 @@
 #define POINTER_DEVICE_ID       0x07 // Device ID
 #define POINTER_RESOLUTION      0x08 // Sensor resolution
 
-TaskHandle_t vTaskMCP9808_Handle;
-
-void vTaskMCP9808( void* Parameters )
+static bool mcp9808_read( sensor_t * sensor, uint8_t i2c_interf, uint8_t i2c_addr, uint8_t * raw )
 {
-    const TickType_t xFrequency = MCP9808_UPDATE_RATE;
-
-    uint8_t i2c_addr, i2c_interf;
-    sensor_t * temp_sensor;
-    uint8_t temp[2];
-    uint16_t converted_temp;
-
     const uint8_t ambient_temp = POINTER_AMBIENT_TEMP;
 
-    for ( ;; ) {
-        /* Iterate through the SDR Table to find all the MCP9808 entries */
-
-        for ( temp_sensor = sdr_head; temp_sensor != NULL; temp_sensor = temp_sensor->next) {
-
-            if ( temp_sensor->task_handle == NULL ) {
-                continue;
-            }
+    i2c_xfer_t xfer = { .tx = &ambient_temp, .tx_len = sizeof(ambient_temp), .rx = raw, .rx_len = 2 };
 
-            /* Check if this task should update the selected SDR */
-            if ( *(temp_sensor->task_handle) != xTaskGetCurrentTaskHandle() ) {
-                continue;
-            }
-
-            /* Try to gain the I2C bus */
-            if ( i2c_take_by_chipid( temp_sensor->chipid, &i2c_addr, &i2c_interf, portMAX_DELAY ) == pdTRUE ) {
-
-                /* Update the temperature reading */
-                if (xI2CMasterWriteRead( i2c_interf, i2c_addr, &ambient_temp, sizeof(ambient_temp), &temp[0], 2) == 2) {
-                    /* Discard lower 3 bits to get .5 C precision */
-                    converted_temp = (((temp[0]&0x1f) << 5) | (temp[1]>>3));
-                    temp_sensor->readout_value = converted_temp;
-                }
-                /* Check for threshold events */
-                i2c_give(i2c_interf);
-                sensor_state_check(temp_sensor);
-                check_sensor_event(temp_sensor);
-            }
-        }
-        vTaskDelay(xFrequency);
-    }
+    return ( i2c_transfer( i2c_interf, i2c_addr, &xfer, 1 ) == 1 );
 }
 
-
-void MCP9808_init( void )
+static void mcp9808_convert( sensor_t * sensor, const uint8_t * raw )
 {
-    xTaskCreate( vTaskMCP9808, "MCP9808", 200, (void *) NULL, tskMCP9808SENSOR_PRIORITY, &vTaskMCP9808_Handle);
+    /* Discard lower 3 bits to get .5 C precision */
+    sensor->readout_value = (((raw[0]&0x1f) << 5) | (raw[1]>>3));
 }
+
+const sensor_driver_ops mcp9808_driver = {
+    .name = "MCP9808",
+    .period = pdMS_TO_TICKS(MCP9808_UPDATE_RATE),
+    .uses_bus = true,
+    .read = mcp9808_read,
+    .convert = mcp9808_convert
+};
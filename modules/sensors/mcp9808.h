@@ -40,28 +40,16 @@
 #ifndef MCP9808_H_
 #define MCP9808_H_
 
+#include "sensor_sched.h"
+
 /**
  * @brief Rate at which the MCP9808 sensors are read (in ms)
  */
 #define MCP9808_UPDATE_RATE        500
 
-extern TaskHandle_t vTaskMCP9808_Handle;
-
-
 /**
- * @brief Initializes MCP9808 monitoring task
- *
- * @return None
- */
-void MCP9808_init( void );
-
-/**
- * @brief Monitoring task for MCP9808 sensor
- *
- * This task unblocks after every #MCP9808_UPDATE_RATE ms and updates the read from all the MCP9808 sensors listed in this module's SDR table
- *
- * @param Parameters Pointer to parameter list passed to task upon initialization (not used here)
+ * @brief MCP9808 driver, polled by the sensor scheduler every #MCP9808_UPDATE_RATE ms
  */
-void vTaskMCP9808( void* Parameters );
+extern const sensor_driver_ops mcp9808_driver;
 
 #endif
@@ -0,0 +1,338 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file sensor_sched.c
+ *
+ * @brief Sensor polling scheduler implementation
+ *
+ * @ingroup SENSORS
+ */
+
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* C Standard includes */
+#include <string.h>
+
+/* Project Includes */
+#include "port.h"
+#include "sdr.h"
+#include "i2c.h"
+#include "task_priorities.h"
+#include "sensor_sched.h"
+#include "uart_debug.h"
+
+/* Bus ID of entries whose driver does not use the I2C bus */
+#define SENSOR_SCHED_NO_BUS     0xFF
+
+enum {
+    SENSOR_SCHED_IDLE,
+    SENSOR_SCHED_CONVERTING
+};
+
+typedef struct sensor_sched_entry {
+    struct sensor_sched_entry * next;
+    struct sensor_sched_entry * all_next;   /* Never changes after init, may be walked from any task */
+    sensor_t * sensor;
+    TickType_t period;              /* Polling period, SENSOR_SCHED_NO_PERIOD if only polled on wake-ups */
+    TickType_t release;             /* Start of the current polling period */
+    TickType_t deadline;            /* Next time this sensor has to be served */
+    uint8_t wake;                   /* Set by sensor_sched_wake(), cleared by the scheduler task */
+    uint8_t bus_id;
+    uint8_t i2c_addr;
+    uint8_t state;
+    uint8_t fresh;                  /* raw holds a reading taken in this round */
+    uint8_t raw[SENSOR_RAW_MAX];
+} sensor_sched_entry;
+
+TaskHandle_t vTaskSensorSched_Handle;
+
+/* Polling list, sorted by deadline */
+static sensor_sched_entry * sched_head;
+
+/* Entries with no period, waiting for a wake-up */
+static sensor_sched_entry * sched_parked;
+
+/* Every entry, in creation order */
+static sensor_sched_entry * sched_all;
+
+static inline bool sched_is_due( TickType_t deadline, TickType_t now )
+{
+    return (int32_t)( now - deadline ) >= 0;
+}
+
+/**
+ * @brief Inserts an entry in the polling list, after every entry with the same or an earlier deadline
+ */
+static void sched_insert( sensor_sched_entry * entry )
+{
+    sensor_sched_entry ** pos = &sched_head;
+
+    while ( ( *pos != NULL ) && sched_is_due( (*pos)->deadline, entry->deadline ) ) {
+        pos = &(*pos)->next;
+    }
+
+    entry->next = *pos;
+    *pos = entry;
+}
+
+void sensor_sched_init( void )
+{
+    sensor_t * sensor;
+    sensor_sched_entry * entry;
+    TickType_t now = xTaskGetTickCount();
+
+    /* The SDR table is complete at this point, so the list is built only once */
+    for ( uint8_t sdr_idx = 0; sdr_idx < sdr_count; sdr_idx++ ) {
+        sensor = sdr_table[sdr_idx];
+
+        if ( ( sensor->driver == NULL ) || ( sensor->driver->read == NULL ) ) {
+            continue;
+        }
+
+        entry = pvPortMalloc( sizeof(sensor_sched_entry) );
+
+        if ( entry == NULL ) {
+            printf( "[SENSOR] Not enough memory to poll sensor %d!\n", sensor->num );
+            continue;
+        }
+        memset( entry, 0, sizeof(sensor_sched_entry) );
+
+        entry->sensor = sensor;
+        entry->bus_id = SENSOR_SCHED_NO_BUS;
+
+        if ( sensor->driver->uses_bus && !i2c_chip_lookup( sensor->chipid, &entry->bus_id, &entry->i2c_addr ) ) {
+            printf( "[SENSOR] Sensor %d has an unknown chip ID!\n", sensor->num );
+            vPortFree( entry );
+            continue;
+        }
+
+        entry->period = sensor->driver->period;
+        entry->release = now;
+        entry->deadline = now;
+        sched_insert( entry );
+
+        entry->all_next = sched_all;
+        sched_all = entry;
+    }
+
+    if ( sched_head != NULL ) {
+        xTaskCreate( vTaskSensorSched, "Sensors", 256, (void *) NULL, tskSENSOR_PRIORITY, &vTaskSensorSched_Handle );
+    }
+}
+
+static sensor_sched_entry * sched_find( sensor_t * sensor )
+{
+    sensor_sched_entry * entry;
+
+    for ( entry = sched_all; entry != NULL; entry = entry->all_next ) {
+        if ( entry->sensor == sensor ) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Unlinks an entry from a list
+ */
+static void sched_unlink( sensor_sched_entry ** list, sensor_sched_entry * entry )
+{
+    sensor_sched_entry ** pos;
+
+    for ( pos = list; *pos != NULL; pos = &(*pos)->next ) {
+        if ( *pos == entry ) {
+            *pos = entry->next;
+            entry->next = NULL;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Makes every woken entry due now
+ */
+static void sched_handle_wakes( TickType_t now )
+{
+    sensor_sched_entry * entry;
+
+    for ( entry = sched_all; entry != NULL; entry = entry->all_next ) {
+        if ( !__atomic_exchange_n( &entry->wake, 0, __ATOMIC_ACQ_REL ) ) {
+            continue;
+        }
+
+        /* Entries in the middle of a conversion will be read on their own deadline */
+        if ( entry->state == SENSOR_SCHED_CONVERTING ) {
+            continue;
+        }
+
+        sched_unlink( &sched_parked, entry );
+        sched_unlink( &sched_head, entry );
+        entry->release = now;
+        entry->deadline = now;
+        sched_insert( entry );
+    }
+}
+
+void sensor_sched_set_period( sensor_t * sensor, TickType_t period )
+{
+    sensor_sched_entry * entry = sched_find( sensor );
+
+    if ( entry != NULL ) {
+        entry->period = period;
+    }
+}
+
+void sensor_sched_wake( sensor_t * sensor )
+{
+    sensor_sched_entry * entry = sched_find( sensor );
+
+    if ( ( entry == NULL ) || ( vTaskSensorSched_Handle == NULL ) ) {
+        return;
+    }
+
+    __atomic_store_n( &entry->wake, 1, __ATOMIC_RELEASE );
+    xTaskNotifyGive( vTaskSensorSched_Handle );
+}
+
+void vTaskSensorSched( void * Parameters )
+{
+    sensor_sched_entry * entry;
+    sensor_sched_entry * group;
+    sensor_sched_entry ** pos;
+    sensor_sched_entry ** group_tail;
+    const sensor_driver_ops * ops;
+    TickType_t now;
+    uint8_t bus_id;
+    uint8_t i2c_interf = 0;
+    bool bus_taken;
+
+    /* Drivers may have to configure their chips through the bus, so they are initialized from this task */
+    for ( entry = sched_head; entry != NULL; entry = entry->next ) {
+        if ( entry->sensor->driver->init != NULL ) {
+            entry->sensor->driver->init( entry->sensor );
+        }
+    }
+
+    for ( ;; ) {
+        now = xTaskGetTickCount();
+
+        sched_handle_wakes( now );
+
+        /* Sleep until the earliest deadline, or until a sensor is woken up */
+        if ( sched_head == NULL ) {
+            ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+            continue;
+        }
+
+        if ( !sched_is_due( sched_head->deadline, now ) ) {
+            ulTaskNotifyTake( pdTRUE, sched_head->deadline - now );
+            continue;
+        }
+
+        /* Detach the head and every other entry on the same bus that is due within the group window */
+        bus_id = sched_head->bus_id;
+        group = NULL;
+        group_tail = &group;
+        pos = &sched_head;
+
+        while ( ( *pos != NULL ) && sched_is_due( (*pos)->deadline, now + SENSOR_SCHED_GROUP_WINDOW ) ) {
+            entry = *pos;
+
+            if ( entry->bus_id == bus_id ) {
+                *pos = entry->next;
+                entry->next = NULL;
+                *group_tail = entry;
+                group_tail = &entry->next;
+            } else {
+                pos = &entry->next;
+            }
+        }
+
+        /* Take the bus (and select the mux channel) once for the whole group */
+        bus_taken = true;
+        if ( bus_id != SENSOR_SCHED_NO_BUS ) {
+            bus_taken = i2c_take_by_busid( bus_id, &i2c_interf, SENSOR_SCHED_BUS_TIMEOUT );
+        }
+
+        for ( entry = group; entry != NULL; entry = entry->next ) {
+            ops = entry->sensor->driver;
+            entry->fresh = false;
+
+            if ( !bus_taken ) {
+                continue;
+            }
+
+            if ( ( entry->state == SENSOR_SCHED_IDLE ) && ( ops->start_conversion != NULL ) ) {
+                if ( ops->start_conversion( entry->sensor, i2c_interf, entry->i2c_addr ) ) {
+                    entry->state = SENSOR_SCHED_CONVERTING;
+                }
+                continue;
+            }
+
+            entry->state = SENSOR_SCHED_IDLE;
+            entry->fresh = ops->read( entry->sensor, i2c_interf, entry->i2c_addr, entry->raw );
+        }
+
+        if ( ( bus_id != SENSOR_SCHED_NO_BUS ) && bus_taken ) {
+            i2c_give( i2c_interf );
+        }
+
+        /* Conversion and threshold checks run with the bus already released */
+        now = xTaskGetTickCount();
+
+        while ( group != NULL ) {
+            entry = group;
+            group = entry->next;
+            ops = entry->sensor->driver;
+
+            if ( entry->fresh ) {
+                if ( ops->convert != NULL ) {
+                    ops->convert( entry->sensor, entry->raw );
+                }
+
+                if ( entry->sensor->sdr_type == TYPE_01 ) {
+                    sensor_state_check( entry->sensor );
+                    check_sensor_event( entry->sensor );
+                }
+            }
+
+            if ( entry->state == SENSOR_SCHED_CONVERTING ) {
+                entry->deadline = now + ops->conversion_time;
+            } else if ( entry->period == SENSOR_SCHED_NO_PERIOD ) {
+                /* Served, wait for the next wake-up */
+                entry->next = sched_parked;
+                sched_parked = entry;
+                continue;
+            } else {
+                entry->release += entry->period;
+
+                /* On overrun, skip the missed periods instead of polling in a burst to catch up */
+                if ( sched_is_due( entry->release, now ) ) {
+                    entry->release = now;
+                }
+                entry->deadline = entry->release;
+            }
+
+            sched_insert( entry );
+        }
+    }
+}
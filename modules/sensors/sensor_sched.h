@@ -0,0 +1,111 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/**
+ * @file sensor_sched.h
+ *
+ * @brief Sensor polling scheduler
+ *
+ * A single task polls every sensor in the SDR table through its driver's #sensor_driver_ops.
+ * Sensors are kept in a list sorted by their next deadline; when the head is due, every other
+ * sensor on the same I2C bus (i.e. the same mux channel) that is due within #SENSOR_SCHED_GROUP_WINDOW
+ * is served under the same bus ownership.
+ *
+ * @ingroup SENSORS
+ */
+
+#ifndef SENSOR_SCHED_H_
+#define SENSOR_SCHED_H_
+
+#include "FreeRTOS.h"
+#include "sdr.h"
+
+/**
+ * @brief Maximum number of raw bytes a driver may read in a single poll
+ */
+#define SENSOR_RAW_MAX                  4
+
+/**
+ * @brief Sensors due within this window of the earliest deadline share its bus ownership (in ticks)
+ */
+#define SENSOR_SCHED_GROUP_WINDOW       pdMS_TO_TICKS(20)
+
+/**
+ * @brief Maximum time the scheduler waits for a bus before skipping the group (in ticks)
+ */
+#define SENSOR_SCHED_BUS_TIMEOUT        pdMS_TO_TICKS(100)
+
+/**
+ * @brief Polling period of sensors that are only served when woken up (see sensor_sched_wake())
+ */
+#define SENSOR_SCHED_NO_PERIOD          0
+
+/**
+ * @brief Sensor driver interface
+ *
+ * Every callback but @p read is optional. @p start_conversion and @p read are called with the sensor bus
+ * already taken (when @p uses_bus is set), while @p init and @p convert run with no bus held.
+ * Threshold state and events are checked by the scheduler after @p convert for full sensor (type 01h) records.
+ */
+typedef struct sensor_driver_ops {
+    const char * name;                  /**< Driver name */
+    TickType_t period;                  /**< Polling period (in ticks) */
+    TickType_t conversion_time;         /**< Delay between start_conversion() and read() (in ticks) */
+    bool uses_bus;                      /**< Polls go through the I2C bus of the sensor chip */
+    void (* init)( sensor_t * sensor );
+    bool (* start_conversion)( sensor_t * sensor, uint8_t i2c_interf, uint8_t i2c_addr );
+    bool (* read)( sensor_t * sensor, uint8_t i2c_interf, uint8_t i2c_addr, uint8_t * raw );
+    void (* convert)( sensor_t * sensor, const uint8_t * raw );
+} sensor_driver_ops;
+
+/**
+ * @brief Builds the polling list from the SDR table and creates the scheduler task
+ *
+ * Must be called after all sensors have been inserted in the SDR table.
+ */
+void sensor_sched_init( void );
+
+/**
+ * @brief Changes the polling period of a sensor
+ *
+ * Meant to be called from the driver's @p init callback, e.g. by event-driven drivers that only need to be
+ * polled after sensor_sched_wake().
+ *
+ * @param sensor Sensor to change
+ * @param period New polling period (in ticks), or #SENSOR_SCHED_NO_PERIOD
+ */
+void sensor_sched_set_period( sensor_t * sensor, TickType_t period );
+
+/**
+ * @brief Makes a sensor due immediately and wakes the scheduler task
+ *
+ * May be called from any task, but not from interrupts.
+ *
+ * @param sensor Sensor to poll
+ */
+void sensor_sched_wake( sensor_t * sensor );
+
+/**
+ * @brief Sensor scheduler task
+ *
+ * @param Parameters Pointer to parameter list passed to task upon initialization (not used here)
+ */
+void vTaskSensorSched( void * Parameters );
+
+#endif
@@ -34,6 +34,9 @@
 
 /* Project includes */
 #include "port.h"
+#ifdef MODULE_SEL
+#include "sel.h"
+#endif
 
 static void sys_reset_callback(TimerHandle_t timer)
 {
@@ -46,6 +49,14 @@ int sys_schedule_reset(int period_ms)
     TimerHandle_t timer_sys_rst;
     int ret = 0;
 
+#ifdef MODULE_SEL
+    /*
+     * Don't lose the entries still queued in RAM. The flush runs in the caller's task, since it may take a while
+     * and the reset itself runs in the timer service task
+     */
+    sel_sync(SEL_BUS_TIMEOUT);
+#endif
+
     timer_sys_rst = xTimerCreate("System Reset", pdMS_TO_TICKS(period_ms),
                                  pdFALSE, (void*)0, sys_reset_callback);
 
@@ -31,6 +31,8 @@
 /**
  * @brief Schedule a MCU reset
  *
+ * Pending System Event Log entries are written to the EEPROM first, from the calling task.
+ *
  * @param[in] period_ms  Reset the MCU after a period specified in milisseconds
  *
  * @return 0 if successful, non zero if there was an error
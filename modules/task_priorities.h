@@ -30,19 +30,17 @@
 #define tskFPGA_COMM_PRIORITY           (tskIDLE_PRIORITY+1)
 #define tskWATCHDOG_PRIORITY            (tskIDLE_PRIORITY+1)
 #define tskCLI_PRIORITY                 (tskIDLE_PRIORITY+1)
+#define tskSEL_PRIORITY                 (tskIDLE_PRIORITY+1)
+#define tskFLASH_WRITER_PRIORITY        (tskIDLE_PRIORITY+1)
+#define tskEEPROM_WB_PRIORITY           (tskIDLE_PRIORITY+1)
 
 #define tskPAYLOAD_PRIORITY             (tskIDLE_PRIORITY+2)
 #define tskRTM_MANAGE_PRIORITY          (tskIDLE_PRIORITY+2)
 #define tskXR77129_PRIORITY             (tskIDLE_PRIORITY+2)
+#define tskIPMI_DEFERRED_PRIORITY       (tskIDLE_PRIORITY+2)
 
 #define tskSENSOR_PRIORITY              (tskIDLE_PRIORITY+3)
-#define tskHOTSWAP_PRIORITY             (tskIDLE_PRIORITY+3)
-#define tskLM75SENSOR_PRIORITY          (tskIDLE_PRIORITY+3)
-#define tskMCP9808SENSOR_PRIORITY       (tskIDLE_PRIORITY+3)
-#define tskMAX6642SENSOR_PRIORITY       (tskIDLE_PRIORITY+3)
-#define tskINA220SENSOR_PRIORITY        (tskIDLE_PRIORITY+3)
-#define tskINA3221SENSOR_PRIORITY       (tskIDLE_PRIORITY+3)
-#define tskADT7420SENSOR_PRIORITY       (tskIDLE_PRIORITY+3)
+#define tskIPMI_EVENT_PRIORITY          (tskIDLE_PRIORITY+3)
 
 #define tskIPMI_HANDLERS_PRIORITY       (tskIDLE_PRIORITY+4)
 #define tskIPMI_PRIORITY                (tskIDLE_PRIORITY+4)
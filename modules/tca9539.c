@@ -33,6 +33,7 @@
 /* Project Includes */
 #include "port.h"
 #include "tca9539.h"
+#include "expander_shadow.h"
 #include "i2c.h"
 #include "i2c_mapping.h"
 
@@ -64,32 +65,11 @@ static uint8_t tca9539_read_reg(uint8_t chip_id, uint8_t reg, uint8_t *readout)
 }
 
 /**
- * @brief TCA9539 General register write
- *
- * @param chip_id   Chip ID
- * @param reg       Selected register
- * @param data      Value to write to register
- *
- * @return Number of bytes written
+ * @brief Convert a shadowed register access result to the amount of bytes transferred
  */
-
-static uint8_t tca9539_write_reg(uint8_t chip_id, uint8_t reg, uint8_t data)
+static inline uint8_t tca9539_xfer_len(mmc_err err)
 {
-
-    uint8_t i2c_addr;
-    uint8_t i2c_id;
-    uint8_t tx_len = 0;
-    uint8_t cmd_data[2];
-
-    cmd_data[0] = reg;
-    cmd_data[1] = data;
-
-    if (i2c_take_by_chipid(chip_id, &i2c_addr, &i2c_id, (TickType_t) 10)) {
-        tx_len = xI2CMasterWrite(i2c_id, i2c_addr, cmd_data, sizeof(cmd_data));
-        i2c_give(i2c_id);
-    }
-
-    return tx_len;
+    return (err == MMC_OK) ? 1 : 0;
 }
 
 /* Pins Read/Write */
@@ -113,49 +93,43 @@ uint8_t tca9539_input_pin_get(uint8_t chip_id, uint8_t port_num, uint8_t pin, ui
 
 uint8_t tca9539_output_port_set(uint8_t chip_id, uint8_t port_num, uint8_t data)
 {
-    return tca9539_write_reg(chip_id, TCA9539_OUT_REG + port_num, data);
+    return tca9539_xfer_len(expander_write_reg(chip_id, TCA9539_OUT_REG + port_num, data));
+}
+
+uint8_t tca9539_output_port_update(uint8_t chip_id, uint8_t port_num, uint8_t mask, uint8_t data)
+{
+    return tca9539_xfer_len(expander_update_reg(chip_id, TCA9539_OUT_REG + port_num, mask, data));
 }
 
 uint8_t tca9539_output_port_get(uint8_t chip_id, uint8_t port_num, uint8_t *readout)
 {
-    return tca9539_read_reg(chip_id, TCA9539_OUT_REG + port_num, readout);
+    return tca9539_xfer_len(expander_read_reg(chip_id, TCA9539_OUT_REG + port_num, readout));
 }
 
 uint8_t tca9539_output_pin_set(uint8_t chip_id, uint8_t port_num, uint8_t pin, bool data)
 {
-    uint8_t output = 0;
-    uint8_t rx_len, tx_len = 0;
-
-    rx_len = tca9539_output_port_get(chip_id, port_num, &output);
-    output &= ~(1 << pin);
-    output |= (data << pin);
-
-    if (rx_len) {
-        tx_len = tca9539_output_port_set(chip_id, port_num, output);
-    }
-
-    return tx_len;
+    return tca9539_output_port_update(chip_id, port_num, (1 << pin), (data << pin));
 }
 
 /* Polarity Control */
 uint8_t tca9539_port_polarity_set(uint8_t chip_id, uint8_t port_num, uint8_t pol)
 {
-    return tca9539_write_reg(chip_id, TCA9539_IPOL_REG + port_num, pol);
+    return tca9539_xfer_len(expander_write_reg(chip_id, TCA9539_IPOL_REG + port_num, pol));
 }
 
 uint8_t tca9539_port_polarity_get(uint8_t chip_id, uint8_t port_num, uint8_t *pol)
 {
-    return tca9539_read_reg(chip_id, TCA9539_IPOL_REG + port_num, pol);
+    return tca9539_xfer_len(expander_read_reg(chip_id, TCA9539_IPOL_REG + port_num, pol));
 }
 
 /* Pins direction (output / input) */
 uint8_t tca9539_port_dir_set(uint8_t chip_id, uint8_t port_num, uint8_t dir)
 {
-    return tca9539_write_reg(chip_id, TCA9539_CONFIG_REG + port_num, dir);
+    return tca9539_xfer_len(expander_write_reg(chip_id, TCA9539_CONFIG_REG + port_num, dir));
 }
 
 uint8_t tca9539_port_dir_get(uint8_t chip_id, uint8_t port_num, uint8_t *dir)
 {
-    return tca9539_read_reg(chip_id, TCA9539_CONFIG_REG + port_num, dir);
+    return tca9539_xfer_len(expander_read_reg(chip_id, TCA9539_CONFIG_REG + port_num, dir));
 }
 
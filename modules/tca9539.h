@@ -97,7 +97,19 @@ uint8_t tca9539_input_pin_get(uint8_t chip_id, uint8_t port_num, uint8_t pin, ui
 uint8_t tca9539_output_port_set(uint8_t chip_id, uint8_t port_num, uint8_t data);
 
 /**
- * @brief Read port output pins
+ * @brief Write some port output pins, leaving the others unchanged
+ *
+ * The output register is kept in a shadow copy, so nothing is written if the masked pins already hold @p data.
+ *
+ * @param mask Pins to write
+ * @param data 8-bit value with the pins status
+ *
+ * @return 1 if the pins hold the requested status, 0 on failure
+ */
+uint8_t tca9539_output_port_update(uint8_t chip_id, uint8_t port_num, uint8_t mask, uint8_t data);
+
+/**
+ * @brief Read port output pins (from the shadow copy when valid)
  *
  * @return 8-bit value with the status of port pins
  */
@@ -52,6 +52,20 @@ uint8_t calculate_chksum ( uint8_t * buffer, uint8_t range )
     return chksum;
 }
 
+uint16_t calculate_crc16( const uint8_t * buffer, size_t len, uint16_t crc )
+{
+    configASSERT( ( buffer != NULL ) || ( len == 0 ) );
+    uint8_t bit;
+
+    while ( len-- ) {
+        crc ^= (uint16_t) *buffer++ << 8;
+        for ( bit = 0; bit < 8; bit++ ) {
+            crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ 0x1021 : ( crc << 1 );
+        }
+    }
+    return crc;
+}
+
 uint8_t cmpBuffs( uint8_t *bufa, size_t len_a, uint8_t *bufb, size_t len_b )
 {
     uint16_t i;
@@ -70,6 +70,19 @@ TickType_t getTickDifference( TickType_t current_time, TickType_t start_time );
  */
 uint8_t calculate_chksum( uint8_t * buffer, uint8_t range );
 
+/**
+ * @brief Calculate the CRC-16/CCITT (polynomial 0x1021) of a buffer
+ *
+ * Long messages can be processed in parts by passing the CRC of the previous parts as the initial value.
+ *
+ * @param buffer Pointer to the message bytes.
+ * @param len How many bytes will be used in the calculation.
+ * @param crc Initial value (0xFFFF for a new message)
+ *
+ * @return CRC of the specified bytes of the buffer.
+ */
+uint16_t calculate_crc16( const uint8_t * buffer, size_t len, uint16_t crc );
+
 /**
  * @brief Compare 2 buffers
  *
@@ -56,14 +56,7 @@ static void xr77129_runtime_read(I2C_ID_T i2c_interf, uint8_t i2c_addr, uint16_t
         lb
     };
 
-    I2C_XFER_T xfer = {0};
-    xfer.slaveAddr = i2c_addr;
-    xfer.txBuff = payload;
-    xfer.txSz = 2;
-    xfer.rxBuff = data;
-    xfer.rxSz = 1;
-    while (Chip_I2C_MasterTransfer(i2c_interf, &xfer) == I2C_STATUS_ARBLOST) {}
-//  return 1 - xfer.rxSz;
+    xI2CMasterWriteRead(i2c_interf, i2c_addr, payload, 2, data, 1);
 }
 
 static void xr77129_runtime_write(I2C_ID_T i2c_interf, uint8_t i2c_addr, uint16_t address, uint8_t data)
@@ -44,6 +44,7 @@
 #include "board_config.h"
 #include "clock_config.h"
 #include "eeprom_24xx02.h"
+#include "kv_store.h"
 #include "i2c_mapping.h"
 #include "pin_mapping.h"
 
@@ -104,7 +105,7 @@ uint8_t setDC_DC_ConvertersON(bool on)
         printf("Disable Power\n");
 
         for (uint8_t i = (sizeof(power_pins) / sizeof(power_pins[0])); i > 0; i--) {
-            pin = power_pins[i];
+            pin = power_pins[i-1];
             mcp23016_write_pin( ext_gpios[pin].port_num, ext_gpios[pin].pin_num, false );
             vTaskDelay(pdMS_TO_TICKS(10));
         }
@@ -209,7 +210,7 @@ void payload_init( void )
     bool standalone_mode = false;
     mmc_err err;
 
-    if (get_ipmb_addr() == IPMB_ADDR_DISCONNECTED) {
+    if (ipmb_addr == IPMB_ADDR_DISCONNECTED) {
         standalone_mode = true;
     }
 
@@ -218,8 +219,10 @@ void payload_init( void )
         while ( gpio_read_pin( PIN_PORT(GPIO_MMC_ENABLE), PIN_NUMBER(GPIO_MMC_ENABLE) ) == 1 ) {};
     }
 
-    /* Recover clock switch configuration saved in EEPROM */
-    eeprom_24xx02_read(CHIP_ID_RTC_EEPROM, 0x0, clock_config, 16, 10);
+    /* Recover clock switch configuration, from its former EEPROM location if it was never saved in the store */
+    if (kv_get(KV_KEY_CLOCK_CONFIG, clock_config, sizeof(clock_config), NULL) != MMC_OK) {
+        eeprom_24xx02_read(CHIP_ID_RTC_EEPROM, 0x0, clock_config, 16, 10);
+    }
 
     xTaskCreate( vTaskPayload, "Payload", 256, NULL, tskPAYLOAD_PRIORITY, &vTaskPayload_Handle );
 
@@ -342,7 +345,7 @@ void vTaskPayload( void *pvParameters )
          * and write the new configuration in EEPROM
          */
         if( current_evt & PAYLOAD_MESSAGE_CLOCK_CONFIG ){
-            eeprom_24xx02_write(CHIP_ID_RTC_EEPROM, 0x0, clock_config, 16, 10);
+            kv_set(KV_KEY_CLOCK_CONFIG, clock_config, sizeof(clock_config));
             if (PAYLOAD_FPGA_ON) {
                 clock_switch_write_reg(clock_config);
             }
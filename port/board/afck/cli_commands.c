@@ -550,7 +550,8 @@ static BaseType_t PrintVoltagesAndTemperatures(char *pcWriteBuffer, size_t xWrit
     bool repeat = FreeRTOS_CLIGetParameter(pcCommandString, 1, &lParameterStringLength);
     if (repeat) {
         unsigned lines = 0;
-        for (sensor_t * sensor = sdr_head; sensor != NULL; sensor = sensor->next) {
+        for (uint8_t sdr_idx = 0; sdr_idx < sdr_count; sdr_idx++) {
+            sensor_t * sensor = sdr_table[sdr_idx];
             if ( sensor->sdr_type != TYPE_01 ) {
                 continue;
             }
@@ -566,7 +567,8 @@ static BaseType_t PrintVoltagesAndTemperatures(char *pcWriteBuffer, size_t xWrit
         uart_send(UART_DEBUG, cursor_save, sizeof(cursor_save)-1);
     }
     do {
-        for (sensor_t * sensor = sdr_head; sensor != NULL; sensor = sensor->next) {
+        for (uint8_t sdr_idx = 0; sdr_idx < sdr_count; sdr_idx++) {
+            sensor_t * sensor = sdr_table[sdr_idx];
             if ( sensor->sdr_type != TYPE_01 ) {
                 continue;
             }
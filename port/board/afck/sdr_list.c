@@ -1124,51 +1124,51 @@ void amc_sdr_init( void )
     /* INA220 sensors */
 #ifdef MODULE_INA220_VOLTAGE
     /* FMC1 Voltage */
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_12V, &vTaskINA220_Handle, FMC1_12V_DEVID, CHIP_ID_INA_5 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_VADJ, &vTaskINA220_Handle, FMC1_VADJ_DEVID, CHIP_ID_INA_2 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_P3V3, &vTaskINA220_Handle, FMC1_P3V3_DEVID, CHIP_ID_INA_4 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_12V, &ina220_driver, FMC1_12V_DEVID, CHIP_ID_INA_5 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_VADJ, &ina220_driver, FMC1_VADJ_DEVID, CHIP_ID_INA_2 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_P3V3, &ina220_driver, FMC1_P3V3_DEVID, CHIP_ID_INA_4 );
 
     /* FMC2 Voltage */
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_12V, &vTaskINA220_Handle, FMC2_12V_DEVID, CHIP_ID_INA_0 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_VADJ, &vTaskINA220_Handle, FMC2_VADJ_DEVID, CHIP_ID_INA_1 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_P3V3, &vTaskINA220_Handle, FMC2_P3V3_DEVID, CHIP_ID_INA_3 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_12V, &ina220_driver, FMC2_12V_DEVID, CHIP_ID_INA_0 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_VADJ, &ina220_driver, FMC2_VADJ_DEVID, CHIP_ID_INA_1 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_P3V3, &ina220_driver, FMC2_P3V3_DEVID, CHIP_ID_INA_3 );
 #endif
 
 #ifdef MODULE_INA220_CURRENT
     /* FMC1 Current */
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_12V_CURR, &vTaskINA220_Handle, FMC1_12V_CURR_DEVID, CHIP_ID_INA_5 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_VADJ_CURR, &vTaskINA220_Handle, FMC1_VADJ_CURR_DEVID, CHIP_ID_INA_2 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_P3V3_CURR, &vTaskINA220_Handle, FMC1_P3V3_CURR_DEVID, CHIP_ID_INA_4 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_12V_CURR, &ina220_driver, FMC1_12V_CURR_DEVID, CHIP_ID_INA_5 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_VADJ_CURR, &ina220_driver, FMC1_VADJ_CURR_DEVID, CHIP_ID_INA_2 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC1_P3V3_CURR, &ina220_driver, FMC1_P3V3_CURR_DEVID, CHIP_ID_INA_4 );
 
     /* FMC2 Current */
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_12V_CURR, &vTaskINA220_Handle, FMC2_12V_CURR_DEVID, CHIP_ID_INA_0 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_VADJ_CURR, &vTaskINA220_Handle, FMC2_VADJ_CURR_DEVID, CHIP_ID_INA_1 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_P3V3_CURR, &vTaskINA220_Handle, FMC2_P3V3_CURR_DEVID, CHIP_ID_INA_3 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_12V_CURR, &ina220_driver, FMC2_12V_CURR_DEVID, CHIP_ID_INA_0 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_VADJ_CURR, &ina220_driver, FMC2_VADJ_CURR_DEVID, CHIP_ID_INA_1 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC2_P3V3_CURR, &ina220_driver, FMC2_P3V3_CURR_DEVID, CHIP_ID_INA_3 );
 #endif
 
 #ifdef MODULE_MAX6642
-    sdr_insert_entry( TYPE_01, (void *) &SDR_MAX6642_FPGA, &vTaskMAX6642_Handle, 0, CHIP_ID_MAX6642 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_MAX6642_FPGA, &max6642_driver, 0, CHIP_ID_MAX6642 );
 #endif
 
 #ifdef MODULE_LM75
     /* Board Temperature */
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_uC, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_0 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_ADN4604, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_1 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_DCDC, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_2 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RAM, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_3 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_uC, &lm75_driver, 0, CHIP_ID_LM75AIM_0 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_ADN4604, &lm75_driver, 0, CHIP_ID_LM75AIM_1 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_DCDC, &lm75_driver, 0, CHIP_ID_LM75AIM_2 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RAM, &lm75_driver, 0, CHIP_ID_LM75AIM_3 );
 #endif
 #ifdef MODULE_MCP9808
     /* Active low signal */
     if (gpio_read_pin(PIN_PORT(GPIO_FMC1_PRSNT_M2C), PIN_NUMBER(GPIO_FMC1_PRSNT_M2C)) == 0) {
-        sdr_insert_entry( TYPE_01, (void *) &SDR_MCP9808_FMC1, &vTaskMCP9808_Handle, 0, CHIP_ID_FMC1_MCP9808 );
+        sdr_insert_entry( TYPE_01, (void *) &SDR_MCP9808_FMC1, &mcp9808_driver, 0, CHIP_ID_FMC1_MCP9808 );
     }
     if (gpio_read_pin(PIN_PORT(GPIO_FMC2_PRSNT_M2C), PIN_NUMBER(GPIO_FMC2_PRSNT_M2C)) == 0) {
-        sdr_insert_entry( TYPE_01, (void *) &SDR_MCP9808_FMC2, &vTaskMCP9808_Handle, 0, CHIP_ID_FMC2_MCP9808 );
+        sdr_insert_entry( TYPE_01, (void *) &SDR_MCP9808_FMC2, &mcp9808_driver, 0, CHIP_ID_FMC2_MCP9808 );
     }
 #endif
 #ifdef MODULE_HOTSWAP
     /* Hotswap Sensor */
-    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_AMC, &vTaskHotSwap_Handle, 0, 0 );
+    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_AMC, &hotswap_driver, 0, 0 );
 #endif
 
 
@@ -715,23 +715,23 @@ const ina3221_config_t INA3221_SETTINGS = {
 void amc_sdr_init( void )
 {
     /* Hotswap Sensor */
-    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_AMC, &vTaskHotSwap_Handle, 0, 0 );
+    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_AMC, &hotswap_driver, 0, 0 );
 
     /* INA3221 sensors */
 #ifdef MODULE_INA3221_VOLTAGE
 
-    sdr_insert_entry( TYPE_01, (void *) &SDR_AMC_12V_VOLTAGE, &vTaskINA3221_Handle, 0, CHIP_ID_INA3221 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC_12V_VOLTAGE, &vTaskINA3221_Handle, 0, CHIP_ID_INA3221 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_RTM_12V_VOLTAGE, &vTaskINA3221_Handle, 0, CHIP_ID_INA3221 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_AMC_12V_VOLTAGE, &ina3221_driver, 0, CHIP_ID_INA3221 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC_12V_VOLTAGE, &ina3221_driver, 0, CHIP_ID_INA3221 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_RTM_12V_VOLTAGE, &ina3221_driver, 0, CHIP_ID_INA3221 );
     sdr_add_settings(CHIP_ID_INA3221, (void *) &INA3221_SETTINGS);
 
 #endif
 
 #ifdef MODULE_INA3221_CURRENT
 
-    sdr_insert_entry( TYPE_01, (void *) &SDR_AMC_12V_CURRENT, &vTaskINA3221_Handle, 0, CHIP_ID_INA3221 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC_12V_CURRENT, &vTaskINA3221_Handle, 0, CHIP_ID_INA3221 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_RTM_12V_CURRENT, &vTaskINA3221_Handle, 0, CHIP_ID_INA3221 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_AMC_12V_CURRENT, &ina3221_driver, 0, CHIP_ID_INA3221 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC_12V_CURRENT, &ina3221_driver, 0, CHIP_ID_INA3221 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_RTM_12V_CURRENT, &ina3221_driver, 0, CHIP_ID_INA3221 );
     sdr_add_settings(CHIP_ID_INA3221, (void *) &INA3221_SETTINGS);
 
 #endif
@@ -739,17 +739,17 @@ void amc_sdr_init( void )
     /* FPGA Temperature */
 #ifdef MODULE_MAX6642
 
-    sdr_insert_entry( TYPE_01, (void *) &SDR_MAX6642_FPGA, &vTaskMAX6642_Handle, 0, CHIP_ID_MAX6642 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_MAX6642_FPGA, &max6642_driver, 0, CHIP_ID_MAX6642 );
 
 #endif
 
     /* Board Temperature */
 #ifdef MODULE_LM75
 
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC6, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_0 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC7, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_1 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC8, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_2 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC9, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_3 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC6, &lm75_driver, 0, CHIP_ID_LM75AIM_0 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC7, &lm75_driver, 0, CHIP_ID_LM75AIM_1 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC8, &lm75_driver, 0, CHIP_ID_LM75AIM_2 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC9, &lm75_driver, 0, CHIP_ID_LM75AIM_3 );
 
 #endif
 }
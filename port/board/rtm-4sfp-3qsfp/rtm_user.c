@@ -24,6 +24,7 @@
 #include "port.h"
 #include "rtm.h"
 #include "pca9554.h"
+#include "expander_shadow.h"
 #include "pin_mapping.h"
 #include "hotswap.h"
 #include "i2c_mapping.h"
@@ -109,6 +110,9 @@ void rtm_hardware_init(void)
     // Enable RTM I2C
     gpio_set_pin_state(PIN_PORT(GPIO_RTM_I2C_EN), PIN_NUMBER(GPIO_RTM_I2C_EN), true);
 
+    /* The expander registers were reset while the RTM was unpowered or absent */
+    expander_shadow_invalidate(CHIP_ID_RTM_PCA9554);
+
     // Set GPIO expander direction
     pca9554_set_port_dir(CHIP_ID_RTM_PCA9554, 0x11);
 
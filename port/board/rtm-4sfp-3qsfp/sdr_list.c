@@ -237,13 +237,13 @@ const SDR_type_01h_t SDR_LM75_RTM_IC8 = {
 void rtm_sdr_init( void )
 {
 #ifdef MODULE_HOTSWAP
-    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_RTM, &vTaskHotSwap_Handle, 0, 0 );
+    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_RTM, &hotswap_driver, 0, 0 );
 #endif
 
 #ifdef MODULE_LM75
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_IC4, &vTaskLM75_Handle, 0, CHIP_ID_RTM_LM75_0 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_IC6, &vTaskLM75_Handle, 0, CHIP_ID_RTM_LM75_1 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_IC8, &vTaskLM75_Handle, 0, CHIP_ID_RTM_LM75_2 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_IC4, &lm75_driver, 0, CHIP_ID_RTM_LM75_0 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_IC6, &lm75_driver, 0, CHIP_ID_RTM_LM75_1 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_IC8, &lm75_driver, 0, CHIP_ID_RTM_LM75_2 );
 #endif
 
 }
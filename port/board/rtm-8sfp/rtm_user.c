@@ -23,6 +23,7 @@
 #include "port.h"
 #include "rtm.h"
 #include "pca9554.h"
+#include "expander_shadow.h"
 #include "pin_mapping.h"
 #include "hotswap.h"
 #include "i2c_mapping.h"
@@ -71,6 +72,9 @@ uint8_t rtm_get_hotswap_handle_status( uint8_t *state )
 
 void rtm_hardware_init( void )
 {
+    /* The expander registers were reset while the RTM was unpowered or absent */
+    expander_shadow_invalidate( CHIP_ID_RTM_PCA9554 );
+
     pca9554_set_port_dir( CHIP_ID_RTM_PCA9554, 0x1F );
 }
 
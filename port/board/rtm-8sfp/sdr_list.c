@@ -1,190 +0,0 @@
-/*
- *   openMMC -- Open Source modular IPM Controller firmware
- *
- *   Copyright (C) 2015-2016  Henrique Silva <henrique.silva@lnls.br>
- *
- *   This program is free software: you can redistribute it and/or modify
- *   it under the terms of the GNU General Public License as published by
- *   the Free Software Foundation, either version 3 of the License, or
- *   (at your option) any later version.
- *
- *   This program is distributed in the hope that it will be useful,
- *   but WITHOUT ANY WARRANTY; without even the implied warranty of
- *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- *   GNU General Public License for more details.
- *
- *   You should have received a copy of the GNU General Public License
- *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
- *
- *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
- */
-
-/* Project Includes */
-#include "sdr.h"
-#include "utils.h"
-#include "sensors.h"
-#include "rtm_i2c_mapping.h"
-
-/* Rename file to sdr_list.c */
-#ifdef MODULE_HOTSWAP
-const SDR_type_02h_t SDR_HOTSWAP_RTM = {
-
-    .hdr.recID_LSB = 0x00, /* Filled by sdr_insert_entry() */
-    .hdr.recID_MSB = 0x00,
-    .hdr.SDRversion = 0x51,
-    .hdr.rectype = TYPE_02,
-    .hdr.reclength = sizeof(SDR_type_02h_t) - sizeof(SDR_entry_hdr_t),
-
-    .ownerID = 0x00, /* i2c address, -> SDR_Init */
-    .ownerLUN = 0x00, /* sensor owner LUN */
-    .sensornum = 0x00, /* Filled by sdr_insert_entry() */
-
-/* record body bytes */
-    .entityID = 0xC0, /* entity id: RTM */
-    .entityinstance = 0x00, /* entity instance -> SDR_Init */
-    .sensorinit = 0x03, /* init: event generation + scanning enabled */
-    .sensorcap = 0xc1, /* capabilities: auto re-arm,*/
-    .sensortype = SENSOR_TYPE_HOT_SWAP, /* sensor type: HOT SWAP*/
-    .event_reading_type = 0x6f, /* sensor reading*/
-    .assertion_event_mask = 0x0000, /* assertion event mask */
-    .deassertion_event_mask = 0x0000, /* deassertion event mask */
-    .readable_threshold_mask = 0x00, /* LSB: readable Threshold mask: no thresholds are readable:  */
-    .settable_threshold_mask = 0x00, /* MSB: setable Threshold mask: no thresholds are setable: */
-    .sensor_units_1 = 0xc0, /* sensor units 1 : Does not return analog reading*/
-    .sensor_units_2 = 0x00, /* sensor units 2 :*/
-    .sensor_units_3 = 0x00, /* sensor units 3 :*/
-    .record_sharing[0] = 0x00,
-    .record_sharing[1] = 0x00,
-    .pos_thr_hysteresis = 0x00, /* positive going Threshold hysteresis value */
-    .neg_thr_hysteresis = 0x00, /* negative going Threshold hysteresis value */
-    .reserved1 = 0x00, /* reserved */
-    .reserved2 = 0x00, /* reserved */
-    .reserved3 = 0x00, /* reserved */
-    .OEM = 0x00, /* OEM reserved */
-    .IDtypelen = 0xc0 | STR_SIZE("HOTSWAP RTM"), /* 8 bit ASCII, number of bytes */
-    .IDstring = "HOTSWAP RTM" /* sensor string */
-};
-#endif
-
-#ifdef MODULE_LM75
-const SDR_type_01h_t SDR_LM75_RTM_1 = {
-
-    .hdr.recID_LSB = 0x00, /* Filled by sdr_insert_entry() */
-    .hdr.recID_MSB = 0x00,
-    .hdr.SDRversion = 0x51,
-    .hdr.rectype = TYPE_01,
-    .hdr.reclength = sizeof(SDR_type_01h_t) - sizeof(SDR_entry_hdr_t),
-
-    .ownerID = 0x00, /* i2c address, -> SDR_Init */
-    .ownerLUN = 0x00, /* sensor owner LUN */
-    .sensornum = 0x00, /* Filled by sdr_insert_entry() */
-
-    /* record body bytes */
-    .entityID = 0xC0, /* entity id: RTM */
-    .entityinstance = 0x00, /* entity instance -> SDR_Init */
-    .sensorinit = 0x7f, /* init: event generation + scanning enabled */
-    .sensorcap = 0x68, /* capabilities: auto re-arm,*/
-    .sensortype = SENSOR_TYPE_TEMPERATURE, /* sensor type */
-    .event_reading_type = 0x01, /* sensor reading*/
-    .assertion_event_mask = 0x7A95, /* assertion event mask (All upper going-high and lower going-low events) */
-    .deassertion_event_mask = 0x7A95, /* deassertion event mask (All upper going-high and lower going-low events) */
-    .readable_threshold_mask = 0x3F, /* LSB: readable Threshold mask: all thresholds are readable:  */
-    .settable_threshold_mask = 0x00, /* MSB: setable Threshold mask: none of the thresholds are setable: */
-    .sensor_units_1 = 0x00, /* sensor units 1 :*/
-    .sensor_units_2 = 0x01, /* sensor units 2 :*/
-    .sensor_units_3 = 0x00, /* sensor units 3 :*/
-    .linearization = 0x00, /* Linearization */
-    .M = 5, /* M */
-    .M_tol = 0x00, /* M - Tolerance */
-    .B = 0x00, /* B */
-    .B_accuracy = 0x00, /* B - Accuracy */
-    .acc_exp_sensor_dir = 0x00, /* Sensor direction */
-    .Rexp_Bexp = 0xF0, /* R-Exp , B-Exp */
-    .analog_flags = 0x03, /* Analogue characteristics flags */
-    .nominal_reading = (30 << 1), /* Nominal reading */
-    .normal_max = (50 << 1), /* Normal maximum */
-    .normal_min = (20 << 1), /* Normal minimum */
-    .sensor_max_reading = 0xFF, /* Sensor Maximum reading */
-    .sensor_min_reading = 0x00, /* Sensor Minimum reading */
-    .upper_nonrecover_thr = (75 << 1), /* Upper non-recoverable Threshold */
-    .upper_critical_thr = (65 << 1), /* Upper critical Threshold */
-    .upper_noncritical_thr = (55 << 1), /* Upper non critical Threshold */
-    .lower_nonrecover_thr = (5 << 1), /* Lower non-recoverable Threshold */
-    .lower_critical_thr = (10 << 1), /* Lower critical Threshold */
-    .lower_noncritical_thr = (20 << 1), /* Lower non-critical Threshold */
-    .pos_thr_hysteresis = 2, /* positive going Threshold hysteresis value */
-    .neg_thr_hysteresis = 2, /* negative going Threshold hysteresis value */
-    .reserved1 = 0x00, /* reserved */
-    .reserved2 = 0x00, /* reserved */
-    .OEM = 0x00, /* OEM reserved */
-    .IDtypelen = 0xc0 | STR_SIZE("TEMP RTM1"), /* 8 bit ASCII, number of bytes */
-    .IDstring = "TEMP RTM1" /* sensor string */
-};
-
-const SDR_type_01h_t SDR_LM75_RTM_2 = {
-
-    .hdr.recID_LSB = 0x00, /* Filled by sdr_insert_entry() */
-    .hdr.recID_MSB = 0x00,
-    .hdr.SDRversion = 0x51,
-    .hdr.rectype = TYPE_01,
-    .hdr.reclength = sizeof(SDR_type_01h_t) - sizeof(SDR_entry_hdr_t),
-
-    .ownerID = 0x00, /* i2c address, -> SDR_Init */
-    .ownerLUN = 0x00, /* sensor owner LUN */
-    .sensornum = 0x00, /* Filled by sdr_insert_entry() */
-
-    /* record body bytes */
-    .entityID = 0xC0, /* entity id: RTM */
-    .entityinstance = 0x00, /* entity instance -> SDR_Init */
-    .sensorinit = 0x7f, /* init: event generation + scanning enabled */
-    .sensorcap = 0x68, /* capabilities: auto re-arm,*/
-    .sensortype = SENSOR_TYPE_TEMPERATURE, /* sensor type */
-    .event_reading_type = 0x01, /* sensor reading*/
-    .assertion_event_mask = 0x7A95, /* assertion event mask (All upper going-high and lower going-low events) */
-    .deassertion_event_mask = 0x7A95, /* deassertion event mask (All upper going-high and lower going-low events) */
-    .readable_threshold_mask = 0x3F, /* LSB: readable Threshold mask: all thresholds are readable:  */
-    .settable_threshold_mask = 0x00, /* MSB: setable Threshold mask: none of the thresholds are setable: */
-    .sensor_units_1 = 0x00, /* sensor units 1 :*/
-    .sensor_units_2 = 0x01, /* sensor units 2 :*/
-    .sensor_units_3 = 0x00, /* sensor units 3 :*/
-    .linearization = 0x00, /* Linearization */
-    .M = 5, /* M */
-    .M_tol = 0x00, /* M - Tolerance */
-    .B = 0x00, /* B */
-    .B_accuracy = 0x00, /* B - Accuracy */
-    .acc_exp_sensor_dir = 0x00, /* Sensor direction */
-    .Rexp_Bexp = 0xF0, /* R-Exp , B-Exp */
-    .analog_flags = 0x03, /* Analogue characteristics flags */
-    .nominal_reading = (30 << 1), /* Nominal reading */
-    .normal_max = (50 << 1), /* Normal maximum */
-    .normal_min = (20 << 1), /* Normal minimum */
-    .sensor_max_reading = 0xFF, /* Sensor Maximum reading */
-    .sensor_min_reading = 0x00, /* Sensor Minimum reading */
-    .upper_nonrecover_thr = (75 << 1), /* Upper non-recoverable Threshold */
-    .upper_critical_thr = (65 << 1), /* Upper critical Threshold */
-    .upper_noncritical_thr = (55 << 1), /* Upper non critical Threshold */
-    .lower_nonrecover_thr = (5 << 1), /* Lower non-recoverable Threshold */
-    .lower_critical_thr = (10 << 1), /* Lower critical Threshold */
-    .lower_noncritical_thr = (20 << 1), /* Lower non-critical Threshold */
-    .pos_thr_hysteresis = 2, /* positive going Threshold hysteresis value */
-    .neg_thr_hysteresis = 2, /* negative going Threshold hysteresis value */
-    .reserved1 = 0x00, /* reserved */
-    .reserved2 = 0x00, /* reserved */
-    .OEM = 0x00, /* OEM reserved */
-    .IDtypelen = 0xc0 | STR_SIZE("TEMP RTM2"), /* 8 bit ASCII, number of bytes */
-    .IDstring = "TEMP RTM2" /* sensor string */
-};
-#endif
-
-void rtm_sdr_init( void )
-{
-#ifdef MODULE_HOTSWAP
-    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_RTM, &vTaskHotSwap_Handle, 0, 0 );
-#endif
-
-#ifdef MODULE_LM75
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_1, &vTaskLM75_Handle, 0, CHIP_ID_RTM_LM75_0 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_2, &vTaskLM75_Handle, 0, CHIP_ID_RTM_LM75_1 );
-#endif
-
-}
@@ -23,6 +23,7 @@
 #include "port.h"
 #include "rtm.h"
 #include "pca9554.h"
+#include "expander_shadow.h"
 #include "pin_mapping.h"
 #include "hotswap.h"
 #include "i2c_mapping.h"
@@ -42,11 +43,11 @@ mmc_err rtm_enable_payload_power_post( void )
      */
     pca9554_write_pin(CHIP_ID_RTM_PCA9554_PWR, RTM_GPIO_5V_EN, 1);
     vTaskDelay(pdMS_TO_TICKS(10));
-    pca9554_write_pin(CHIP_ID_RTM_PCA9554_PWR, RTM_GPIO_NEG_7V_EN, 1);
-    pca9554_write_pin(CHIP_ID_RTM_PCA9554_PWR, RTM_GPIO_7V_EN, 0);
+    pca9554_write_port_masked(CHIP_ID_RTM_PCA9554_PWR, (1 << RTM_GPIO_NEG_7V_EN) | (1 << RTM_GPIO_7V_EN),
+                              (1 << RTM_GPIO_NEG_7V_EN) | (0 << RTM_GPIO_7V_EN));
     vTaskDelay(pdMS_TO_TICKS(10));
-    pca9554_write_pin(CHIP_ID_RTM_PCA9554_PWR, RTM_GPIO_VS1_EN, 1);
-    pca9554_write_pin(CHIP_ID_RTM_PCA9554_PWR, RTM_GPIO_VS2_EN, 1);
+    pca9554_write_port_masked(CHIP_ID_RTM_PCA9554_PWR, (1 << RTM_GPIO_VS1_EN) | (1 << RTM_GPIO_VS2_EN),
+                              (1 << RTM_GPIO_VS1_EN) | (1 << RTM_GPIO_VS2_EN));
 
     return MMC_OK;
 }
@@ -56,11 +57,11 @@ mmc_err rtm_disable_payload_power_pre( void )
     /*
      * RTM-LAMP power down sequence
      */
-    pca9554_write_pin(CHIP_ID_RTM_PCA9554_PWR, RTM_GPIO_VS1_EN, 0);
-    pca9554_write_pin(CHIP_ID_RTM_PCA9554_PWR, RTM_GPIO_VS2_EN, 0);
+    pca9554_write_port_masked(CHIP_ID_RTM_PCA9554_PWR, (1 << RTM_GPIO_VS1_EN) | (1 << RTM_GPIO_VS2_EN),
+                              (0 << RTM_GPIO_VS1_EN) | (0 << RTM_GPIO_VS2_EN));
     vTaskDelay(pdMS_TO_TICKS(10));
-    pca9554_write_pin(CHIP_ID_RTM_PCA9554_PWR, RTM_GPIO_NEG_7V_EN, 0);
-    pca9554_write_pin(CHIP_ID_RTM_PCA9554_PWR, RTM_GPIO_7V_EN, 1);
+    pca9554_write_port_masked(CHIP_ID_RTM_PCA9554_PWR, (1 << RTM_GPIO_NEG_7V_EN) | (1 << RTM_GPIO_7V_EN),
+                              (0 << RTM_GPIO_NEG_7V_EN) | (1 << RTM_GPIO_7V_EN));
     vTaskDelay(pdMS_TO_TICKS(10));
     pca9554_write_pin(CHIP_ID_RTM_PCA9554_PWR, RTM_GPIO_5V_EN, 0);
 
@@ -88,6 +89,10 @@ uint8_t rtm_get_hotswap_handle_status( uint8_t *state )
 
 void rtm_hardware_init( void )
 {
+    /* The expander registers were reset while the RTM was unpowered or absent */
+    expander_shadow_invalidate( CHIP_ID_RTM_PCA9554_LEDS );
+    expander_shadow_invalidate( CHIP_ID_RTM_PCA9554_PWR );
+
     pca9554_set_port_dir( CHIP_ID_RTM_PCA9554_LEDS, 0x1F );
 
     /*
@@ -24,6 +24,7 @@
 #include "port.h"
 #include "rtm.h"
 #include "pcf8574.h"
+#include "expander_shadow.h"
 #include "pin_mapping.h"
 #include "hotswap.h"
 #include "i2c_mapping.h"
@@ -121,6 +122,9 @@ void rtm_hardware_init(void)
 
     vTaskDelay(100);
 
+    /* The expander registers were reset while the RTM was unpowered or absent */
+    expander_shadow_invalidate(CHIP_ID_RTM_PCF8574A);
+
     pcf8574_set_port_dir_input(1 << RTM_GPIO_HOTSWAP_HANDLE);
     pcf8574_set_port_dir_input(1 << RTM_GPIO_POWER_GOOD);
 
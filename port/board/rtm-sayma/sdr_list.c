@@ -455,22 +455,22 @@ const SDR_type_01h_t SDR_ADT7420_RTM_MEZZ_1 = {
 void rtm_sdr_init( void )
 {
 #ifdef MODULE_HOTSWAP
-    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_RTM, &vTaskHotSwap_Handle, 0, 0 );
+    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_RTM, &hotswap_driver, 0, 0 );
 #endif
 
 #ifdef MODULE_MAX6642
-    sdr_insert_entry( TYPE_01, (void *) &SDR_MAX6642_RTM_FPGA, &vTaskMAX6642_Handle, 0, CHIP_ID_RTM_MAX6642 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_MAX6642_RTM_FPGA, &max6642_driver, 0, CHIP_ID_RTM_MAX6642 );
 #endif
 
 #ifdef MODULE_ADT7420
-    sdr_insert_entry( TYPE_01, (void *) &SDR_ADT7420_RTM_IC3, &vTaskADT7420_Handle, 0, CHIP_ID_RTM_TMP_ADT_1 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_ADT7420_RTM_IC4, &vTaskADT7420_Handle, 0, CHIP_ID_RTM_TMP_ADT_2 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_ADT7420_RTM_MEZZ_0, &vTaskADT7420_Handle, 0, CHIP_ID_RTM_MEZ0_ADT7420 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_ADT7420_RTM_MEZZ_1, &vTaskADT7420_Handle, 0, CHIP_ID_RTM_MEZ1_ADT7420 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_ADT7420_RTM_IC3, &adt7420_driver, 0, CHIP_ID_RTM_TMP_ADT_1 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_ADT7420_RTM_IC4, &adt7420_driver, 0, CHIP_ID_RTM_TMP_ADT_2 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_ADT7420_RTM_MEZZ_0, &adt7420_driver, 0, CHIP_ID_RTM_MEZ0_ADT7420 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_ADT7420_RTM_MEZZ_1, &adt7420_driver, 0, CHIP_ID_RTM_MEZ1_ADT7420 );
 #endif
 
 #ifdef MODULE_LM75
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_IC17, &vTaskLM75_Handle, 0, CHIP_ID_RTM_LM75_0 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_IC32, &vTaskLM75_Handle, 0, CHIP_ID_RTM_LM75_1 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_IC17, &lm75_driver, 0, CHIP_ID_RTM_LM75_0 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_RTM_IC32, &lm75_driver, 0, CHIP_ID_RTM_LM75_1 );
 #endif
 }
@@ -87,6 +87,7 @@ bool i2c_set_mux_bus( uint8_t bus_id, i2c_mux_state_t *i2c_mux, int8_t new_state
 
     uint8_t rtm_mux = 0;
     uint8_t rtm_tca_channel;
+    int8_t channel = new_state;
 
     if (new_state >= RTM_MUX_BUS_NUM)
     {
@@ -103,8 +104,7 @@ bool i2c_set_mux_bus( uint8_t bus_id, i2c_mux_state_t *i2c_mux, int8_t new_state
         /* Select desired channel in the I2C switch */
         if(xI2CMasterWrite( i2c_bus_map[i2c_chip_map[CHIP_ID_MUX_MMC].bus_id].i2c_interface, i2c_chip_map[CHIP_ID_MUX_MMC].i2c_address, &tca_channel, 1 ) != 1 )
         {
-        	/* We failed to configure the I2C Mux, release the semaphore */
-            xSemaphoreGive( i2c_mux->semaphore );
+        	/* We failed to configure the I2C Mux, the caller releases the bus */
             return false;
         }
 #ifdef MODULE_RTM
@@ -113,13 +113,13 @@ bool i2c_set_mux_bus( uint8_t bus_id, i2c_mux_state_t *i2c_mux, int8_t new_state
 			/* Change RTM MUX state if bus is behind RTM MUX */
 			if( xI2CMasterWrite( i2c_bus_map[i2c_chip_map[CHIP_ID_MUX_MMC].bus_id].i2c_interface, i2c_chip_map[CHIP_ID_RTM_TCA9548].i2c_address, &rtm_tca_channel, 1 ) != 1 )
 			{
-				xSemaphoreGive( i2c_mux->semaphore );
 				return false;
 			}
 		}
 #endif
     }
-    i2c_mux->state = new_state;
+    /* Cache the requested channel (not the first level one) so buses behind the RTM mux are cached too */
+    i2c_mux->state = channel;
     return true;
 }
 
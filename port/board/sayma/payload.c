@@ -198,7 +198,7 @@ void payload_init(void)
 {
     bool standalone_mode = false;
 
-    if (get_ipmb_addr() == IPMB_ADDR_DISCONNECTED) {
+    if (ipmb_addr == IPMB_ADDR_DISCONNECTED) {
         standalone_mode = true;
     }
 
@@ -435,21 +435,13 @@ void vTaskPowerGood(void *Parameters)
 #ifdef MODULE_HPM
 
 #include "flash_spi.h"
+#include "flash_writer.h"
 #include "string.h"
 
-uint8_t hpm_page[256];
-uint8_t hpm_pg_index;
-uint32_t hpm_page_addr;
-
 uint8_t payload_hpm_prepare_comp( void )
 {
-    /* Initialize variables */
-    memset(hpm_page, 0xFF, sizeof(hpm_page));
-    hpm_pg_index = 0;
-    hpm_page_addr = 0;
-
     /* Initialize flash */
-    ssp_init( FLASH_SPI, FLASH_SPI_BITRATE, FLASH_SPI_FRAME_SIZE, SSP_MASTER, SSP_INTERRUPT );
+    ssp_init( FLASH_SPI, FLASH_SPI_BITRATE, FLASH_SPI_FRAME_SIZE, SSP_MASTER, SSP_DMA );
 
     /* Prevent the FPGA from accessing the Flash to configure itself now */
     gpio_set_pin_state( PIN_PORT(GPIO_FPGA_PROGRAM_B), PIN_NUMBER(GPIO_FPGA_PROGRAM_B), GPIO_LEVEL_HIGH );
@@ -457,69 +449,27 @@ uint8_t payload_hpm_prepare_comp( void )
     gpio_set_pin_state( PIN_PORT(GPIO_FPGA_PROGRAM_B), PIN_NUMBER(GPIO_FPGA_PROGRAM_B), GPIO_LEVEL_HIGH );
     gpio_set_pin_state( PIN_PORT(GPIO_FPGA_PROGRAM_B), PIN_NUMBER(GPIO_FPGA_PROGRAM_B), GPIO_LEVEL_LOW );
 
-    /* Erase FLASH */
-    flash_bulk_erase();
-
-    return IPMI_CC_COMMAND_IN_PROGRESS;
+    /* The flash is erased by the writer task, the upload may start once the upgrade status is OK */
+    return flash_writer_start( true );
 }
 
 uint8_t payload_hpm_upload_block( uint8_t * block, uint16_t size )
 {
     /* TODO: Check DONE pin before accessing the SPI bus, since the FPGA may be reading it in order to boot */
-    uint8_t remaining_bytes_start;
-
-    if ( sizeof(hpm_page) - hpm_pg_index > size ) {
-        /* Our page is not full yet, just append the new data */
-        memcpy(&hpm_page[hpm_pg_index], block, size);
-        hpm_pg_index += size;
-
-        return IPMI_CC_OK;
-
-    } else {
-        /* Complete the remaining bytes on the buffer */
-        memcpy(&hpm_page[hpm_pg_index], block, (sizeof(hpm_page) - hpm_pg_index));
-        remaining_bytes_start = (sizeof(hpm_page) - hpm_pg_index);
-
-        /* Program the complete page in the Flash */
-        flash_program_page( hpm_page_addr, &hpm_page[0], sizeof(hpm_page));
-
-        hpm_page_addr += sizeof(hpm_page);
 
-        /* Empty our buffer and reset the index */
-        memset(hpm_page, 0xFF, sizeof(hpm_page));
-        hpm_pg_index = 0;
-
-        /* Save the trailing bytes */
-        memcpy(&hpm_page[hpm_pg_index], block+remaining_bytes_start, size-remaining_bytes_start);
-
-        hpm_pg_index = size-remaining_bytes_start;
-
-        return IPMI_CC_COMMAND_IN_PROGRESS;
-    }
+    /* Full pages are programmed by the writer task while the next one is received */
+    return flash_writer_append( block, size );
 }
 
 uint8_t payload_hpm_finish_upload( uint32_t image_size )
 {
-    /* Check if the last page was already programmed */
-    if (!hpm_pg_index) {
-        /* Program the complete page in the Flash */
-        flash_program_page( hpm_page_addr, &hpm_page[0], (sizeof(hpm_page)-hpm_pg_index));
-        hpm_pg_index = 0;
-        hpm_page_addr = 0;
-
-        return IPMI_CC_COMMAND_IN_PROGRESS;
-    }
-
-    return IPMI_CC_OK;
+    /* Program the last partial page, if any */
+    return flash_writer_finish();
 }
 
 uint8_t payload_hpm_get_upgrade_status( void )
 {
-    if (is_flash_busy()) {
-        return IPMI_CC_COMMAND_IN_PROGRESS;
-    } else {
-        return IPMI_CC_OK;
-    }
+    return flash_writer_status();
 }
 
 uint8_t payload_hpm_activate_firmware( void )
@@ -615,20 +615,20 @@ void amc_sdr_init( void )
 #ifdef MODULE_HOTSWAP
 
     /* Hotswap Sensor */
-    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_AMC, &vTaskHotSwap_Handle, 0, 0 );
+    sdr_insert_entry( TYPE_02, (void *) &SDR_HOTSWAP_AMC, &hotswap_driver, 0, 0 );
 
 #endif
 
 #ifdef MODULE_INA219
 
     /* FMC */
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC_12V_VOLTAGE, &vTaskINA219_Handle, FMC1_12V_DEVID, CHIP_ID_INA_1 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC_12V_CURRENT, &vTaskINA219_Handle, FMC1_12V_CURR_DEVID, CHIP_ID_INA_1 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC_12V_VOLTAGE, &ina219_driver, FMC1_12V_DEVID, CHIP_ID_INA_1 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_FMC_12V_CURRENT, &ina219_driver, FMC1_12V_CURR_DEVID, CHIP_ID_INA_1 );
     sdr_add_settings(CHIP_ID_INA_1, (void *) &INA219_IC55_SETTINGS);
 
     /* RTM */
-    sdr_insert_entry( TYPE_01, (void *) &SDR_RTM_12V_VOLTAGE, &vTaskINA219_Handle, NO_DIAG, CHIP_ID_INA_0 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_RTM_12V_CURRENT, &vTaskINA219_Handle, NO_DIAG, CHIP_ID_INA_0 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_RTM_12V_VOLTAGE, &ina219_driver, NO_DIAG, CHIP_ID_INA_0 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_RTM_12V_CURRENT, &ina219_driver, NO_DIAG, CHIP_ID_INA_0 );
     sdr_add_settings(CHIP_ID_INA_0, (void *) &INA219_IC56_SETTINGS);
 
 #endif
@@ -636,17 +636,17 @@ void amc_sdr_init( void )
 #ifdef MODULE_MAX6642
 
     /* FPGA temperature sensor */
-    sdr_insert_entry( TYPE_01, (void *) &SDR_MAX6642_FPGA, &vTaskMAX6642_Handle, 0, CHIP_ID_MAX6642 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_MAX6642_FPGA, &max6642_driver, 0, CHIP_ID_MAX6642 );
 
 #endif
 
 #ifdef MODULE_LM75
 
     /* Temperature sensors */
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC45, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_0 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC46, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_1 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC47, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_2 );
-    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC48, &vTaskLM75_Handle, 0, CHIP_ID_LM75AIM_3 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC45, &lm75_driver, 0, CHIP_ID_LM75AIM_0 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC46, &lm75_driver, 0, CHIP_ID_LM75AIM_1 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC47, &lm75_driver, 0, CHIP_ID_LM75AIM_2 );
+    sdr_insert_entry( TYPE_01, (void *) &SDR_LM75_IC48, &lm75_driver, 0, CHIP_ID_LM75AIM_3 );
 
 #endif
 }
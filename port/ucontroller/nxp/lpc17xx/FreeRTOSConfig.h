@@ -83,8 +83,8 @@ licensing and training services.
 #define configSUPPORT_DYNAMIC_ALLOCATION        1
 #define configUSE_TIMERS                        1
 #define configTIMER_TASK_PRIORITY               5
-#define configTIMER_QUEUE_LENGTH                2
-#define configTIMER_TASK_STACK_DEPTH            128
+#define configTIMER_QUEUE_LENGTH                4
+#define configTIMER_TASK_STACK_DEPTH            192
 
 void vAssertCalled( char* file, uint32_t line);
 #define configASSERT( x )     if( ( x ) == 0 ) { vAssertCalled( __FILE__, __LINE__ );}
@@ -108,6 +108,7 @@ extern void vConfigureTimerForRunTimeStats( void );
 #define INCLUDE_vTaskDelay                      1
 #define INCLUDE_uxTaskGetStackHighWaterMark     1
 #define INCLUDE_xTaskGetCurrentTaskHandle       1
+#define INCLUDE_xTaskGetSchedulerState          1
 
 /* Use the system definition, if there is one */
 #ifdef __NVIC_PRIO_BITS
@@ -31,15 +31,20 @@
 
 #include "port.h"
 #include "lpc17_uart.h"
+#include "faults.h"
+
+/* Marks a valid context in the RTC general purpose registers, the low byte holds the fault type */
+#define FAULT_DUMP_MAGIC    0xFA17D000
+#define FAULT_DUMP_MASK     0xFFFFFF00
 
 static void uartb_send_str(const char *str);
 static void uint32_to_hexstr(char *buffer, uint32_t number);
 
 enum fault_type {
-    hardfault = 0,
-    memmanage = 1,
-    busfault = 2,
-    usagefault = 3
+    hardfault = FAULT_HARDFAULT,
+    memmanage = FAULT_MEMMANAGE,
+    busfault = FAULT_BUSFAULT,
+    usagefault = FAULT_USAGEFAULT
 };
 
 /*
@@ -90,6 +95,12 @@ void dump_registers(uint32_t *stack_addr, enum fault_type fault)
     pc = stack_addr[6];
     psr = stack_addr[7];
 
+    /* Keep the context across the coming (watchdog) reset */
+    Chip_Clock_EnablePeriphClock(SYSCTL_CLOCK_RTC);
+    LPC_RTC->GPREG[1] = pc;
+    LPC_RTC->GPREG[2] = lr;
+    LPC_RTC->GPREG[3] = psr;
+    LPC_RTC->GPREG[0] = FAULT_DUMP_MAGIC | fault;
 
     uartb_send_str("R0: 0x");
     uint32_to_hexstr(tmp_str, r0);
@@ -182,6 +193,31 @@ void UsageFault_Handler(void)
     );
 }
 
+bool fault_dump_pop(fault_dump_t *dump)
+{
+    Chip_Clock_EnablePeriphClock(SYSCTL_CLOCK_RTC);
+
+    if ((LPC_RTC->GPREG[0] & FAULT_DUMP_MASK) != FAULT_DUMP_MAGIC) {
+        return false;
+    }
+
+    dump->type = LPC_RTC->GPREG[0] & 0xFF;
+    dump->pc = LPC_RTC->GPREG[1];
+    dump->lr = LPC_RTC->GPREG[2];
+    dump->psr = LPC_RTC->GPREG[3];
+    LPC_RTC->GPREG[0] = 0;
+
+    return true;
+}
+
+uint32_t reset_cause_pop(void)
+{
+    uint32_t cause = Chip_SYSCTL_GetSystemRSTStatus();
+
+    Chip_SYSCTL_ClearSystemRSTStatus(cause);
+    return cause;
+}
+
 static void uartb_send_str(const char *str)
 {
     do {
@@ -0,0 +1,69 @@
+/*
+ *   Fault handlers
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * @file faults.h
+ *
+ * @brief ARM Cortex-M fault handlers and reset cause
+ *
+ * The fault handlers save the faulting context in the RTC general purpose registers, which keep their
+ * contents across resets, so it can be reported once the MMC is back up.
+ */
+
+#ifndef FAULTS_H_
+#define FAULTS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Fault types, as saved in #fault_dump_t
+ */
+enum {
+    FAULT_HARDFAULT = 0,
+    FAULT_MEMMANAGE = 1,
+    FAULT_BUSFAULT = 2,
+    FAULT_USAGEFAULT = 3
+};
+
+/**
+ * @brief Context saved by the last fault
+ */
+typedef struct fault_dump {
+    uint8_t type;       /**< Fault type */
+    uint32_t pc;        /**< Program counter */
+    uint32_t lr;        /**< Link register */
+    uint32_t psr;       /**< Program status register */
+} fault_dump_t;
+
+/**
+ * @brief Get the context saved by a fault before the last reset, and forget it
+ *
+ * @param[out] dump Saved context
+ *
+ * @return true if a fault was saved
+ */
+bool fault_dump_pop( fault_dump_t *dump );
+
+/**
+ * @brief Get the sources of the last reset, and clear them
+ *
+ * @return An Or'ed value of SYSCTL_RST_*, 0 for a software reset on LPC175x/6x (which has no flag for it)
+ */
+uint32_t reset_cause_pop( void );
+
+#endif
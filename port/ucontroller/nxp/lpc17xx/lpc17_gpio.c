@@ -0,0 +1,103 @@
+/*
+ *   openMMC -- Open Source modular IPM Controller firmware
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   @license GPL-3.0+ <http://spdx.org/licenses/GPL-3.0+>
+ */
+
+/*!
+ * @file lpc17_gpio.c
+ * @brief GPIO edge interrupts for LPC17xx
+ */
+
+#include "FreeRTOS.h"
+#include "port.h"
+#include "gpioint_17xx_40xx.h"
+
+typedef struct {
+    uint8_t port;
+    uint8_t pin;
+    gpio_int_callback_t callback;
+} gpio_int_cfg_t;
+
+static gpio_int_cfg_t gpio_int_cfg[GPIO_INT_MAX_CALLBACKS];
+static uint8_t gpio_int_count;
+
+static void gpio_int_dispatch( LPC_GPIOINT_PORT_T port, BaseType_t *higher_prio_woken )
+{
+    uint32_t status = Chip_GPIOINT_GetStatusRising( LPC_GPIOINT, port ) | Chip_GPIOINT_GetStatusFalling( LPC_GPIOINT, port );
+
+    if ( status == 0 ) {
+        return;
+    }
+
+    Chip_GPIOINT_ClearIntStatus( LPC_GPIOINT, port, status );
+
+    for ( uint8_t i = 0; i < gpio_int_count; i++ ) {
+        if ( ( gpio_int_cfg[i].port == port ) && ( status & ( 1 << gpio_int_cfg[i].pin ) ) ) {
+            gpio_int_cfg[i].callback( gpio_int_cfg[i].port, gpio_int_cfg[i].pin, higher_prio_woken );
+        }
+    }
+}
+
+/* GPIO interrupts of ports 0 and 2 share the EINT3 channel */
+void EINT3_IRQHandler( void )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    gpio_int_dispatch( GPIOINT_PORT0, &xHigherPriorityTaskWoken );
+    gpio_int_dispatch( GPIOINT_PORT2, &xHigherPriorityTaskWoken );
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+bool gpio_int_register( uint8_t port, uint8_t pin, gpio_int_callback_t callback )
+{
+#ifdef CHIP_LPC177X_8X
+    /* GPIO interrupts have their own vector on the LPC177x/8x, which is not handled yet */
+    return false;
+#else
+    LPC_GPIOINT_PORT_T int_port;
+
+    if ( port == 0 ) {
+        int_port = GPIOINT_PORT0;
+    } else if ( port == 2 ) {
+        int_port = GPIOINT_PORT2;
+    } else {
+        return false;
+    }
+
+    if ( ( callback == NULL ) || ( gpio_int_count >= GPIO_INT_MAX_CALLBACKS ) ) {
+        return false;
+    }
+
+    irq_disable( EINT3_IRQn );
+
+    gpio_int_cfg[gpio_int_count].port = int_port;
+    gpio_int_cfg[gpio_int_count].pin = pin;
+    gpio_int_cfg[gpio_int_count].callback = callback;
+    gpio_int_count++;
+
+    Chip_GPIOINT_ClearIntStatus( LPC_GPIOINT, int_port, ( 1 << pin ) );
+    Chip_GPIOINT_SetIntRising( LPC_GPIOINT, int_port, Chip_GPIOINT_GetIntRising( LPC_GPIOINT, int_port ) | ( 1 << pin ) );
+    Chip_GPIOINT_SetIntFalling( LPC_GPIOINT, int_port, Chip_GPIOINT_GetIntFalling( LPC_GPIOINT, int_port ) | ( 1 << pin ) );
+
+    /* Callbacks may use the FreeRTOS "FromISR" API */
+    irq_set_priority( EINT3_IRQn, configMAX_SYSCALL_INTERRUPT_PRIORITY );
+    irq_enable( EINT3_IRQn );
+
+    return true;
+#endif
+}
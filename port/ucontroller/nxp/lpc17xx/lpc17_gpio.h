@@ -29,6 +29,8 @@
 #define LPC17_GPIO_H_
 
 #include "gpio_17xx_40xx.h"
+#include "FreeRTOS.h"
+#include <stdbool.h>
 
 #define GPIO_LEVEL_LOW  0
 #define GPIO_LEVEL_HIGH 1
@@ -134,3 +136,27 @@
  * @return      Bitfield indicating all pins current direction (true (1) for OUTPUT, false (0) for INPUT )
  */
 #define gpio_get_port_dir( port )     Chip_GPIO_GetPortDIR( LPC_GPIO, port )
+
+/**
+ * @brief Maximum amount of GPIO edge callbacks that can be registered
+ */
+#define GPIO_INT_MAX_CALLBACKS      4
+
+/**
+ * @brief GPIO edge callback, called from the interrupt handler
+ *
+ * @param port                 GPIO Port number of the pin that changed
+ * @param pin                  GPIO pin number that changed
+ * @param higher_prio_woken    Set to pdTRUE if a higher priority task was woken by the callback
+ */
+typedef void (* gpio_int_callback_t)( uint8_t port, uint8_t pin, BaseType_t *higher_prio_woken );
+
+/**
+ * @brief       Call a function on every edge (rising and falling) of a GPIO pin
+ * @param       port     : GPIO Port number where pin is located
+ * @param       pin      : GPIO pin number
+ * @param       callback : Function to call from the interrupt handler
+ * @return      true if the edge interrupt was enabled, false if this pin cannot generate interrupts
+ *              (only ports 0 and 2 of the LPC175x/6x can) or there is no free callback slot
+ */
+bool gpio_int_register( uint8_t port, uint8_t pin, gpio_int_callback_t callback );
@@ -25,11 +25,38 @@
  * @brief I2C driver for LPC17xx
  */
 
+#include "FreeRTOS.h"
+#include "semphr.h"
 #include "port.h"
+#include "i2c.h"
 #include "string.h"
 
 #define SLAVE_MASK 0xFF
 
+/*
+ * Master transfer state
+ *
+ * The task that starts a transfer blocks on the bus' done semaphore, given by the I2C interrupt when the transfer ends.
+ * A semaphore is used instead of a task notification so the notifications of the calling task are left untouched.
+ * If the scheduler is not running yet (e.g. during board initialization), task is NULL and the transfer is polled instead.
+ */
+typedef struct i2c_master_state {
+    I2C_XFER_T *xfer;               /* Transfer in progress */
+    TaskHandle_t task;              /* Task waiting for the transfer */
+    SemaphoreHandle_t done;         /* Given when the transfer ends */
+    TickType_t timeout;             /* Maximum time the transfer may take */
+    uint32_t speed;                 /* Bus clock rate, used to estimate the transfer time */
+    i2c_master_stats_t stats;
+} i2c_master_state_t;
+
+static i2c_master_state_t i2c_master[I2C_NUM_INTERFACE];
+
+static LPC_I2C_T * const i2c_regs[I2C_NUM_INTERFACE] = { LPC_I2C0, LPC_I2C1, LPC_I2C2 };
+static const IRQn_Type i2c_irq[I2C_NUM_INTERFACE] = { I2C0_IRQn, I2C1_IRQn, I2C2_IRQn };
+
+static uint32_t i2c_backoff_seed;
+static uint8_t slave_own_addr;
+
 /* State machine handler for I2C0 and I2C1 */
 static void i2c_state_handling(I2C_ID_T id)
 {
@@ -59,6 +86,152 @@ void I2C2_IRQHandler(void)
     i2c_state_handling(I2C2);
 }
 
+/* Releases the bus and fails a master transfer that didn't finish in time */
+static void i2c_master_abort( I2C_ID_T id )
+{
+    i2c_master_state_t *master = &i2c_master[id];
+
+    NVIC_DisableIRQ( i2c_irq[id] );
+    if ( master->xfer->status == I2C_STATUS_BUSY ) {
+        i2c_regs[id]->CONSET = I2C_CON_STO;
+        i2c_regs[id]->CONCLR = I2C_CON_SI | I2C_CON_STA;
+        master->xfer->status = I2C_STATUS_BUSERR;
+        master->stats.timeouts++;
+    }
+    NVIC_EnableIRQ( i2c_irq[id] );
+}
+
+/* Blocks the calling task until the transfer ends, without spinning on its status */
+static void i2c_master_wait( I2C_ID_T id )
+{
+    i2c_master_state_t *master = &i2c_master[id];
+    volatile I2C_STATUS_T *stat = &master->xfer->status;
+    TickType_t remaining = master->timeout;
+    TimeOut_t time_out;
+
+    if ( master->task == NULL ) {
+        while ( *stat == I2C_STATUS_BUSY ) {}
+        return;
+    }
+
+    vTaskSetTimeOutState( &time_out );
+    while ( *stat == I2C_STATUS_BUSY ) {
+        if ( xTaskCheckForTimeOut( &time_out, &remaining ) == pdTRUE ) {
+            i2c_master_abort( id );
+            break;
+        }
+        xSemaphoreTake( master->done, remaining );
+    }
+
+    /* Drop the semaphore if the transfer ended before we blocked, so it doesn't wake up the next wait */
+    xSemaphoreTake( master->done, 0 );
+}
+
+/* Master event handler, replaces the lpcopen Chip_I2C_EventHandler which spins while the transfer is in progress */
+static void I2C_Master_Event( I2C_ID_T id, I2C_EVENT_T event )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    switch (event) {
+    case I2C_EVENT_WAIT:
+        i2c_master_wait( id );
+        break;
+    case I2C_EVENT_DONE:
+        /* Called from the I2C interrupt */
+        if ( i2c_master[id].task != NULL ) {
+            xSemaphoreGiveFromISR( i2c_master[id].done, &xHigherPriorityTaskWoken );
+            portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Random back-off (in ticks) after losing arbitration, so masters sharing the bus don't retry in lockstep */
+static TickType_t i2c_arblost_backoff( uint8_t attempt )
+{
+    uint32_t window = 1UL << attempt;
+
+    if ( i2c_backoff_seed == 0 ) {
+        /* Our own slave address differs between boards sharing the IPMB, so mix it into the seed */
+        i2c_backoff_seed = 0x9E3779B9 ^ ( (uint32_t) slave_own_addr << 24 ) ^ xTaskGetTickCount();
+    }
+
+    /* xorshift32 */
+    i2c_backoff_seed ^= i2c_backoff_seed << 13;
+    i2c_backoff_seed ^= i2c_backoff_seed >> 17;
+    i2c_backoff_seed ^= i2c_backoff_seed << 5;
+
+    if ( window > i2cARBLOST_BACKOFF_MAX ) {
+        window = i2cARBLOST_BACKOFF_MAX;
+    }
+
+    return 1 + ( i2c_backoff_seed % window );
+}
+
+/* Runs a master transfer, retrying a bounded number of times if the arbitration is lost */
+static int i2c_master_xfer( I2C_ID_T id, I2C_XFER_T *xfer )
+{
+    i2c_master_state_t *master = &i2c_master[id];
+    const uint8_t *tx_buff = xfer->txBuff;
+    int tx_len = xfer->txSz;
+    uint8_t *rx_buff = xfer->rxBuff;
+    int rx_len = xfer->rxSz;
+    bool scheduler_running = ( xTaskGetSchedulerState() == taskSCHEDULER_RUNNING );
+    int status;
+
+    /* 9 clock cycles per byte (plus the address bytes), doubled to allow for clock stretching and slave traffic */
+    master->timeout = i2cMASTER_XFER_TIMEOUT + pdMS_TO_TICKS( ( 2 * 1000 * 9 * ( tx_len + rx_len + 2 ) ) / master->speed );
+
+    for ( uint8_t attempt = 0; ; attempt++ ) {
+        master->xfer = xfer;
+        master->task = ( scheduler_running && ( master->done != NULL ) ) ? xTaskGetCurrentTaskHandle() : NULL;
+        master->stats.xfers++;
+
+        status = Chip_I2C_MasterTransfer( id, xfer );
+
+        master->task = NULL;
+
+        if ( status == I2C_STATUS_NAK ) {
+            master->stats.naks++;
+        }
+
+        if ( ( status != I2C_STATUS_ARBLOST ) || ( attempt >= i2cMAX_ARBLOST_RETRIES ) ) {
+            break;
+        }
+
+        master->stats.arblost++;
+
+        /* Restart the whole transfer, the lost one may have moved the buffer pointers */
+        xfer->txBuff = tx_buff;
+        xfer->txSz = tx_len;
+        xfer->rxBuff = rx_buff;
+        xfer->rxSz = rx_len;
+
+        if ( scheduler_running ) {
+            vTaskDelay( i2c_arblost_backoff( attempt ) );
+        }
+    }
+
+    /*
+     * After a bus error, a timeout abort or a lost arbitration (another master may have written it) the mux channel
+     * is unknown, whether the transfer came through i2c_transfer() or straight from a driver
+     */
+    if ( ( status == I2C_STATUS_BUSERR ) || ( status == I2C_STATUS_ARBLOST ) ) {
+        i2c_mux_invalidate( id );
+    }
+
+    return status;
+}
+
+void vI2CMasterGetStats( I2C_ID_T id, i2c_master_stats_t * stats )
+{
+    taskENTER_CRITICAL();
+    *stats = i2c_master[id].stats;
+    taskEXIT_CRITICAL();
+}
+
 void vI2CConfig( I2C_ID_T id, uint32_t speed )
 {
     IRQn_Type irq;
@@ -91,53 +264,104 @@ void vI2CConfig( I2C_ID_T id, uint32_t speed )
         return;
     }
 
+    if ( i2c_master[id].done == NULL ) {
+        i2c_master[id].done = xSemaphoreCreateBinary();
+    }
+
     Chip_I2C_Init(id);
     Chip_I2C_SetClockRate(id, speed);
     NVIC_SetPriority( irq, configMAX_SYSCALL_INTERRUPT_PRIORITY -1 );
     NVIC_EnableIRQ( irq );
     Chip_I2C_Enable( id );
 
-    Chip_I2C_SetMasterEventHandler(id, Chip_I2C_EventHandler);
+    i2c_master[id].speed = speed;
+    Chip_I2C_SetMasterEventHandler(id, I2C_Master_Event);
 }
 
+/*
+ * Slave receive ring
+ *
+ * Frames are written by I2C_Slave_Event straight into the slot at slave_ring_head, which is always reserved for the next reception.
+ * Slots from slave_ring_tail up to slave_ring_head-1 hold complete frames waiting to be read by the task blocked on xI2CSlaveReceive.
+ * If no free slot is left when a frame completes, the frame is dropped and counted as an overrun.
+ */
 static TaskHandle_t slave_task_id;
 I2C_XFER_T slave_cfg;
 I2C_XFER_T slave_dummy;
-uint8_t recv_msg[i2cMAX_MSG_LENGTH];
+static i2c_slave_frame_t slave_ring[i2cSLAVE_RING_LEN];
+static volatile uint8_t slave_ring_head;
+static volatile uint8_t slave_ring_tail;
+static i2c_slave_stats_t slave_stats;
 uint8_t recv_msg_dummy[i2cMAX_MSG_LENGTH];
-uint8_t recv_bytes;
 
-uint8_t xI2CSlaveReceive( I2C_ID_T id, uint8_t * rx_buff, uint8_t buff_len, uint32_t timeout )
+uint8_t xI2CSlaveReceive( I2C_ID_T id, uint8_t ** rx_buff, uint32_t timeout )
 {
-    uint8_t bytes_to_copy = 0;
+    i2c_slave_frame_t *frame;
+
     slave_task_id = xTaskGetCurrentTaskHandle();
 
-    if ( ulTaskNotifyTake( pdTRUE, timeout ) == pdTRUE )
-    {
-        if (recv_bytes > buff_len) {
-            bytes_to_copy = buff_len;
-        } else {
-            bytes_to_copy = recv_bytes;
+    while ( slave_ring_head == slave_ring_tail ) {
+        if ( ulTaskNotifyTake( pdTRUE, timeout ) == 0 ) {
+            return 0;
         }
-        /* Copy the rx buffer to the pointer given */
-        memcpy( rx_buff, &recv_msg[0], bytes_to_copy );
-        return bytes_to_copy;
-    } else {
-        return 0;
+    }
+
+    /* Hand out the oldest frame in place, it stays reserved until vI2CSlaveRelease is called */
+    frame = &slave_ring[slave_ring_tail % i2cSLAVE_RING_LEN];
+    *rx_buff = &frame->data[0];
+    return frame->len;
+}
+
+void vI2CSlaveRelease( I2C_ID_T id )
+{
+    if ( slave_ring_head != slave_ring_tail ) {
+        slave_ring_tail++;
     }
 }
 
+void vI2CSlaveGetStats( I2C_ID_T id, i2c_slave_stats_t * stats )
+{
+    taskENTER_CRITICAL();
+    *stats = slave_stats;
+    taskEXIT_CRITICAL();
+}
+
 static void I2C_Slave_Event(I2C_ID_T id, I2C_EVENT_T event)
 {
     static BaseType_t xHigherPriorityTaskWoken;
+    i2c_slave_frame_t *frame;
+    uint8_t pending;
+
     switch (event) {
     case I2C_EVENT_DONE:
-        recv_bytes = i2cMAX_MSG_LENGTH - slave_cfg.rxSz;
-        slave_cfg.rxSz = i2cMAX_MSG_LENGTH;
-        slave_cfg.rxBuff = &recv_msg[0];
+        frame = &slave_ring[slave_ring_head % i2cSLAVE_RING_LEN];
+        frame->len = i2cMAX_MSG_LENGTH - slave_cfg.rxSz;
+
+        if ( frame->len > 0 ) {
+            /* Keep the address byte, so the slot holds the whole frame as seen on the bus */
+            frame->data[0] = slave_own_addr;
+            frame->len++;
+            frame->timestamp = xTaskGetTickCountFromISR();
+            slave_stats.frames++;
 
-        vTaskNotifyGiveFromISR( slave_task_id, &xHigherPriorityTaskWoken );
-        portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+            pending = slave_ring_head + 1 - slave_ring_tail;
+            /* The slot after the new head must be free to receive the next frame */
+            if ( pending < i2cSLAVE_RING_LEN ) {
+                slave_ring_head++;
+                if ( pending > slave_stats.max_pending ) {
+                    slave_stats.max_pending = pending;
+                }
+                xHigherPriorityTaskWoken = pdFALSE;
+                vTaskNotifyGiveFromISR( slave_task_id, &xHigherPriorityTaskWoken );
+                portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+            } else {
+                slave_stats.overruns++;
+            }
+        }
+
+        slave_cfg.rxSz = i2cMAX_MSG_LENGTH;
+        slave_cfg.rxBuff = &slave_ring[slave_ring_head % i2cSLAVE_RING_LEN].data[1];
+        break;
 
     case I2C_EVENT_SLAVE_RX:
         break;
@@ -158,11 +382,12 @@ void vI2CSlaveSetup ( I2C_ID_T id, uint8_t slave_addr )
 {
     /* expects i2c addr < 0x80 */
     slave_addr <<= 1;
+    slave_own_addr = slave_addr;
     slave_cfg.slaveAddr = slave_addr;
     slave_cfg.txBuff = NULL; /* Not using Slave transmitter right now */
     slave_cfg.txSz = 0;
-    slave_cfg.rxBuff = &recv_msg[0];
-    slave_cfg.rxSz = (sizeof(recv_msg)/sizeof(recv_msg[0]));
+    slave_cfg.rxBuff = &slave_ring[slave_ring_head % i2cSLAVE_RING_LEN].data[1];
+    slave_cfg.rxSz = i2cMAX_MSG_LENGTH;
     Chip_I2C_SlaveSetup( id, I2C_SLAVE_0, &slave_cfg, I2C_Slave_Event, SLAVE_MASK);
 
     slave_dummy.slaveAddr = 0;
@@ -181,6 +406,26 @@ int xI2CMasterWriteRead(I2C_ID_T id, uint8_t addr, const uint8_t *tx_buff, int t
     xfer.txSz = tx_len;
     xfer.rxBuff = rx_buff;
     xfer.rxSz = rx_len;
-    while (Chip_I2C_MasterTransfer(id, &xfer) == I2C_STATUS_ARBLOST) {}
+    i2c_master_xfer(id, &xfer);
+    return rx_len - xfer.rxSz;
+}
+
+int xI2CMasterWrite(I2C_ID_T id, uint8_t addr, const uint8_t *tx_buff, int tx_len)
+{
+    I2C_XFER_T xfer = {0};
+    xfer.slaveAddr = addr;
+    xfer.txBuff = tx_buff;
+    xfer.txSz = tx_len;
+    i2c_master_xfer(id, &xfer);
+    return tx_len - xfer.txSz;
+}
+
+int xI2CMasterRead(I2C_ID_T id, uint8_t addr, uint8_t *rx_buff, int rx_len)
+{
+    I2C_XFER_T xfer = {0};
+    xfer.slaveAddr = addr;
+    xfer.rxBuff = rx_buff;
+    xfer.rxSz = rx_len;
+    i2c_master_xfer(id, &xfer);
     return rx_len - xfer.rxSz;
 }
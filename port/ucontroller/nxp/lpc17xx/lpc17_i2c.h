@@ -28,10 +28,89 @@
 /*! @brief Max message length (in bits) used in I2C */
 #define i2cMAX_MSG_LENGTH               32
 
-#define xI2CMasterWrite(id, addr, tx_buff, tx_len) Chip_I2C_MasterSend(id, addr, tx_buff, tx_len)
-#define xI2CMasterRead(id, addr, rx_buff, rx_len) Chip_I2C_MasterRead(id, addr, rx_buff, rx_len)
+/*! @brief Fixed part of the master transfer timeout (the time on the wire is added for each transfer) */
+#define i2cMASTER_XFER_TIMEOUT          (10/portTICK_PERIOD_MS)
 
-uint8_t xI2CSlaveReceive( I2C_ID_T id, uint8_t * rx_buff, uint8_t buff_len, uint32_t timeout );
+/*! @brief Maximum retries of a master transfer that lost the bus arbitration */
+#define i2cMAX_ARBLOST_RETRIES          5
+
+/*! @brief Upper limit (in ticks) of the random back-off after losing the bus arbitration */
+#define i2cARBLOST_BACKOFF_MAX          8
+
+/*! @brief I2C master statistics */
+typedef struct i2c_master_stats {
+    uint32_t xfers;                     /*!< Transfers started, including retries */
+    uint32_t arblost;                   /*!< Transfers retried after losing the bus arbitration */
+    uint32_t naks;                      /*!< Transfers not acknowledged by the slave */
+    uint32_t timeouts;                  /*!< Transfers aborted because they didn't finish in time */
+} i2c_master_stats_t;
+
+/*! @brief Amount of frames in the I2C slave receive ring (one slot is always reserved for the frame being received) */
+#define i2cSLAVE_RING_LEN               4
+
+/*! @brief Frame stored in the I2C slave receive ring */
+typedef struct i2c_slave_frame {
+    uint8_t data[i2cMAX_MSG_LENGTH+1];  /*!< Frame bytes, starting with the own slave address byte (8-bit format) */
+    uint8_t len;                        /*!< Amount of valid bytes in data, including the address byte */
+    uint32_t timestamp;                 /*!< Tick count when the frame was completed */
+} i2c_slave_frame_t;
+
+/*! @brief I2C slave receiver statistics */
+typedef struct i2c_slave_stats {
+    uint32_t frames;                    /*!< Frames received */
+    uint32_t overruns;                  /*!< Frames dropped because the ring was full */
+    uint8_t max_pending;                /*!< Highest amount of frames waiting to be read */
+} i2c_slave_stats_t;
+
+/*!
+ * @brief Waits for a frame received by the I2C slave
+ *
+ * The frame is not copied: a pointer to its ring slot is returned and the slot stays reserved until vI2CSlaveRelease() is called.
+ *
+ * @param[in] id I2C interface
+ * @param[out] rx_buff Pointer to the frame bytes, starting with the own slave address byte
+ * @param[in] timeout Ticks to wait for a frame
+ *
+ * @return Frame length (including the address byte) or 0 if no frame was received in time
+ */
+uint8_t xI2CSlaveReceive( I2C_ID_T id, uint8_t ** rx_buff, uint32_t timeout );
+
+/*!
+ * @brief Releases the oldest frame returned by xI2CSlaveReceive(), so its slot can receive new data
+ */
+void vI2CSlaveRelease( I2C_ID_T id );
+
+/*!
+ * @brief Reads the I2C slave receiver statistics
+ */
+void vI2CSlaveGetStats( I2C_ID_T id, i2c_slave_stats_t * stats );
 void vI2CSlaveSetup ( I2C_ID_T id, uint8_t slave_addr );
 void vI2CConfig( I2C_ID_T id, uint32_t speed );
+/*!
+ * @brief Writes and then reads (after a repeated start) from an I2C slave
+ *
+ * The calling task blocks until the transfer ends, times out or fails, without holding the CPU.
+ * If the bus arbitration is lost, the transfer is retried after a random back-off, at most #i2cMAX_ARBLOST_RETRIES times.
+ *
+ * @return Amount of bytes read
+ */
 int xI2CMasterWriteRead(I2C_ID_T id, uint8_t addr, const uint8_t *tx_buff, int tx_len, uint8_t *rx_buff, int rx_len);
+
+/*!
+ * @brief Writes to an I2C slave, see xI2CMasterWriteRead()
+ *
+ * @return Amount of bytes written
+ */
+int xI2CMasterWrite(I2C_ID_T id, uint8_t addr, const uint8_t *tx_buff, int tx_len);
+
+/*!
+ * @brief Reads from an I2C slave, see xI2CMasterWriteRead()
+ *
+ * @return Amount of bytes read
+ */
+int xI2CMasterRead(I2C_ID_T id, uint8_t addr, uint8_t *rx_buff, int rx_len);
+
+/*!
+ * @brief Reads the I2C master statistics of a bus
+ */
+void vI2CMasterGetStats( I2C_ID_T id, i2c_master_stats_t * stats );
@@ -31,48 +31,96 @@
 #include "string.h"
 #include "pin_mapping.h"
 
+#ifdef CHIP_LPC177X_8X
+#define SSP_DMA_RAM(addr)       ( ( ( (addr) >= 0x10000000 ) && ( (addr) < 0x10010000 ) ) || \
+                                  ( ( (addr) >= 0x20000000 ) && ( (addr) < 0x20008000 ) ) )
+#else
+/* The GPDMA controller can't reach the local SRAM of the LPC175x/6x, only the AHB SRAM (where port.c places the FreeRTOS heap) */
+#define SSP_DMA_RAM(addr)       ( ( (addr) >= 0x2007C000 ) && ( (addr) < 0x20084000 ) )
+#endif
+
 static ssp_config_t ssp_cfg[MAX_SSP_INTERFACES] = {
     [FPGA_SPI] = {
         .lpc_id = LPC_SSP0,
         .irq = SSP0_IRQn,
         .ssel_pin = SSP0_SSEL,
+        .dma_tx_conn = GPDMA_CONN_SSP0_Tx,
+        .dma_rx_conn = GPDMA_CONN_SSP0_Rx,
+        .dma_tx_ch = 1,
+        .dma_rx_ch = 0,
     },
     [FLASH_SPI] = {
         .lpc_id = LPC_SSP1,
         .irq = SSP1_IRQn,
         .ssel_pin = SSP1_SSEL,
+        .dma_tx_conn = GPDMA_CONN_SSP1_Tx,
+        .dma_rx_conn = GPDMA_CONN_SSP1_Rx,
+        .dma_tx_ch = 3,
+        .dma_rx_ch = 2,
     }
 };
 
+/*
+ * Source of the dummy frames ([0]) and sink of the discarded ones ([1]). They must be reachable by the GPDMA controller,
+ * so they are taken from the FreeRTOS heap instead of growing the (full) AHB SRAM sections.
+ */
+static uint16_t * ssp_dma_dummy;
+
+/**
+ * @brief Moves frames between the FIFOs and the transfer buffers, without ever blocking
+ *
+ * The TX FIFO is never allowed to run more than #SSP_FIFO_DEPTH frames ahead of the RX FIFO, so the latter can't overflow.
+ */
+static void ssp_rw_frames( ssp_config_t * cfg )
+{
+    LPC_SSP_T * ssp = cfg->lpc_id;
+    uint8_t step = ( cfg->frame_size > 8 ) ? 2 : 1;
+    uint16_t frame;
+
+    while ( Chip_SSP_GetStatus( ssp, SSP_STAT_RNE ) && ( cfg->rx_cnt < cfg->length ) ) {
+        frame = Chip_SSP_ReceiveFrame( ssp );
+        if ( cfg->rx_buf ) {
+            cfg->rx_buf[cfg->rx_cnt] = frame & 0xFF;
+            if ( step == 2 ) {
+                cfg->rx_buf[cfg->rx_cnt + 1] = frame >> 8;
+            }
+        }
+        cfg->rx_cnt += step;
+    }
+
+    while ( ( cfg->tx_cnt < cfg->length ) && ( cfg->tx_cnt - cfg->rx_cnt < SSP_FIFO_DEPTH * step ) &&
+            Chip_SSP_GetStatus( ssp, SSP_STAT_TNF ) ) {
+        frame = 0xFFFF;
+        if ( cfg->tx_cnt < cfg->tx_len ) {
+            frame = cfg->tx_buf[cfg->tx_cnt];
+            if ( step == 2 ) {
+                frame |= cfg->tx_buf[cfg->tx_cnt + 1] << 8;
+            }
+        }
+        Chip_SSP_SendFrame( ssp, frame );
+        cfg->tx_cnt += step;
+    }
+}
+
 static void ssp_irq_handler( LPC_SSP_T * ssp_id )
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    Chip_SSP_DATA_SETUP_T * xf_setup;
     uint8_t ssp_cfg_index;
 
     ssp_cfg_index = (ssp_id == LPC_SSP0) ? 0 : 1;
 
-    xf_setup = &ssp_cfg[ssp_cfg_index].xf_setup;
-
     /* Disable SSP interrupts */
     Chip_SSP_Int_Disable(ssp_id);
 
-    if (ssp_cfg[ssp_cfg_index].frame_size <= 8) {
-        Chip_SSP_Int_RWFrames8Bits(ssp_id, xf_setup);
-    }
-    else {
-        Chip_SSP_Int_RWFrames16Bits(ssp_id, xf_setup);
-    }
+    ssp_rw_frames(&ssp_cfg[ssp_cfg_index]);
 
-    if ((xf_setup->rx_cnt != xf_setup->length) || (xf_setup->tx_cnt != xf_setup->length)) {
+    if (ssp_cfg[ssp_cfg_index].rx_cnt < ssp_cfg[ssp_cfg_index].length) {
         /* Enable ssp interrupts, we're going to read/write more data */
         Chip_SSP_Int_Enable(ssp_id);
     }
     else {
         /* Transfer is completed, notify the caller task */
         vTaskNotifyGiveFromISR(ssp_cfg[ssp_cfg_index].caller_task, &xHigherPriorityTaskWoken);
-        /* Deassert SSEL pin */
-        ssp_ssel_control(ssp_cfg_index, DEASSERT);
     }
 
     portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
@@ -88,6 +136,32 @@ void SSP1_IRQHandler( void )
     ssp_irq_handler(LPC_SSP1);
 }
 
+void DMA_IRQHandler( void )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t tc = LPC_GPDMA->INTTCSTAT;
+    uint32_t err = LPC_GPDMA->INTERRSTAT;
+    uint32_t mask;
+
+    LPC_GPDMA->INTTCCLEAR = tc;
+    LPC_GPDMA->INTERRCLR = err;
+
+    for (uint8_t i = 0; i < MAX_SSP_INTERFACES; i++) {
+        mask = (1 << ssp_cfg[i].dma_tx_ch) | (1 << ssp_cfg[i].dma_rx_ch);
+
+        if (err & mask) {
+            ssp_cfg[i].dma_error = true;
+        }
+
+        /* Every frame was received once the RX channel is done */
+        if (((tc & (1 << ssp_cfg[i].dma_rx_ch)) || (err & mask)) && (ssp_cfg[i].caller_task != NULL)) {
+            vTaskNotifyGiveFromISR(ssp_cfg[i].caller_task, &xHigherPriorityTaskWoken);
+        }
+    }
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
 /*! @brief Function that controls the Slave Select (SSEL) signal
  * This pin is controlled manually because the internal SSP driver resets the SSEL pin every 8 bits that are transfered
  */
@@ -96,9 +170,9 @@ void ssp_ssel_control( uint8_t id, uint8_t state )
     gpio_set_pin_state( PIN_PORT(ssp_cfg[id].ssel_pin), PIN_NUMBER(ssp_cfg[id].ssel_pin), state );
 }
 
-void ssp_init( uint8_t id, uint32_t bitrate, uint8_t frame_sz, bool master_mode, bool poll )
+void ssp_init( uint8_t id, uint32_t bitrate, uint8_t frame_sz, bool master_mode, uint8_t mode )
 {
-    ssp_cfg[id].polling = poll;
+    ssp_cfg[id].mode = mode;
     ssp_cfg[id].frame_size = frame_sz;
 
     /* Set up clock and muxing for SSP0/1 interface */
@@ -110,12 +184,29 @@ void ssp_init( uint8_t id, uint32_t bitrate, uint8_t frame_sz, bool master_mode,
     Chip_SSP_SetFormat(ssp_cfg[id].lpc_id, (frame_sz-1), SSP_FRAMEFORMAT_SPI, SSP_CLOCK_CPHA0_CPOL0);
     Chip_SSP_Enable(ssp_cfg[id].lpc_id);
 
-    if (!poll) {
+    if (mode == SSP_INTERRUPT) {
         /* Configure interruption priority and enable it */
         NVIC_SetPriority( ssp_cfg[id].irq, configMAX_SYSCALL_INTERRUPT_PRIORITY );
         NVIC_EnableIRQ( ssp_cfg[id].irq );
+    } else if (mode == SSP_DMA) {
+        Chip_GPDMA_Init(LPC_GPDMA);
+
+        /* Chip_GPDMA_Init() only powers the controller up, the channels are programmed directly so enable it here */
+        LPC_GPDMA->CONFIG = GPDMA_DMACConfig_E;
+        while (!(LPC_GPDMA->CONFIG & GPDMA_DMACConfig_E)) {}
+
+        /* Shared by every SSP interface, the transfers fall back to polling if it can't be allocated */
+        if (ssp_dma_dummy == NULL) {
+            ssp_dma_dummy = pvPortMalloc( 2 * sizeof(uint16_t) );
+        }
+
+        NVIC_SetPriority( DMA_IRQn, configMAX_SYSCALL_INTERRUPT_PRIORITY );
+        NVIC_EnableIRQ( DMA_IRQn );
     }
 
+    /* Transfer times are measured with the cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
 void ssp_ssel_init( void ) {
@@ -124,44 +215,171 @@ void ssp_ssel_init( void ) {
     }
 }
 
-uint8_t *tx_ssp;
-uint8_t *rx_ssp;
+static void ssp_dma_start( uint8_t ch, uint32_t src, uint32_t dst, uint32_t control, uint32_t config )
+{
+    GPDMA_CH_T * dma_ch = &LPC_GPDMA->CH[ch];
+
+    LPC_GPDMA->INTTCCLEAR = (1 << ch);
+    LPC_GPDMA->INTERRCLR = (1 << ch);
+
+    dma_ch->SRCADDR = src;
+    dma_ch->DESTADDR = dst;
+    dma_ch->LLI = 0;
+    dma_ch->CONTROL = control;
+    dma_ch->CONFIG = config | GPDMA_DMACCxConfig_E;
+}
+
+static void ssp_dma_stop( ssp_config_t * cfg )
+{
+    LPC_GPDMA->CH[cfg->dma_tx_ch].CONFIG &= ~GPDMA_DMACCxConfig_E;
+    LPC_GPDMA->CH[cfg->dma_rx_ch].CONFIG &= ~GPDMA_DMACCxConfig_E;
+    Chip_SSP_DMA_Disable(cfg->lpc_id);
+}
+
+/**
+ * @brief Runs a transfer through the GPDMA controller
+ *
+ * The sent bytes and the dummy frames come from different sources, so they are moved by separate DMA transfers,
+ * each one of at most #SSP_DMA_MAX_FRAMES frames.
+ *
+ * @return false on timeout or DMA error
+ */
+static bool ssp_dma_transfer( ssp_config_t * cfg, uint32_t timeout )
+{
+    uint8_t step = ( cfg->frame_size > 8 ) ? 2 : 1;
+    uint32_t width = ( step == 2 ) ? GPDMA_WIDTH_HALFWORD : GPDMA_WIDTH_BYTE;
+    uint32_t control = GPDMA_DMACCxControl_SBSize(GPDMA_BSIZE_4) | GPDMA_DMACCxControl_DBSize(GPDMA_BSIZE_4) |
+        GPDMA_DMACCxControl_SWidth(width) | GPDMA_DMACCxControl_DWidth(width);
+    uint32_t offset = 0;
+    uint32_t end, frames;
+    uint32_t tx_src, rx_dst;
+    uint32_t tx_control, rx_control;
+
+    cfg->dma_error = false;
+    Chip_SSP_Int_FlushData(cfg->lpc_id);
+    Chip_SSP_DMA_Enable(cfg->lpc_id);
+
+    while (offset < cfg->length) {
+        end = (offset < cfg->tx_len) ? cfg->tx_len : cfg->length;
+        frames = (end - offset) / step;
+        if (frames > SSP_DMA_MAX_FRAMES) {
+            frames = SSP_DMA_MAX_FRAMES;
+        }
+
+        tx_control = control | GPDMA_DMACCxControl_TransferSize(frames);
+        rx_control = control | GPDMA_DMACCxControl_TransferSize(frames) | GPDMA_DMACCxControl_I;
+
+        if (offset < cfg->tx_len) {
+            tx_src = (uint32_t) &cfg->tx_buf[offset];
+            tx_control |= GPDMA_DMACCxControl_SI;
+        } else {
+            ssp_dma_dummy[0] = 0xFFFF;
+            tx_src = (uint32_t) &ssp_dma_dummy[0];
+        }
+
+        if (cfg->rx_buf) {
+            rx_dst = (uint32_t) &cfg->rx_buf[offset];
+            rx_control |= GPDMA_DMACCxControl_DI;
+        } else {
+            rx_dst = (uint32_t) &ssp_dma_dummy[1];
+        }
+
+        /* Start receiving first, so that no frame is missed */
+        ssp_dma_start(cfg->dma_rx_ch, (uint32_t) &cfg->lpc_id->DR, rx_dst, rx_control,
+                      GPDMA_DMACCxConfig_SrcPeripheral(cfg->dma_rx_conn) | GPDMA_DMACCxConfig_TransferType(GPDMA_TRANSFERTYPE_P2M_CONTROLLER_DMA) |
+                      GPDMA_DMACCxConfig_IE | GPDMA_DMACCxConfig_ITC);
+        ssp_dma_start(cfg->dma_tx_ch, tx_src, (uint32_t) &cfg->lpc_id->DR, tx_control,
+                      GPDMA_DMACCxConfig_DestPeripheral(cfg->dma_tx_conn) | GPDMA_DMACCxConfig_TransferType(GPDMA_TRANSFERTYPE_M2P_CONTROLLER_DMA) |
+                      GPDMA_DMACCxConfig_IE);
+
+        if ((ulTaskNotifyTake(pdTRUE, timeout) == 0) || cfg->dma_error) {
+            ssp_dma_stop(cfg);
+            return false;
+        }
+
+        offset += frames * step;
+    }
+
+    Chip_SSP_DMA_Disable(cfg->lpc_id);
+    return true;
+}
 
 void ssp_write_read( uint8_t id, uint8_t *tx_buf, uint32_t tx_len, uint8_t *rx_buf, uint32_t rx_len, uint32_t timeout )
 {
-    Chip_SSP_DATA_SETUP_T * data_st = &ssp_cfg[id].xf_setup;
+    ssp_config_t * cfg = &ssp_cfg[id];
+    uint32_t length = tx_len + rx_len;
+    uint32_t start;
+    bool done = true;
+    uint8_t bucket;
+    bool dma;
 
-    tx_ssp = pvPortMalloc(tx_len);
-    rx_ssp = pvPortMalloc(rx_len+tx_len);
+    cfg->caller_task = xTaskGetCurrentTaskHandle();
+    cfg->tx_buf = tx_buf;
+    cfg->rx_buf = rx_buf;
+    cfg->tx_len = (tx_buf != NULL) ? tx_len : 0;
+    cfg->length = length;
+    cfg->tx_cnt = 0;
+    cfg->rx_cnt = 0;
 
-    memcpy(tx_ssp, tx_buf, tx_len);
+    /* Buffers out of the reach of the DMA controller, and short transfers, are polled */
+    dma = (cfg->mode == SSP_DMA) && (ssp_dma_dummy != NULL) && (length >= SSP_DMA_MIN_LEN) &&
+        ((cfg->tx_len == 0) || SSP_DMA_RAM((uint32_t) tx_buf)) && ((rx_buf == NULL) || SSP_DMA_RAM((uint32_t) rx_buf));
 
-    ssp_cfg[id].caller_task = xTaskGetCurrentTaskHandle();
-    data_st->tx_cnt = 0;
-    data_st->rx_cnt = 0;
-    data_st->tx_data = tx_ssp;
-    data_st->rx_data = rx_ssp;
-    data_st->length = rx_len+tx_len;
+    start = DWT->CYCCNT;
 
     /* Assert Slave Select pin to enable the transfer */
     ssp_ssel_control(id, ASSERT);
 
-    if (ssp_cfg[id].polling) {
-        Chip_SSP_RWFrames_Blocking(ssp_cfg[id].lpc_id, data_st);
-        ssp_ssel_control(id, DEASSERT);
-    } else {
-        Chip_SSP_Int_FlushData(ssp_cfg[id].lpc_id);
+    if (dma) {
+        done = ssp_dma_transfer(cfg, timeout);
+        cfg->stats.dma_transfers++;
+    } else if (cfg->mode == SSP_INTERRUPT) {
+        Chip_SSP_Int_FlushData(cfg->lpc_id);
 
         /* Enable interrupt-based data transmission */
-        Chip_SSP_Int_Enable( ssp_cfg[id].lpc_id );
+        Chip_SSP_Int_Enable(cfg->lpc_id);
 
-        /* User defined timeout ? */
         /* Wait until the transfer is finished */
-        ulTaskNotifyTake(pdTRUE, timeout);
+        if (ulTaskNotifyTake(pdTRUE, timeout) == 0) {
+            /* Stop the interrupt handler before the buffers go back to the caller */
+            Chip_SSP_Int_Disable(cfg->lpc_id);
+            done = false;
+        }
+    } else {
+        Chip_SSP_Int_FlushData(cfg->lpc_id);
+
+        while (cfg->rx_cnt < cfg->length) {
+            ssp_rw_frames(cfg);
+        }
     }
-    if (rx_buf && rx_len > 0) {
-        memcpy(rx_buf, rx_ssp, rx_len+tx_len);
+
+    ssp_ssel_control(id, DEASSERT);
+
+    cfg->caller_task = NULL;
+
+    if (!done) {
+        cfg->stats.timeouts++;
+        return;
+    }
+
+    for (bucket = 0; (bucket < SSP_STATS_BUCKETS - 1) && (length >= SSP_STATS_BUCKET_LIMIT(bucket)); bucket++);
+
+    cfg->stats.transfers[bucket]++;
+    cfg->stats.bytes[bucket] += length;
+    cfg->stats.cycles[bucket] += DWT->CYCCNT - start;
+}
+
+const ssp_stats_t * ssp_get_stats( uint8_t id )
+{
+    if (id >= MAX_SSP_INTERFACES) {
+        return NULL;
+    }
+    return &ssp_cfg[id].stats;
+}
+
+void ssp_reset_stats( uint8_t id )
+{
+    if (id < MAX_SSP_INTERFACES) {
+        memset(&ssp_cfg[id].stats, 0, sizeof(ssp_stats_t));
     }
-    vPortFree(rx_ssp);
-    vPortFree(tx_ssp);
 }
@@ -34,6 +34,7 @@
 #endif
 
 #include "ssp_17xx_40xx.h"
+#include "gpdma_17xx_40xx.h"
 #include "FreeRTOS.h"
 #include "task.h"
 
@@ -51,6 +52,45 @@
 #define SSP_MASTER       1
 #define SSP_INTERRUPT    0
 #define SSP_POLLING      1
+#define SSP_DMA          2
+
+/**
+ * @brief Transfers shorter than this (in bytes) are polled in #SSP_DMA mode, setting up the DMA channels would take longer
+ */
+#define SSP_DMA_MIN_LEN         16
+
+/**
+ * @brief Maximum amount of frames moved by a single DMA transfer (size of the GPDMA transfer counter)
+ */
+#define SSP_DMA_MAX_FRAMES      4095
+
+/**
+ * @brief Depth of the SSP FIFOs (in frames)
+ */
+#define SSP_FIFO_DEPTH          8
+
+/**
+ * @brief Amount of transfer size buckets in #ssp_stats_t
+ */
+#define SSP_STATS_BUCKETS       5
+
+/**
+ * @brief Upper limit (exclusive, in bytes) of the transfer sizes counted in a bucket of #ssp_stats_t
+ */
+#define SSP_STATS_BUCKET_LIMIT(n)   ( 16UL << ( 2 * (n) ) )
+
+/**
+ * @brief Transfer statistics of an SSP interface, by transfer size
+ *
+ * Bucket n counts the transfers shorter than SSP_STATS_BUCKET_LIMIT(n) bytes, the last one counts every longer transfer.
+ */
+typedef struct ssp_stats {
+    uint32_t transfers[SSP_STATS_BUCKETS];  /**< Completed transfers */
+    uint32_t bytes[SSP_STATS_BUCKETS];      /**< Bytes moved (sent and received frames count once) */
+    uint32_t cycles[SSP_STATS_BUCKETS];     /**< CPU cycles spent from the SSEL assertion to the end of the transfer */
+    uint32_t dma_transfers;                 /**< Transfers done by the DMA controller */
+    uint32_t timeouts;                      /**< Transfers aborted on timeout */
+} ssp_stats_t;
 
 /**
  * @brief Slave select states
@@ -67,22 +107,71 @@ typedef struct ssp_config {
     LPC_SSP_T * lpc_id;
     IRQn_Type irq;
     uint32_t ssel_pin;
-    uint8_t polling;
+    uint8_t dma_tx_conn;            /**< GPDMA request line of the TX FIFO */
+    uint8_t dma_rx_conn;            /**< GPDMA request line of the RX FIFO */
+    uint8_t dma_tx_ch;              /**< GPDMA channel used to fill the TX FIFO */
+    uint8_t dma_rx_ch;              /**< GPDMA channel used to empty the RX FIFO, higher priority than the TX one */
+    uint8_t mode;                   /**< #SSP_INTERRUPT, #SSP_POLLING or #SSP_DMA */
     uint8_t frame_size;
-    Chip_SSP_DATA_SETUP_T xf_setup;
+    volatile bool dma_error;
+    const uint8_t *tx_buf;          /**< Frames to send, dummy frames are sent once they run out */
+    uint8_t *rx_buf;                /**< Received frames, may be NULL */
+    uint32_t tx_len;
+    uint32_t length;                /**< Size of the whole transfer (in bytes) */
+    volatile uint32_t tx_cnt;
+    volatile uint32_t rx_cnt;
     TaskHandle_t caller_task;
+    ssp_stats_t stats;
 } ssp_config_t;
 
-void ssp_init( uint8_t id, uint32_t bitrate, uint8_t frame_sz, bool master_mode, bool poll );
+/**
+ * @brief Initializes an SSP interface
+ *
+ * In #SSP_DMA mode, frames are moved by the GPDMA controller directly from and to the caller buffers, and the caller
+ * task sleeps until the transfer ends. Transfers shorter than #SSP_DMA_MIN_LEN, or whose buffers can't be reached by
+ * the GPDMA controller, are polled instead.
+ *
+ * @param id SSP interface
+ * @param bitrate Bit rate (in Hz)
+ * @param frame_sz Frame size (in bits)
+ * @param master_mode #SSP_MASTER or #SSP_SLAVE
+ * @param mode #SSP_INTERRUPT, #SSP_POLLING or #SSP_DMA
+ */
+void ssp_init( uint8_t id, uint32_t bitrate, uint8_t frame_sz, bool master_mode, uint8_t mode );
 void ssp_ssel_init( void );
 void ssp_ssel_control( uint8_t id, uint8_t state );
+
+/**
+ * @brief Sends @p tx_len bytes, then receives @p rx_len bytes, with SSEL asserted during the whole transfer
+ *
+ * Dummy frames (all ones) are sent while receiving. Every received frame is stored, so @p rx_buf must be able to
+ * hold @p tx_len + @p rx_len bytes, with the data sent back by the slave starting at @p rx_buf[tx_len].
+ * Both buffers are used in place, and they must not be changed until the function returns.
+ *
+ * @param id SSP interface
+ * @param tx_buf Bytes to send
+ * @param tx_len Amount of bytes to send
+ * @param rx_buf Buffer for the received bytes, or NULL
+ * @param rx_len Amount of bytes to receive after sending @p tx_buf
+ * @param timeout Maximum time to wait for the end of the transfer (in ticks), it is aborted on timeout
+ */
 void ssp_write_read( uint8_t id, uint8_t *tx_buf, uint32_t tx_len, uint8_t *rx_buf, uint32_t rx_len, uint32_t timeout );
 
+/**
+ * @brief Get the transfer statistics of an SSP interface
+ */
+const ssp_stats_t * ssp_get_stats( uint8_t id );
+
+/**
+ * @brief Clear the transfer statistics of an SSP interface
+ */
+void ssp_reset_stats( uint8_t id );
+
 #define ssp_chip_init(id)                             Chip_SSP_Init(SSP(id))
 #define ssp_chip_deinit(id)                           Chip_SSP_DeInit(SSP(id))
 #define ssp_flush_rx(id)                              Chip_SSP_Int_FlushData(SSP(id))
 #define ssp_set_bitrate(id, bitrate)                  Chip_SSP_SetBitRate(SSP(id), bitrate)
-#define ssp_write(id, buffer, buffer_len)             ssp_write_read(id, buffer, buffer_len, NULL, 0, 0)
+#define ssp_write(id, buffer, buffer_len)             ssp_write_read(id, buffer, buffer_len, NULL, 0, portMAX_DELAY)
 #define ssp_read(id, buffer, buffer_len, timeout)     ssp_write_read(id, NULL, 0, buffer, buffer_len, timeout)
 
 #endif
@@ -47,6 +47,7 @@
 #include "lpc17_pincfg.h"
 #include "pin_mapping.h"
 #include "arm_cm3_reset.h"
+#include "faults.h"
 
 #ifdef UART_RINGBUFFER
 #include "ring_buffer.h"
@@ -0,0 +1,451 @@
+#!/usr/bin/env python3
+#
+# openMMC -- Build-time SDR generator
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Generates a board sdr_list.c from a JSON sensor description.
+
+Each sensor is described with its conversion factors and thresholds in
+engineering units. The generator encodes them into the raw SDR bytes, decodes
+the resulting record image back through the IPMI conversion formula and aborts
+the build if any value does not survive the round trip, so encoding mistakes
+are caught on the host instead of during board bring-up.
+
+Description format (all keys besides "sensors" are optional):
+
+    {
+        "includes": [ "rtm_i2c_mapping.h" ],
+        "init_function": "rtm_sdr_init",
+        "sensors": [
+            {
+                "name": "SDR_LM75_RTM_1",
+                "type": "01h",
+                "module": "LM75",
+                "driver": "lm75_driver",
+                "chip_id": "CHIP_ID_RTM_LM75_0",
+                "diag_id": 0,
+                "id": "TEMP RTM1",
+                "fields": { "entityID": "0xC0", "sensortype": "SENSOR_TYPE_TEMPERATURE" },
+                "conversion": { "M": 5, "B": 0, "Rexp": -1, "Bexp": 0 },
+                "nominal": 30, "normal_max": 50, "normal_min": 20,
+                "thresholds": { "lnr": 5, "lc": 10, "lnc": 20, "unc": 55, "uc": 65, "unr": 75 },
+                "hysteresis": { "pos": 1.0, "neg": 1.0 }
+            }
+        ]
+    }
+
+"fields" may set any member of the SDR_type_01h_t/SDR_type_02h_t structures
+directly; symbolic values are resolved from modules/sdr.h.
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+SDR_VERSION = 0x51
+ID_STRING_MAX = 16
+
+# Structure layouts, in the same order as modules/sdr.h (no padding is needed
+# since both 16-bit masks are naturally aligned)
+SDR_01H_FIELDS = [
+    ('recID_LSB', 'B'), ('recID_MSB', 'B'), ('SDRversion', 'B'), ('rectype', 'B'), ('reclength', 'B'),
+    ('ownerID', 'B'), ('ownerLUN', 'B'), ('sensornum', 'B'),
+    ('entityID', 'B'), ('entityinstance', 'B'), ('sensorinit', 'B'), ('sensorcap', 'B'),
+    ('sensortype', 'B'), ('event_reading_type', 'B'),
+    ('assertion_event_mask', 'H'), ('deassertion_event_mask', 'H'),
+    ('settable_threshold_mask', 'B'), ('readable_threshold_mask', 'B'),
+    ('sensor_units_1', 'B'), ('sensor_units_2', 'B'), ('sensor_units_3', 'B'),
+    ('linearization', 'B'), ('M', 'B'), ('M_tol', 'B'), ('B', 'B'), ('B_accuracy', 'B'),
+    ('acc_exp_sensor_dir', 'B'), ('Rexp_Bexp', 'B'), ('analog_flags', 'B'),
+    ('nominal_reading', 'B'), ('normal_max', 'B'), ('normal_min', 'B'),
+    ('sensor_max_reading', 'B'), ('sensor_min_reading', 'B'),
+    ('upper_nonrecover_thr', 'B'), ('upper_critical_thr', 'B'), ('upper_noncritical_thr', 'B'),
+    ('lower_nonrecover_thr', 'B'), ('lower_critical_thr', 'B'), ('lower_noncritical_thr', 'B'),
+    ('pos_thr_hysteresis', 'B'), ('neg_thr_hysteresis', 'B'),
+    ('reserved1', 'B'), ('reserved2', 'B'), ('OEM', 'B'), ('IDtypelen', 'B'),
+]
+
+SDR_02H_FIELDS = [
+    ('recID_LSB', 'B'), ('recID_MSB', 'B'), ('SDRversion', 'B'), ('rectype', 'B'), ('reclength', 'B'),
+    ('ownerID', 'B'), ('ownerLUN', 'B'), ('sensornum', 'B'),
+    ('entityID', 'B'), ('entityinstance', 'B'), ('sensorinit', 'B'), ('sensorcap', 'B'),
+    ('sensortype', 'B'), ('event_reading_type', 'B'),
+    ('assertion_event_mask', 'H'), ('deassertion_event_mask', 'H'),
+    ('settable_threshold_mask', 'B'), ('readable_threshold_mask', 'B'),
+    ('sensor_units_1', 'B'), ('sensor_units_2', 'B'), ('sensor_units_3', 'B'),
+    ('record_sharing[0]', 'B'), ('record_sharing[1]', 'B'),
+    ('pos_thr_hysteresis', 'B'), ('neg_thr_hysteresis', 'B'),
+    ('reserved1', 'B'), ('reserved2', 'B'), ('reserved3', 'B'), ('OEM', 'B'), ('IDtypelen', 'B'),
+]
+
+RECORD_TYPES = {
+    '01h': ('TYPE_01', 0x01, 'SDR_type_01h_t', SDR_01H_FIELDS),
+    '02h': ('TYPE_02', 0x02, 'SDR_type_02h_t', SDR_02H_FIELDS),
+}
+
+# Defaults match the hand-written records used across port/board/*/sdr_list.c
+DEFAULTS_01H = {
+    'sensorinit': 0x7f, 'sensorcap': 0x68, 'event_reading_type': 0x01,
+    'assertion_event_mask': 0x7A95, 'deassertion_event_mask': 0x7A95,
+    'readable_threshold_mask': 0x3F, 'analog_flags': 0x03,
+    'sensor_max_reading': 0xFF, 'sensor_min_reading': 0x00,
+}
+
+DEFAULTS_02H = {
+    'sensorinit': 0x03, 'sensorcap': 0xc1, 'event_reading_type': 0x6f,
+    'sensor_units_1': 0xc0,
+}
+
+THRESHOLDS = [
+    ('lnr', 'lower_nonrecover_thr'), ('lc', 'lower_critical_thr'), ('lnc', 'lower_noncritical_thr'),
+    ('unc', 'upper_noncritical_thr'), ('uc', 'upper_critical_thr'), ('unr', 'upper_nonrecover_thr'),
+]
+
+ANALOG_FORMAT_UNSIGNED = 0
+ANALOG_FORMAT_1S_COMPL = 1
+ANALOG_FORMAT_2S_COMPL = 2
+
+
+class SdrError(Exception):
+    pass
+
+
+def load_symbols(header_paths):
+    """ Collect numeric #defines and enumerators so JSON can use the same names as C """
+    symbols = {}
+    define_re = re.compile(r'^\s*#define\s+(\w+)\s+\(?\s*(0x[0-9A-Fa-f]+|\d+)\s*\)?\s*(?:/[/*].*)?$')
+    enum_re = re.compile(r'^\s*(\w+)\s*=\s*(0x[0-9A-Fa-f]+|\d+)\s*,?')
+    for path in header_paths:
+        with open(path) as f:
+            for line in f:
+                m = define_re.match(line) or enum_re.match(line)
+                if m:
+                    symbols[m.group(1)] = int(m.group(2), 0)
+    return symbols
+
+
+def resolve(value, symbols, where):
+    if isinstance(value, bool):
+        return int(value)
+    if isinstance(value, int):
+        return value
+    if isinstance(value, str):
+        try:
+            return int(value, 0)
+        except ValueError:
+            pass
+        if value in symbols:
+            return symbols[value]
+    raise SdrError('{}: cannot resolve value "{}"'.format(where, value))
+
+
+def signed(value, bits):
+    value &= (1 << bits) - 1
+    return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def check_range(value, lo, hi, where):
+    if not lo <= value <= hi:
+        raise SdrError('{}: {} out of range [{}, {}]'.format(where, value, lo, hi))
+    return value
+
+
+class Conversion:
+    """ IPMI v2.0 section 36.3: y = (M * x + B * 10^Bexp) * 10^Rexp """
+
+    def __init__(self, M, B, Rexp, Bexp, fmt, where):
+        self.M = check_range(M, -512, 511, where + ' M')
+        self.B = check_range(B, -512, 511, where + ' B')
+        self.Rexp = check_range(Rexp, -8, 7, where + ' Rexp')
+        self.Bexp = check_range(Bexp, -8, 7, where + ' Bexp')
+        self.fmt = fmt
+        if self.M == 0:
+            raise SdrError(where + ': M must not be zero')
+
+    @classmethod
+    def from_record(cls, rec, fmt):
+        M = signed(rec['M'] | ((rec['M_tol'] & 0xC0) << 2), 10)
+        B = signed(rec['B'] | ((rec['B_accuracy'] & 0xC0) << 2), 10)
+        return cls(M, B, signed(rec['Rexp_Bexp'] >> 4, 4), signed(rec['Rexp_Bexp'], 4), fmt, 'decode')
+
+    @property
+    def step(self):
+        return abs(self.M) * 10.0 ** self.Rexp
+
+    def raw_range(self):
+        if self.fmt == ANALOG_FORMAT_UNSIGNED:
+            return 0, 255
+        if self.fmt == ANALOG_FORMAT_1S_COMPL:
+            return -127, 127
+        return -128, 127
+
+    def to_raw(self, value, where):
+        raw = round((value / 10.0 ** self.Rexp - self.B * 10.0 ** self.Bexp) / self.M)
+        lo, hi = self.raw_range()
+        check_range(raw, lo, hi, where + ' raw value for {}'.format(value))
+        return raw
+
+    def to_byte(self, raw):
+        if raw >= 0 or self.fmt == ANALOG_FORMAT_2S_COMPL:
+            return raw & 0xFF
+        return (~(-raw)) & 0xFF
+
+    def from_byte(self, byte):
+        if self.fmt == ANALOG_FORMAT_UNSIGNED:
+            raw = byte
+        elif self.fmt == ANALOG_FORMAT_1S_COMPL:
+            raw = -((~byte) & 0x7F) if byte & 0x80 else byte
+        else:
+            raw = signed(byte, 8)
+        return (self.M * raw + self.B * 10.0 ** self.Bexp) * 10.0 ** self.Rexp
+
+
+class Record:
+
+    def __init__(self, desc, symbols, index):
+        self.desc = desc
+        self.name = desc.get('name', 'SDR_{}'.format(index))
+        self.where = self.name
+        rtype = desc.get('type', '01h')
+        if rtype not in RECORD_TYPES:
+            raise SdrError('{}: unsupported record type "{}"'.format(self.where, rtype))
+        self.rtype = rtype
+        self.type_enum, self.type_code, self.c_type, self.layout = RECORD_TYPES[rtype]
+        self.module = desc.get('module')
+        self.driver = desc.get('driver')
+        self.chip_id = desc.get('chip_id', 0)
+        self.diag_id = desc.get('diag_id', 0)
+        self.id_string = desc.get('id', '')
+        self.comments = {}
+        self.fields = self.build(symbols)
+        self.image = self.pack()
+
+    def build(self, symbols):
+        fields = {name: 0 for name, _ in self.layout}
+        fields.update(DEFAULTS_01H if self.rtype == '01h' else DEFAULTS_02H)
+        fields['SDRversion'] = SDR_VERSION
+        fields['rectype'] = self.type_code
+        fields['reclength'] = struct.calcsize('<' + ''.join(f for _, f in self.layout)) + ID_STRING_MAX - 5
+
+        for key, value in self.desc.get('fields', {}).items():
+            if key not in fields or key.startswith('recID') or key in ('rectype', 'reclength', 'IDtypelen'):
+                raise SdrError('{}: unknown or generated field "{}"'.format(self.where, key))
+            fields[key] = resolve(value, symbols, '{}.{}'.format(self.where, key))
+            if isinstance(value, str) and value in symbols:
+                self.comments[key] = value
+
+        id_bytes = self.id_string.encode('ascii')
+        if len(id_bytes) > ID_STRING_MAX:
+            raise SdrError('{}: ID string "{}" is longer than {} bytes'.format(self.where, self.id_string, ID_STRING_MAX))
+        fields['IDtypelen'] = 0xc0 | len(id_bytes)
+
+        if self.rtype == '01h':
+            self.build_analog(fields)
+        elif 'thresholds' in self.desc or 'conversion' in self.desc:
+            raise SdrError('{}: compact (02h) records have no analog thresholds'.format(self.where))
+
+        if 'hysteresis' in self.desc and self.rtype == '01h':
+            conv = self.conversion
+            for key, field in (('pos', 'pos_thr_hysteresis'), ('neg', 'neg_thr_hysteresis')):
+                value = self.desc['hysteresis'].get(key, 0)
+                raw = round(value / conv.step)
+                fields[field] = check_range(raw, 0, 255, '{} {} hysteresis'.format(self.where, key))
+
+        for (name, fmt) in self.layout:
+            limit = 0xFFFF if fmt == 'H' else 0xFF
+            check_range(fields[name], 0, limit, '{}.{}'.format(self.where, name))
+        return fields
+
+    def build_analog(self, fields):
+        fmt = (fields['sensor_units_1'] >> 6) & 0x3
+        if fmt == 3:
+            raise SdrError('{}: sensor_units_1 declares a non-analog reading on a full sensor record'.format(self.where))
+        conv_desc = self.desc.get('conversion', {'M': 1, 'B': 0, 'Rexp': 0, 'Bexp': 0})
+        conv = Conversion(conv_desc.get('M', 1), conv_desc.get('B', 0), conv_desc.get('Rexp', 0),
+                          conv_desc.get('Bexp', 0), fmt, self.where)
+        self.conversion = conv
+        self.analog_format = fmt
+
+        fields['M'] = conv.M & 0xFF
+        fields['M_tol'] = (fields['M_tol'] & 0x3F) | (((conv.M & 0x3FF) >> 8) << 6)
+        fields['B'] = conv.B & 0xFF
+        fields['B_accuracy'] = (fields['B_accuracy'] & 0x3F) | (((conv.B & 0x3FF) >> 8) << 6)
+        fields['Rexp_Bexp'] = ((conv.Rexp & 0xF) << 4) | (conv.Bexp & 0xF)
+
+        self.expected = {}
+        for key, field in (('nominal', 'nominal_reading'), ('normal_max', 'normal_max'), ('normal_min', 'normal_min')):
+            if key in self.desc:
+                fields[field] = conv.to_byte(conv.to_raw(self.desc[key], '{} {}'.format(self.where, key)))
+                self.expected[field] = self.desc[key]
+
+        thr = self.desc.get('thresholds', {})
+        unknown = set(thr) - set(k for k, _ in THRESHOLDS)
+        if unknown:
+            raise SdrError('{}: unknown thresholds {}'.format(self.where, sorted(unknown)))
+        raws = []
+        for key, field in THRESHOLDS:
+            if key in thr:
+                raw = conv.to_raw(thr[key], '{} threshold {}'.format(self.where, key))
+                fields[field] = conv.to_byte(raw)
+                self.expected[field] = thr[key]
+                raws.append((key, thr[key], raw))
+
+        # Thresholds have to keep their order after quantization, otherwise the
+        # sensor would report e.g. a critical event before a non-critical one
+        for (k1, v1, r1), (k2, v2, r2) in zip(raws, raws[1:]):
+            if v1 > v2:
+                raise SdrError('{}: threshold {} ({}) is above {} ({})'.format(self.where, k1, v1, k2, v2))
+            if (conv.M > 0 and r1 > r2) or (conv.M < 0 and r1 < r2):
+                raise SdrError('{}: thresholds {} and {} swap order once encoded'.format(self.where, k1, k2))
+
+    def pack(self):
+        values = [self.fields[name] for name, _ in self.layout]
+        data = struct.pack('<' + ''.join(f for _, f in self.layout), *values)
+        return data + self.id_string.encode('ascii').ljust(ID_STRING_MAX, b'\0')
+
+    def verify(self):
+        """ Decode the packed image and make sure every value survived the encoding """
+        names = [name for name, _ in self.layout]
+        head = struct.unpack_from('<' + ''.join(f for _, f in self.layout), self.image)
+        rec = dict(zip(names, head))
+        idlen = rec['IDtypelen'] & 0x3F
+        offset = struct.calcsize('<' + ''.join(f for _, f in self.layout))
+        id_string = self.image[offset:offset + idlen].decode('ascii')
+        if id_string != self.id_string:
+            raise SdrError('{}: ID string decodes as "{}"'.format(self.where, id_string))
+        if rec['reclength'] + 5 != len(self.image):
+            raise SdrError('{}: record length mismatch'.format(self.where))
+        if self.rtype != '01h':
+            return
+        conv = Conversion.from_record(rec, (rec['sensor_units_1'] >> 6) & 0x3)
+        for field, expected in self.expected.items():
+            decoded = conv.from_byte(rec[field])
+            if abs(decoded - expected) > conv.step / 2 + 1e-9:
+                raise SdrError('{}: {} decodes as {} (expected {}, resolution {})'.format(
+                    self.where, field, decoded, expected, conv.step))
+
+    def checksum(self):
+        """ Zero-sum checksum over the record bytes, as used by IPMI FRU areas """
+        return (-sum(self.image)) & 0xFF
+
+    def emit(self):
+        lines = []
+        lines.append('/* Record image checksum: 0x{:02X} */'.format(self.checksum()))
+        lines.append('const {} {} = {{'.format(self.c_type, self.name))
+        lines.append('')
+        for name, _ in self.layout:
+            value = self.fields[name]
+            if name.startswith('recID') or name == 'sensornum':
+                text = '0x00, /* Filled by sdr_insert_entry() */'
+            elif name == 'rectype':
+                text = self.type_enum + ','
+            elif name == 'reclength':
+                text = 'sizeof({}) - sizeof(SDR_entry_hdr_t),'.format(self.c_type)
+            elif name == 'IDtypelen':
+                text = '0xc0 | STR_SIZE("{}"), /* 8 bit ASCII, number of bytes */'.format(self.id_string)
+            elif name in self.comments:
+                text = '{}, /* 0x{:02X} */'.format(self.comments[name], value)
+            elif name in getattr(self, 'expected', {}):
+                text = '0x{:02X}, /* {} */'.format(value, self.expected[name])
+            elif name in ('ownerID', 'entityinstance'):
+                text = '0x{:02X}, /* -> sdr_insert_entry() */'.format(value)
+            elif name.endswith('_mask') and name.startswith(('assertion', 'deassertion')):
+                text = '0x{:04X},'.format(value)
+            else:
+                text = '0x{:02X},'.format(value)
+            prefix = '.hdr.' if name in ('recID_LSB', 'recID_MSB', 'SDRversion', 'rectype', 'reclength') else '.'
+            lines.append('    {}{} = {}'.format(prefix, name, text))
+        lines.append('    .IDstring = "{}" /* sensor string */'.format(self.id_string))
+        lines.append('};')
+        return lines
+
+
+def fletcher16(data):
+    s1 = s2 = 0
+    for byte in data:
+        s1 = (s1 + byte) % 255
+        s2 = (s2 + s1) % 255
+    return (s2 << 8) | s1
+
+
+def guard(module, lines):
+    if not module:
+        return lines
+    return ['#ifdef MODULE_{}'.format(module)] + lines + ['#endif']
+
+
+def generate(desc, records, source):
+    out = []
+    out.append('/*')
+    out.append(' * Generated by scripts/sdr-gen.py from {} -- do not edit.'.format(source))
+    out.append(' *')
+    out.append(' * {} record(s), table checksum (Fletcher-16): 0x{:04X}'.format(
+        len(records), fletcher16(b''.join(r.image for r in records))))
+    out.append(' */')
+    out.append('')
+    out.append('/* Project Includes */')
+    for inc in ['sdr.h', 'utils.h', 'sensors.h'] + desc.get('includes', []):
+        out.append('#include "{}"'.format(inc))
+    out.append('')
+
+    for rec in records:
+        out.extend(guard(rec.module, rec.emit()))
+        out.append('')
+
+    out.append('void {}( void )'.format(desc.get('init_function', 'amc_sdr_init')))
+    out.append('{')
+    for rec in records:
+        driver = '&{}'.format(rec.driver) if rec.driver else 'NULL'
+        call = '    sdr_insert_entry( {}, (void *) &{}, {}, {}, {} );'.format(
+            rec.type_enum, rec.name, driver, rec.diag_id, rec.chip_id)
+        out.extend(guard(rec.module, [call]))
+    out.append('}')
+    out.append('')
+    return '\n'.join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generates SDR records from a JSON board description')
+    parser.add_argument('description', help='JSON sensor description')
+    parser.add_argument('-o', '--output', help='Generated C file (omit to only validate)')
+    parser.add_argument('-I', '--header', action='append', default=[],
+                        help='Header used to resolve symbolic field values (e.g. modules/sdr.h)')
+    args = parser.parse_args()
+
+    try:
+        with open(args.description) as f:
+            desc = json.load(f)
+        symbols = load_symbols(args.header)
+        records = [Record(s, symbols, i) for i, s in enumerate(desc['sensors'])]
+        names = [r.name for r in records]
+        dup = set(n for n in names if names.count(n) > 1)
+        if dup:
+            raise SdrError('duplicate record names: {}'.format(sorted(dup)))
+        for rec in records:
+            rec.verify()
+    except (SdrError, KeyError, ValueError) as e:
+        sys.exit('{}: error: {}'.format(args.description, e))
+
+    if args.output:
+        text = generate(desc, records, args.description.split('/')[-1])
+        with open(args.output, 'w') as f:
+            f.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,36 @@
+# Build-time SDR generation
+#
+# Boards that describe their sensors in a JSON file (see scripts/sdr-gen.py)
+# append it to SDR_DESCRIPTIONS instead of listing a hand-written sdr_list.c.
+# The top level CMakeLists.txt runs sdr_generate() on each of them, since
+# custom command outputs are only visible in the directory that creates them. The
+# description is validated and converted every time it changes, so threshold
+# encoding errors stop the build instead of showing up on the shelf.
+#
+# Python 3 is only looked for when a board has a description, so boards with
+# hand-written SDR lists still configure without it.
+
+# sdr_generate(<description.json> <output variable>)
+# Adds the custom command and returns the generated source path in <output variable>
+function(sdr_generate description output)
+  find_package(Python3 COMPONENTS Interpreter REQUIRED)
+
+  get_filename_component(desc_name ${description} NAME_WE)
+  get_filename_component(desc_dir ${description} DIRECTORY)
+  get_filename_component(board_name ${desc_dir} NAME)
+  set(generated ${CMAKE_BINARY_DIR}/generated/${board_name}_${desc_name}_list.c)
+
+  add_custom_command(
+    OUTPUT ${generated}
+    COMMAND ${CMAKE_COMMAND} -E make_directory ${CMAKE_BINARY_DIR}/generated
+    COMMAND ${Python3_EXECUTABLE} ${CMAKE_SOURCE_DIR}/scripts/sdr-gen.py
+            -I ${CMAKE_SOURCE_DIR}/modules/sdr.h
+            -o ${generated}
+            ${description}
+    DEPENDS ${description} ${CMAKE_SOURCE_DIR}/scripts/sdr-gen.py ${CMAKE_SOURCE_DIR}/modules/sdr.h
+    COMMENT "Generating SDR records from ${board_name}/${desc_name}.json"
+    VERBATIM
+    )
+
+  set(${output} ${generated} PARENT_SCOPE)
+endfunction()